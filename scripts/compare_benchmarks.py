@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Compares google benchmark json output with baseline recorded on the same machine.
+# Fails when cpu time grew more than threshold or allocations per op grew.
+# Usage: compare_benchmarks.py baseline.json current.json [--threshold 0.25] [--update]
+# Baseline is not checked in: record it with the bench_baseline target on the CI reference runner,
+# keep it as an artifact and configure later builds with -DBENCH_BASELINE_FILE=<path>.
+
+import argparse
+import json
+import os
+import shutil
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    result = {}
+    for bench in data.get('benchmarks', []):
+        if bench.get('run_type', 'iteration') != 'iteration' or 'error_occurred' in bench:
+            continue
+        result[bench['name']] = bench
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare benchmark results with baseline')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=0.25, help='allowed cpu time growth, 0.25 is 25%%')
+    parser.add_argument('--update', action='store_true', help='replace baseline with current results')
+    args = parser.parse_args()
+
+    if args.update:
+        shutil.copyfile(args.current, args.baseline)
+        print('baseline updated: {0}'.format(args.baseline))
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print('no baseline {0}, record it with the bench_baseline target'.format(args.baseline))
+        return 1
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    regressions = 0
+    for name, bench in sorted(current.items()):
+        base = baseline.get(name)
+        if not base:
+            print('{0:<60} new'.format(name))
+            continue
+
+        time_ratio = bench['cpu_time'] / base['cpu_time'] if base['cpu_time'] else 1.0
+        allocs = bench.get('allocs/op', 0.0)
+        base_allocs = base.get('allocs/op', 0.0)
+        status = 'ok'
+        if time_ratio > 1.0 + args.threshold:
+            status = 'SLOWER'
+        if allocs > base_allocs + 0.5:  # allocations are deterministic
+            status = 'MORE ALLOCS'
+        if status != 'ok':
+            regressions += 1
+        print('{0:<60} time {1:+7.1%} allocs/op {2:8.1f} -> {3:8.1f} {4}'.format(name, time_ratio - 1.0, base_allocs,
+                                                                                 allocs, status))
+
+    for name in sorted(set(baseline) - set(current)):
+        print('{0:<60} missing'.format(name))
+
+    if regressions:
+        print('{0} regressions against {1}'.format(regressions, args.baseline))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
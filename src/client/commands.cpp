@@ -61,6 +61,12 @@
 #define CLIENT_SEND_CHAT_MESSAGE_RESP_FAIL_1E GENEATATE_FAIL_FMT(SERVER_SEND_CHAT_MESSAGE, "'%s'")
 #define CLIENT_SEND_CHAT_MESSAGE_RESP_SUCCSESS_1E GENEATATE_SUCCESS_FMT(SERVER_SEND_CHAT_MESSAGE, "'%s'")
 
+// server_send_chat_messages
+#define CLIENT_SEND_CHAT_MESSAGES_RESP_SUCCSESS GENEATATE_SUCCESS_FMT(SERVER_SEND_CHAT_MESSAGES, "")
+
+// server_presence
+#define CLIENT_PRESENCE_RESP_SUCCSESS GENEATATE_SUCCESS_FMT(SERVER_PRESENCE, "")
+
 namespace fastotv {
 namespace client {
 
@@ -177,5 +183,15 @@ common::protocols::three_way_handshake::cmd_response_t SendChatMessageResponceSu
                                                               chat_message_serialized);
 }
 
+common::protocols::three_way_handshake::cmd_response_t SendChatMessagesResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id) {
+  return common::protocols::three_way_handshake::MakeResponse(id, CLIENT_SEND_CHAT_MESSAGES_RESP_SUCCSESS);
+}
+
+common::protocols::three_way_handshake::cmd_response_t PresenceResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id) {
+  return common::protocols::three_way_handshake::MakeResponse(id, CLIENT_PRESENCE_RESP_SUCCSESS);
+}
+
 }  // namespace client
 }  // namespace fastotv
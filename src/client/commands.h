@@ -91,6 +91,12 @@ common::protocols::three_way_handshake::cmd_response_t PingResponceSuccsess(
 common::protocols::three_way_handshake::cmd_response_t SendChatMessageResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const serializet_t& chat_message_serialized);
+// send_chat_messages, batch not echoed back
+common::protocols::three_way_handshake::cmd_response_t SendChatMessagesResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id);
+// presence
+common::protocols::three_way_handshake::cmd_response_t PresenceResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id);
 
 }  // namespace client
 }  // namespace fastotv
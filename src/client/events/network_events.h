@@ -24,6 +24,7 @@
 
 #include "commands_info/auth_info.h"
 #include "commands_info/channels_info.h"
+#include "commands_info/presence_info.h"
 #include "commands_info/runtime_channel_info.h"
 
 #include "client/types.h"  // for BandwidthHostType
@@ -38,6 +39,7 @@
 #define CLIENT_CHAT_MESSAGE_SENT_EVENT static_cast<EventsType>(USER_EVENTS + 8)
 #define CLIENT_CHAT_MESSAGE_RECEIVE_EVENT static_cast<EventsType>(USER_EVENTS + 9)
 #define CLIENT_BANDWIDTH_ESTIMATION_EVENT static_cast<EventsType>(USER_EVENTS + 10)
+#define CLIENT_PRESENCE_RECEIVE_EVENT static_cast<EventsType>(USER_EVENTS + 11)
 
 namespace fastotv {
 namespace client {
@@ -71,6 +73,7 @@ typedef fastoplayer::gui::events::EventBase<CLIENT_RECEIVE_RUNTIME_CHANNELS_EVEN
 typedef fastoplayer::gui::events::EventBase<CLIENT_CHAT_MESSAGE_SENT_EVENT, ChatMessage> SendChatMessageEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_CHAT_MESSAGE_RECEIVE_EVENT, ChatMessage> ReceiveChatMessageEvent;
 typedef fastoplayer::gui::events::EventBase<CLIENT_BANDWIDTH_ESTIMATION_EVENT, BandwidtInfo> BandwidthEstimationEvent;
+typedef fastoplayer::gui::events::EventBase<CLIENT_PRESENCE_RECEIVE_EVENT, PresenceInfo> ReceivePresenceEvent;
 
 }  // namespace events
 }  // namespace client
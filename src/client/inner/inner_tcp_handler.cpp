@@ -36,6 +36,7 @@
 #include "commands_info/channels_info.h"  // for ChannelsInfo
 #include "commands_info/client_info.h"    // for ClientInfo
 #include "commands_info/ping_info.h"      // for ClientPingInfo
+#include "commands_info/presence_info.h"  // for PresenceInfo
 #include "commands_info/runtime_channel_info.h"
 #include "commands_info/server_info.h"  // for ServerInfo
 
@@ -414,6 +415,68 @@ void InnerTcpHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* con
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
     return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGES)) {
+    if (argc < 2 || !argv[1]) {
+      common::Error parse_err = common::make_error_inval();
+      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    json_object* jmsgs = json_tokener_parse(argv[1]);
+    if (!jmsgs || !json_object_is_type(jmsgs, json_type_array)) {
+      json_object_put(jmsgs);
+      common::Error parse_err = common::make_error_inval();
+      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    size_t len = json_object_array_length(jmsgs);
+    for (size_t i = 0; i < len; ++i) {
+      json_object* jmsg = json_object_array_get_idx(jmsgs, i);
+      ChatMessage msg;
+      common::Error err_ser = msg.DeSerialize(jmsg);
+      if (err_ser) {
+        continue;
+      }
+      fApp->PostEvent(new events::ReceiveChatMessageEvent(this, msg));
+    }
+    json_object_put(jmsgs);
+
+    common::protocols::three_way_handshake::cmd_response_t resp = SendChatMessagesResponceSuccsess(id);
+    common::ErrnoError err = connection->Write(resp);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_PRESENCE)) {
+    if (argc < 2 || !argv[1]) {
+      common::Error parse_err = common::make_error_inval();
+      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    json_object* jpresence = json_tokener_parse(argv[1]);
+    if (!jpresence) {
+      common::Error parse_err = common::make_error_inval();
+      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    PresenceInfo presence;
+    common::Error err_ser = presence.DeSerialize(jpresence);
+    json_object_put(jpresence);
+    if (err_ser) {
+      DEBUG_MSG_ERROR(err_ser, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    fApp->PostEvent(new events::ReceivePresenceEvent(this, presence));
+    common::protocols::three_way_handshake::cmd_response_t resp = PresenceResponceSuccsess(id);
+    common::ErrnoError err = connection->Write(resp);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+    return;
   }
 
   WARNING_LOG() << "UNKNOWN REQUEST COMMAND: " << command;
@@ -458,6 +521,8 @@ void InnerTcpHandler::HandleInnerApproveCommand(fastotv::inner::InnerClient* con
         fApp->PostEvent(new events::ClientAuthorizedEvent(this, config_.ainf));
       } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_GET_CLIENT_INFO)) {
       } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_SEND_CHAT_MESSAGE)) {
+      } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_SEND_CHAT_MESSAGES)) {
+      } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_PRESENCE)) {
       }
     }
     return;
@@ -471,6 +536,8 @@ void InnerTcpHandler::HandleInnerApproveCommand(fastotv::inner::InnerClient* con
         fApp->PostEvent(ex_event);
       } else if (IS_EQUAL_COMMAND(failed_resp_command, SERVER_GET_CLIENT_INFO)) {
       } else if (IS_EQUAL_COMMAND(failed_resp_command, SERVER_SEND_CHAT_MESSAGE)) {
+      } else if (IS_EQUAL_COMMAND(failed_resp_command, SERVER_SEND_CHAT_MESSAGES)) {
+      } else if (IS_EQUAL_COMMAND(failed_resp_command, SERVER_PRESENCE)) {
       }
     }
     return;
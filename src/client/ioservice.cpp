@@ -191,6 +191,7 @@ common::libev::IoLoopObserver* IoService::CreateHandler() {
   inner::StartConfig conf;
   conf.inner_host = common::net::HostAndPort(SERVICE_HOST_NAME, SERVICE_HOST_PORT);
   conf.ainf = AuthInfo(USER_LOGIN, USER_PASSWORD, USER_DEVICE_ID);
+  conf.ainf.SetFeatures(CHAT_BATCH_FEATURE | PRESENCE_FEATURE);
   PrivateHandler* handler = new PrivateHandler(conf);
   return handler;
 }
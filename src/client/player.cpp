@@ -40,6 +40,8 @@
 #include "client/chat_window.h"
 #include "client/programs_window.h"
 
+#include "probes.h"  // for FASTOTV_PROBE2
+
 #define IMG_OFFLINE_CHANNEL_PATH_RELATIVE "share/resources/offline_channel.png"
 #define IMG_CONNECTION_ERROR_PATH_RELATIVE "share/resources/connection_error.png"
 
@@ -114,6 +116,7 @@ Player::Player(const std::string& app_directory_absolute_path,
   fApp->Subscribe(this, events::ReceiveRuntimeChannelEvent::EventType);
   fApp->Subscribe(this, events::SendChatMessageEvent::EventType);
   fApp->Subscribe(this, events::ReceiveChatMessageEvent::EventType);
+  fApp->Subscribe(this, events::ReceivePresenceEvent::EventType);
 
   // chat window
   chat_window_ = new ChatWindow(chat_color);
@@ -248,6 +251,9 @@ void Player::HandleEvent(event_t* event) {
   } else if (event->GetEventType() == events::ReceiveChatMessageEvent::EventType) {
     events::ReceiveChatMessageEvent* chat_msg_event = static_cast<events::ReceiveChatMessageEvent*>(event);
     HandleReceiveChatMessageEvent(chat_msg_event);
+  } else if (event->GetEventType() == events::ReceivePresenceEvent::EventType) {
+    events::ReceivePresenceEvent* presence_event = static_cast<events::ReceivePresenceEvent*>(event);
+    HandleReceivePresenceEvent(presence_event);
   }
 
   base_class::HandleEvent(event);
@@ -582,6 +588,20 @@ void Player::HandleReceiveChatMessageEvent(events::ReceiveChatMessageEvent* even
   }
 }
 
+void Player::HandleReceivePresenceEvent(events::ReceivePresenceEvent* event) {
+  PresenceInfo presence = event->GetInfo();
+  for (size_t i = 0; i < play_list_.size(); ++i) {
+    ChannelInfo cinfo = play_list_[i].GetChannelInfo();
+    if (cinfo.GetId() == presence.GetChannelId()) {
+      RuntimeChannelInfo rinfo = play_list_[i].GetRuntimeChannelInfo();
+      rinfo.SetWatchersCount(presence.GetWatchersCount());
+      chat_window_->SetWatchers(rinfo.GetWatchersCount());
+      play_list_[i].SetRuntimeChannelInfo(rinfo);
+      break;
+    }
+  }
+}
+
 void Player::HandleKeyPressEvent(fastoplayer::gui::events::KeyPressEvent* event) {
   if (chat_window_->IsActived()) {
     return;
@@ -915,7 +935,12 @@ void Player::SetStatus(States new_state) {
     description_label_->SetDrawType(fastoplayer::gui::Label::CENTER_TEXT);
     description_label_->SetIconTexture(nullptr);
     description_label_->SetBackGroundColor(failed_color);
-  } else if (new_state == PLAYING_STATE) {
+  } else if (new_state == PLAYING_STATE) {  // first frame of stream
+    FASTOTV_PROBE2(player_first_frame,
+                   current_stream_pos_ < play_list_.size()
+                       ? play_list_[current_stream_pos_].GetChannelInfo().GetId().c_str()
+                       : "",  // playlist can be replaced while stream starts
+                   current_stream_pos_);
     ChannelDescription descr;
     if (GetChannelDescription(current_stream_pos_, &descr)) {
 #define DESCR_LINES_COUNT 2
@@ -970,6 +995,7 @@ fastoplayer::media::VideoState* Player::CreateStream(stream_id sid,
                                                      const common::uri::Url& uri,
                                                      fastoplayer::media::AppOptions opt,
                                                      fastoplayer::media::ComplexOptions copt) {
+  FASTOTV_PROBE2(player_stream_create, sid.c_str(), current_stream_pos_);
   controller_->RequesRuntimeChannelInfo(sid);
   return base_class::CreateStream(sid, uri, opt, copt);
 }
@@ -80,6 +80,7 @@ class Player : public fastoplayer::ISimplePlayer {
   virtual void HandleReceiveRuntimeChannelEvent(events::ReceiveRuntimeChannelEvent* event);
   virtual void HandleSendChatMessageEvent(events::SendChatMessageEvent* event);
   virtual void HandleReceiveChatMessageEvent(events::ReceiveChatMessageEvent* event);
+  virtual void HandleReceivePresenceEvent(events::ReceivePresenceEvent* event);
 
   void HandleKeyPressEvent(fastoplayer::gui::events::KeyPressEvent* event) override;
   void HandleLircPressEvent(fastoplayer::gui::events::LircPressEvent* event) override;
@@ -37,4 +37,10 @@ typedef common::BoundedValue<int8_t, 0, 100> audio_volume_t;
 
 enum ChannelType { UNKNOWN_CHANNEL, OFFICAL_CHANNEL, PRIVATE_CHANNEL };
 
+typedef uint32_t client_features_t;  // protocol extensions supported by client, sent in who_are_you
+enum ClientFeature {
+  CHAT_BATCH_FEATURE = 1 << 0,  // server_send_chat_messages
+  PRESENCE_FEATURE = 1 << 1     // server_presence
+};
+
 }  // namespace fastotv
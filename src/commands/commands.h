@@ -32,6 +32,8 @@
 #define SERVER_WHO_ARE_YOU "who_are_you"
 #define SERVER_GET_CLIENT_INFO "get_client_info"
 #define SERVER_SEND_CHAT_MESSAGE "server_send_chat_message"
+#define SERVER_SEND_CHAT_MESSAGES "server_send_chat_messages"  // json array, only for CHAT_BATCH_FEATURE clients
+#define SERVER_PRESENCE "server_presence"                      // watchers changes, only for PRESENCE_FEATURE clients
 
 // request
 // [uint8_t](0) [hex_string]seq [std::string]command
@@ -26,13 +26,14 @@
 #define AUTH_INFO_LOGIN_FIELD "login"
 #define AUTH_INFO_PASSWORD_FIELD "password"
 #define AUTH_INFO_DEVICE_ID_FIELD "device_id"
+#define AUTH_INFO_FEATURES_FIELD "features"
 
 namespace fastotv {
 
-AuthInfo::AuthInfo() : login_(), password_() {}
+AuthInfo::AuthInfo() : login_(), password_(), device_id_(), features_(0) {}
 
 AuthInfo::AuthInfo(const login_t& login, const std::string& password, device_id_t dev)
-    : login_(login), password_(password), device_id_(dev) {}
+    : login_(login), password_(password), device_id_(dev), features_(0) {}
 
 bool AuthInfo::IsValid() const {
   return !login_.empty() && !password_.empty() && !device_id_.empty();
@@ -46,6 +47,9 @@ common::Error AuthInfo::SerializeFields(json_object* deserialized) const {
   json_object_object_add(deserialized, AUTH_INFO_LOGIN_FIELD, json_object_new_string(login_.c_str()));
   json_object_object_add(deserialized, AUTH_INFO_PASSWORD_FIELD, json_object_new_string(password_.c_str()));
   json_object_object_add(deserialized, AUTH_INFO_DEVICE_ID_FIELD, json_object_new_string(device_id_.c_str()));
+  if (features_) {
+    json_object_object_add(deserialized, AUTH_INFO_FEATURES_FIELD, json_object_new_int64(features_));
+  }
   return common::Error();
 }
 
@@ -69,6 +73,11 @@ common::Error AuthInfo::DoDeSerialize(json_object* serialized) {
   }
 
   fastotv::AuthInfo ainf(json_object_get_string(jlogin), json_object_get_string(jpass), json_object_get_string(jdevid));
+  json_object* jfeatures = nullptr;
+  json_bool jfeatures_exists = json_object_object_get_ex(serialized, AUTH_INFO_FEATURES_FIELD, &jfeatures);
+  if (jfeatures_exists) {
+    ainf.features_ = json_object_get_int64(jfeatures);
+  }
   *this = ainf;
   return common::Error();
 }
@@ -85,6 +94,18 @@ std::string AuthInfo::GetPassword() const {
   return password_;
 }
 
+client_features_t AuthInfo::GetFeatures() const {
+  return features_;
+}
+
+void AuthInfo::SetFeatures(client_features_t features) {
+  features_ = features;
+}
+
+bool AuthInfo::HaveFeature(ClientFeature feature) const {
+  return features_ & feature;
+}
+
 bool AuthInfo::Equals(const AuthInfo& auth) const {
   return login_ == auth.login_ && password_ == auth.password_;
 }
@@ -22,7 +22,7 @@
 
 #include <common/serializer/json_serializer.h>
 
-#include "client_server_types.h"  // for login_t
+#include "client_server_types.h"  // for login_t, client_features_t
 
 namespace fastotv {
 
@@ -36,6 +36,9 @@ class AuthInfo : public common::serializer::JsonSerializer<AuthInfo> {
   device_id_t GetDeviceID() const;
   login_t GetLogin() const;
   std::string GetPassword() const;
+  client_features_t GetFeatures() const;
+  void SetFeatures(client_features_t features);
+  bool HaveFeature(ClientFeature feature) const;
   bool Equals(const AuthInfo& auth) const;
 
  protected:
@@ -46,6 +49,7 @@ class AuthInfo : public common::serializer::JsonSerializer<AuthInfo> {
   login_t login_;  // unique
   std::string password_;
   device_id_t device_id_;
+  client_features_t features_;  // not part of identity
 };
 
 inline bool operator==(const AuthInfo& lhs, const AuthInfo& rhs) {
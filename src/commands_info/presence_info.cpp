@@ -0,0 +1,91 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "commands_info/presence_info.h"
+
+#define PRESENCE_INFO_CHANNEL_ID_FIELD "channel_id"
+#define PRESENCE_INFO_WATCHERS_FIELD "watchers"
+#define PRESENCE_INFO_DELTA_FIELD "delta"
+
+namespace fastotv {
+
+PresenceInfo::PresenceInfo() : channel_id_(invalid_stream_id), watchers_(0), delta_(0) {}
+
+PresenceInfo::PresenceInfo(stream_id channel, size_t watchers, int64_t delta)
+    : channel_id_(channel), watchers_(watchers), delta_(delta) {}
+
+bool PresenceInfo::IsValid() const {
+  return channel_id_ != invalid_stream_id;
+}
+
+stream_id PresenceInfo::GetChannelId() const {
+  return channel_id_;
+}
+
+size_t PresenceInfo::GetWatchersCount() const {
+  return watchers_;
+}
+
+int64_t PresenceInfo::GetDelta() const {
+  return delta_;
+}
+
+bool PresenceInfo::Equals(const PresenceInfo& presence) const {
+  return channel_id_ == presence.channel_id_ && watchers_ == presence.watchers_ && delta_ == presence.delta_;
+}
+
+common::Error PresenceInfo::SerializeFields(json_object* deserialized) const {
+  if (!IsValid()) {
+    return common::make_error_inval();
+  }
+
+  json_object_object_add(deserialized, PRESENCE_INFO_CHANNEL_ID_FIELD, json_object_new_string(channel_id_.c_str()));
+  json_object_object_add(deserialized, PRESENCE_INFO_WATCHERS_FIELD, json_object_new_int64(watchers_));
+  json_object_object_add(deserialized, PRESENCE_INFO_DELTA_FIELD, json_object_new_int64(delta_));
+  return common::Error();
+}
+
+common::Error PresenceInfo::DoDeSerialize(json_object* serialized) {
+  json_object* jchan = nullptr;
+  json_bool jchan_exists = json_object_object_get_ex(serialized, PRESENCE_INFO_CHANNEL_ID_FIELD, &jchan);
+  if (!jchan_exists) {
+    return common::make_error_inval();
+  }
+  const stream_id chan = json_object_get_string(jchan);
+  if (chan == invalid_stream_id) {
+    return common::make_error_inval();
+  }
+
+  PresenceInfo presence(chan, 0, 0);
+  json_object* jwatchers = nullptr;
+  json_bool jwatchers_exists = json_object_object_get_ex(serialized, PRESENCE_INFO_WATCHERS_FIELD, &jwatchers);
+  if (jwatchers_exists) {
+    presence.watchers_ = json_object_get_int64(jwatchers);
+  }
+
+  json_object* jdelta = nullptr;
+  json_bool jdelta_exists = json_object_object_get_ex(serialized, PRESENCE_INFO_DELTA_FIELD, &jdelta);
+  if (jdelta_exists) {
+    presence.delta_ = json_object_get_int64(jdelta);
+  }
+
+  *this = presence;
+  return common::Error();
+}
+
+}  // namespace fastotv
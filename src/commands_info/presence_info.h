@@ -0,0 +1,61 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/serializer/json_serializer.h>
+
+#include "client_server_types.h"  // for stream_id
+
+// {"channel_id" : "1234", "watchers" : 120, "delta" : -3}
+
+namespace fastotv {
+
+// watchers of channel, changes since previous presence of same channel
+class PresenceInfo : public common::serializer::JsonSerializer<PresenceInfo> {
+ public:
+  PresenceInfo();
+  PresenceInfo(stream_id channel, size_t watchers, int64_t delta);
+
+  bool IsValid() const;
+
+  stream_id GetChannelId() const;
+  size_t GetWatchersCount() const;
+  int64_t GetDelta() const;
+
+  bool Equals(const PresenceInfo& presence) const;
+
+ protected:
+  common::Error DoDeSerialize(json_object* serialized) override;
+  common::Error SerializeFields(json_object* deserialized) const override;
+
+ private:
+  stream_id channel_id_;
+  size_t watchers_;
+  int64_t delta_;
+};
+
+inline bool operator==(const PresenceInfo& left, const PresenceInfo& right) {
+  return left.Equals(right);
+}
+
+inline bool operator!=(const PresenceInfo& x, const PresenceInfo& y) {
+  return !(x == y);
+}
+
+}  // namespace fastotv
@@ -28,7 +28,7 @@
 namespace fastotv {
 
 RuntimeChannelInfo::RuntimeChannelInfo()
-    : channel_id_(invalid_stream_id),
+    : channel_id_(),
       watchers_(0),
       type_(UNKNOWN_CHANNEL),
       chat_enabled_(false),
@@ -51,14 +51,18 @@ RuntimeChannelInfo::RuntimeChannelInfo(stream_id channel_id,
 RuntimeChannelInfo::~RuntimeChannelInfo() {}
 
 bool RuntimeChannelInfo::IsValid() const {
-  return channel_id_ != invalid_stream_id;
+  return !channel_id_.IsEmpty();
 }
 
 void RuntimeChannelInfo::SetChannelId(stream_id sid) {
-  channel_id_ = sid;
+  channel_id_ = Symbol(sid);
 }
 
-stream_id RuntimeChannelInfo::GetChannelId() const {
+const stream_id& RuntimeChannelInfo::GetChannelId() const {
+  return channel_id_.ToString();
+}
+
+Symbol RuntimeChannelInfo::GetChannelSymbol() const {
   return channel_id_;
 }
 
@@ -118,7 +122,7 @@ common::Error RuntimeChannelInfo::SerializeFields(json_object* deserialized) con
   }
 
   json_object_object_add(deserialized, RUNTIME_CHANNEL_INFO_CHANNEL_ID_FIELD,
-                         json_object_new_string(channel_id_.c_str()));
+                         json_object_new_string(GetChannelId().c_str()));
   json_object_object_add(deserialized, RUNTIME_CHANNEL_INFO_WATCHERS_FIELD, json_object_new_int(watchers_));
   json_object_object_add(deserialized, RUNTIME_CHANNEL_INFO_CHANNEL_TYPE_FIELD, json_object_new_int(type_));
   json_object_object_add(deserialized, RUNTIME_CHANNEL_INFO_CHAT_ENABLED_FIELD, json_object_new_boolean(chat_enabled_));
@@ -146,7 +150,9 @@ common::Error RuntimeChannelInfo::DoDeSerialize(json_object* serialized) {
   if (cid == invalid_stream_id) {
     return common::make_error_inval();
   }
-  inf.channel_id_ = cid;
+  if (!Symbol::Intern(cid, &inf.channel_id_)) {
+    return common::make_error("Symbol table is full");
+  }
 
   json_object* jchat_type = nullptr;
   json_bool jchat_type_exists =
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "client_server_types.h"
+#include "symbol.h"
 
 #include "chat_message.h"
 
@@ -41,7 +42,8 @@ class RuntimeChannelInfo : public common::serializer::JsonSerializer<RuntimeChan
   bool IsValid() const;
 
   void SetChannelId(stream_id sid);
-  stream_id GetChannelId() const;
+  const stream_id& GetChannelId() const;
+  Symbol GetChannelSymbol() const;
 
   void SetWatchersCount(size_t count);
   size_t GetWatchersCount() const;
@@ -65,7 +67,7 @@ class RuntimeChannelInfo : public common::serializer::JsonSerializer<RuntimeChan
   common::Error SerializeFields(json_object* deserialized) const override;
 
  private:
-  stream_id channel_id_;
+  Symbol channel_id_;
   size_t watchers_;
   ChannelType type_;
   bool chat_enabled_;
@@ -24,16 +24,26 @@
 
 #include <common/text_decoders/compress_snappy_edcoder.h>
 
+#include "probes.h"  // for FASTOTV_PROBE3
+
 namespace fastotv {
 namespace inner {
 
-InnerClient::InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info)
-    : common::libev::tcp::TcpClient(server, info), compressor_(new common::CompressSnappyEDcoder) {}
+namespace {
 
-InnerClient::~InnerClient() {
-  destroy(&compressor_);
+// stateless, one per loop thread instead of one per connection
+common::IEDcoder* GetCompressor() {
+  static thread_local common::CompressSnappyEDcoder compressor;
+  return &compressor;
 }
 
+}  // namespace
+
+InnerClient::InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info)
+    : common::libev::tcp::TcpClient(server, info) {}
+
+InnerClient::~InnerClient() {}
+
 const char* InnerClient::ClassName() const {
   return "InnerClient";
 }
@@ -122,13 +132,14 @@ common::ErrnoError InnerClient::ReadCommand(std::string* out) {
 
   const common::char_buffer_t compressed = MAKE_CHAR_BUFFER_SIZE(msg, message_size);
   common::char_buffer_t un_compressed;
-  common::Error dec_err = compressor_->Decode(compressed, &un_compressed);
+  common::Error dec_err = GetCompressor()->Decode(compressed, &un_compressed);
   free(msg);
   if (dec_err) {
     return common::make_errno_error(dec_err->GetDescription(), EINVAL);
   }
 
   *out = un_compressed.as_string();
+  FASTOTV_PROBE3(frame_read, this, message_size, out->size());
   return common::ErrnoError();
 }
 
@@ -138,7 +149,7 @@ common::ErrnoError InnerClient::WriteMessage(const std::string& message) {
   }
 
   common::char_buffer_t compressed;
-  common::Error enc_err = compressor_->Encode(message, &compressed);
+  common::Error enc_err = GetCompressor()->Encode(message, &compressed);
   if (enc_err) {
     return common::make_errno_error(enc_err->GetDescription(), EINVAL);
   }
@@ -150,6 +161,7 @@ common::ErrnoError InnerClient::WriteMessage(const std::string& message) {
     return common::make_errno_error(common::MemSPrintf("Reached limit of command size: %u", size), EINVAL);
   }
 
+  FASTOTV_PROBE3(frame_write, this, size, message.size());
   const protocoled_size_t message_size = common::HostToNet32(size);  // stable
   const size_t protocoled_data_len = size + sizeof(protocoled_size_t);
 
@@ -24,10 +24,6 @@
 
 #include "commands/commands.h"
 
-namespace common {
-class IEDcoder;
-}
-
 namespace fastotv {
 namespace inner {
 
@@ -53,9 +49,6 @@ class InnerClient : public common::libev::tcp::TcpClient {
   common::ErrnoError WriteMessage(const std::string& message) WARN_UNUSED_RESULT;
   using common::libev::tcp::TcpClient::Read;
   using common::libev::tcp::TcpClient::Write;
-
- private:
-  common::IEDcoder* compressor_;
 };
 
 }  // namespace inner
@@ -25,6 +25,7 @@
 #include <common/sys_byteorder.h>
 
 #include "inner/inner_client.h"  // for InnerClient
+#include "probes.h"              // for FASTOTV_PROBE4
 
 extern "C" {
 #include "sds_fasto.h"  // for sdsfreesplitres, sds
@@ -51,7 +52,8 @@ void RequestCallback::Execute(int argc, char* argv[]) {
   return cb_(request_id_, argc, argv);
 }
 
-InnerServerCommandSeqParser::InnerServerCommandSeqParser() : id_() {}
+InnerServerCommandSeqParser::InnerServerCommandSeqParser()
+    : id_(), subscribed_requests_mutex_(), subscribed_requests_() {}
 
 InnerServerCommandSeqParser::~InnerServerCommandSeqParser() {}
 
@@ -65,31 +67,26 @@ common::protocols::three_way_handshake::cmd_seq_t InnerServerCommandSeqParser::N
   return hexed;
 }
 
-namespace {
-
-bool exec_reqest(RequestCallback req,
-                 common::protocols::three_way_handshake::cmd_seq_t request_id,
-                 int argc,
-                 char* argv[]) {
-  if (request_id == req.GetRequestID()) {
-    req.Execute(argc, argv);
-    return true;
-  }
-
-  return false;
-}
-
-}  // namespace
-
 void InnerServerCommandSeqParser::ProcessRequest(common::protocols::three_way_handshake::cmd_seq_t request_id,
                                                  int argc,
                                                  char* argv[]) {
-  subscribed_requests_.erase(std::remove_if(subscribed_requests_.begin(), subscribed_requests_.end(),
-                                            std::bind(&exec_reqest, std::placeholders::_1, request_id, argc, argv)),
-                             subscribed_requests_.end());
+  std::vector<RequestCallback> matched;
+  {
+    std::unique_lock<std::mutex> lock(subscribed_requests_mutex_);
+    auto it = std::stable_partition(
+        subscribed_requests_.begin(), subscribed_requests_.end(),
+        [request_id](const RequestCallback& req) { return req.GetRequestID() != request_id; });
+    matched.assign(it, subscribed_requests_.end());
+    subscribed_requests_.erase(it, subscribed_requests_.end());
+  }
+
+  for (RequestCallback& req : matched) {  // callbacks without lock, they can subscribe again
+    req.Execute(argc, argv);
+  }
 }
 
 void InnerServerCommandSeqParser::SubscribeRequest(const RequestCallback& req) {
+  std::unique_lock<std::mutex> lock(subscribed_requests_mutex_);
   subscribed_requests_.push_back(req);
 }
 
@@ -118,10 +115,13 @@ void InnerServerCommandSeqParser::HandleInnerDataReceived(InnerClient* connectio
     return;
   }
 
+  FASTOTV_PROBE4(command_dispatch, connection, seq, id.c_str(), cmd_str.c_str());
   ProcessRequest(id, argc, argv);
+#if !defined(NDEBUG) || defined(LOG_INNER_COMMANDS)
   INFO_LOG() << "HANDLE INNER COMMAND client[" << connection->GetFormatedName()
              << "] seq: " << common::protocols::three_way_handshake::CmdIdToString(seq) << ", id:" << id
              << ", cmd: " << cmd_str;
+#endif
   if (seq == REQUEST_COMMAND) {
     HandleInnerRequestCommand(connection, id, argc, argv);
   } else if (seq == RESPONSE_COMMAND) {
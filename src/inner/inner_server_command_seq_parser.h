@@ -20,6 +20,8 @@
 
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 #include "commands/commands.h"
 
@@ -52,7 +54,7 @@ class InnerServerCommandSeqParser {
   InnerServerCommandSeqParser();
   virtual ~InnerServerCommandSeqParser();
 
-  void SubscribeRequest(const RequestCallback& req);
+  void SubscribeRequest(const RequestCallback& req);  // thread safe
 
  protected:
   void HandleInnerDataReceived(InnerClient* connection, const std::string& input_command);
@@ -77,6 +79,7 @@ class InnerServerCommandSeqParser {
                                          char* argv[]) = 0;  // called when argv not NULL and argc > 0
 
   std::atomic<seq_id_t> id_;
+  std::mutex subscribed_requests_mutex_;
   std::vector<RequestCallback> subscribed_requests_;
 };
 
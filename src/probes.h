@@ -0,0 +1,39 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// USDT (systemtap sdt) tracepoints, provider "fastotv", nops without USDT_PROBES build option
+// bpftrace -e 'usdt:./fastotv_server:fastotv:command_dispatch { printf("%s %s\n", str(arg1), str(arg2)); }'
+// arguments should be integers or pointers, strings passed as const char*
+
+#if defined(HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+
+#define FASTOTV_PROBE0(name) DTRACE_PROBE(fastotv, name)
+#define FASTOTV_PROBE1(name, a1) DTRACE_PROBE1(fastotv, name, a1)
+#define FASTOTV_PROBE2(name, a1, a2) DTRACE_PROBE2(fastotv, name, a1, a2)
+#define FASTOTV_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(fastotv, name, a1, a2, a3)
+#define FASTOTV_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(fastotv, name, a1, a2, a3, a4)
+#else  // arguments not evaluated
+#define FASTOTV_PROBE0(name) static_cast<void>(0)
+#define FASTOTV_PROBE1(name, a1) static_cast<void>(sizeof(a1))
+#define FASTOTV_PROBE2(name, a1, a2) static_cast<void>(sizeof(a1) + sizeof(a2))
+#define FASTOTV_PROBE3(name, a1, a2, a3) static_cast<void>(sizeof(a1) + sizeof(a2) + sizeof(a3))
+#define FASTOTV_PROBE4(name, a1, a2, a3, a4) static_cast<void>(sizeof(a1) + sizeof(a2) + sizeof(a3) + sizeof(a4))
+#endif
@@ -0,0 +1,199 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/async_logger.h"
+
+#include <chrono>
+#include <utility>  // for move
+
+#include <common/logger.h>                  // for INFO_LOG, WARNING_LOG
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+namespace fastotv {
+namespace server {
+
+AsyncLogger::Record::Record() : level(common::logging::LOG_LEVEL_INFO), message() {}
+
+AsyncLogger::Record::Record(common::logging::LOG_LEVEL level, std::string message)
+    : level(level), message(std::move(message)) {}
+
+AsyncLogger* AsyncLogger::GetInstance() {
+  static AsyncLogger logger;
+  return &logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : queue_(nullptr), thread_(), started_(false), dropped_(0), stop_mutex_(), stop_cond_(), stop_(false) {}
+
+AsyncLogger::~AsyncLogger() {
+  Stop();
+  delete queue_;
+}
+
+bool AsyncLogger::Start(size_t queue_size) {
+  if (started_ || thread_) {
+    return false;
+  }
+
+  if (!queue_) {
+    queue_ = new BoundedMPSCQueue<Record>(queue_size);
+  }
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_ = false;
+  }
+
+  thread_ = THREAD_MANAGER()->CreateThread(&AsyncLogger::Run, this);
+  if (!thread_->Start()) {
+    thread_.reset();
+    return false;
+  }
+
+  started_ = true;
+  return true;
+}
+
+void AsyncLogger::Stop() {
+  if (!thread_) {
+    return;
+  }
+
+  started_ = false;
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_ = true;
+    stop_cond_.notify_all();
+  }
+  thread_->Join();
+  thread_.reset();
+  Drain();
+
+  const uint64_t dropped = dropped_.exchange(0);
+  if (dropped) {
+    WARNING_LOG() << "Async logger dropped records: " << dropped;
+  }
+}
+
+void AsyncLogger::Post(common::logging::LOG_LEVEL level, std::string message) {
+  if (!started_) {
+    Write(level, message);
+    return;
+  }
+
+  if (!queue_->Push(Record(level, std::move(message)))) {
+    dropped_++;
+  }
+}
+
+uint64_t AsyncLogger::GetDroppedCount() const {
+  return dropped_;
+}
+
+void AsyncLogger::Run() {
+  uint64_t reported_dropped = 0;
+  while (true) {
+    Drain();
+
+    const uint64_t dropped = dropped_;
+    if (dropped != reported_dropped) {
+      WARNING_LOG() << "Async logger queue is full, dropped records: " << dropped - reported_dropped;
+      reported_dropped = dropped;
+    }
+
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    if (stop_cond_.wait_for(lock, std::chrono::milliseconds(drain_interval_msec), [this]() { return stop_; })) {
+      break;
+    }
+  }
+  dropped_ -= reported_dropped;
+}
+
+void AsyncLogger::Drain() {
+  Record record;
+  while (queue_->Pop(&record)) {
+    Write(record.level, record.message);
+  }
+}
+
+void AsyncLogger::Write(common::logging::LOG_LEVEL level, const std::string& message) {
+  switch (level) {
+    case common::logging::LOG_LEVEL_EMERG:
+    case common::logging::LOG_LEVEL_ALERT:
+    case common::logging::LOG_LEVEL_CRIT:
+      CRITICAL_LOG() << message;
+      break;
+    case common::logging::LOG_LEVEL_ERR:
+      ERROR_LOG() << message;
+      break;
+    case common::logging::LOG_LEVEL_WARNING:
+      WARNING_LOG() << message;
+      break;
+    case common::logging::LOG_LEVEL_NOTICE:
+      NOTICE_LOG() << message;
+      break;
+    case common::logging::LOG_LEVEL_INFO:
+      INFO_LOG() << message;
+      break;
+    default:
+      DEBUG_LOG() << message;
+      break;
+  }
+}
+
+LogSiteLimiter::LogSiteLimiter(size_t limit) : limit_(limit), window_(0), count_(0), suppressed_(0) {}
+
+bool LogSiteLimiter::Allow(uint64_t* suppressed) {
+  const uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+  uint64_t window = window_.load(std::memory_order_relaxed);
+  if (window != now && window_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+    count_.store(0, std::memory_order_relaxed);
+  }
+
+  if (count_.fetch_add(1, std::memory_order_relaxed) >= limit_) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (suppressed) {
+    *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+AsyncLogMessage::AsyncLogMessage(common::logging::LOG_LEVEL level, uint64_t suppressed)
+    : level_(level), suppressed_(suppressed), stream_() {}
+
+AsyncLogMessage::~AsyncLogMessage() {
+  if (suppressed_) {
+    stream_ << " (suppressed similar: " << suppressed_ << ")";
+  }
+  AsyncLogger::GetInstance()->Post(level_, stream_.str());
+}
+
+std::ostream& AsyncLogMessage::Stream() {
+  return stream_;
+}
+
+bool IsLogLevelEnabled(common::logging::LOG_LEVEL level) {
+  return level <= common::logging::CURRENT_LOG_LEVEL();
+}
+
+}  // namespace server
+}  // namespace fastotv
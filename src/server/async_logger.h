@@ -0,0 +1,149 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <sstream>  // for ostringstream
+#include <string>   // for string
+
+#include <common/log_levels.h>  // for LOG_LEVEL
+#include <common/macros.h>      // for DISALLOW_COPY_AND_ASSIGN
+
+#include "server/bounded_mpsc_queue.h"  // for BoundedMPSCQueue
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+
+// records formatted on caller thread, written into common logger by background thread
+class AsyncLogger {
+ public:
+  enum { default_queue_size = 16384, drain_interval_msec = 10 };
+
+  static AsyncLogger* GetInstance();
+
+  bool Start(size_t queue_size = default_queue_size);  // false if already started
+  void Stop();  // writes pending records, call after producers stopped
+
+  // thread safe, written synchronously if logger not started, dropped if queue is full
+  void Post(common::logging::LOG_LEVEL level, std::string message);
+  uint64_t GetDroppedCount() const;
+
+ private:
+  struct Record {
+    Record();
+    Record(common::logging::LOG_LEVEL level, std::string message);
+
+    common::logging::LOG_LEVEL level;
+    std::string message;
+  };
+
+  AsyncLogger();
+  ~AsyncLogger();
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogger);
+
+  void Run();
+  void Drain();
+  static void Write(common::logging::LOG_LEVEL level, const std::string& message);
+
+  BoundedMPSCQueue<Record>* queue_;
+  std::shared_ptr<common::threads::Thread<void>> thread_;
+  std::atomic<bool> started_;
+  std::atomic<uint64_t> dropped_;
+
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cond_;
+  bool stop_;
+};
+
+// per call site limiter, at most limit records per second
+class LogSiteLimiter {
+ public:
+  explicit LogSiteLimiter(size_t limit);
+
+  bool Allow(uint64_t* suppressed);  // thread safe, suppressed records since previous allowed one
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LogSiteLimiter);
+
+  const size_t limit_;
+  std::atomic<uint64_t> window_;
+  std::atomic<size_t> count_;
+  std::atomic<uint64_t> suppressed_;
+};
+
+class AsyncLogMessage {
+ public:
+  AsyncLogMessage(common::logging::LOG_LEVEL level, uint64_t suppressed);
+  ~AsyncLogMessage();
+
+  std::ostream& Stream();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogMessage);
+
+  const common::logging::LOG_LEVEL level_;
+  const uint64_t suppressed_;
+  std::ostringstream stream_;
+};
+
+class AsyncLogVoidify {
+ public:
+  void operator&(std::ostream&) {}
+};
+
+bool IsLogLevelEnabled(common::logging::LOG_LEVEL level);
+
+}  // namespace server
+}  // namespace fastotv
+
+// message not formatted if level disabled or limited
+#define ASYNC_LOG_IF(LEVEL, COND, SUPPRESSED)                        \
+  !(fastotv::server::IsLogLevelEnabled(LEVEL) && (COND))             \
+      ? (void)0                                                      \
+      : fastotv::server::AsyncLogVoidify() &                         \
+            fastotv::server::AsyncLogMessage(LEVEL, SUPPRESSED).Stream()
+
+#define ASYNC_LOG(LEVEL) ASYNC_LOG_IF(LEVEL, true, 0)
+#define ASYNC_INFO_LOG() ASYNC_LOG(common::logging::LOG_LEVEL_INFO)
+#define ASYNC_WARNING_LOG() ASYNC_LOG(common::logging::LOG_LEVEL_WARNING)
+
+// lambda static is unique per call site
+#define ASYNC_LOG_RATE_LIMITED(LEVEL, LIMIT)                                                       \
+  for (uint64_t async_log_suppressed = 0, async_log_once = 1; async_log_once; async_log_once = 0) \
+  ASYNC_LOG_IF(LEVEL,                                                                             \
+               []() -> fastotv::server::LogSiteLimiter* {                                         \
+                 static fastotv::server::LogSiteLimiter limiter(LIMIT);                           \
+                 return &limiter;                                                                 \
+               }()->Allow(&async_log_suppressed),                                                 \
+               async_log_suppressed)
+
+#define ASYNC_INFO_LOG_RATE_LIMITED(LIMIT) ASYNC_LOG_RATE_LIMITED(common::logging::LOG_LEVEL_INFO, LIMIT)
@@ -0,0 +1,119 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for intptr_t
+
+#include <atomic>
+#include <utility>  // for move
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+namespace server {
+
+// bounded lock-free queue, many producers (any thread) and one consumer (loop thread)
+// cells sequence based, capacity rounded up to power of two
+template <typename T>
+class BoundedMPSCQueue {
+ public:
+  explicit BoundedMPSCQueue(size_t capacity)
+      : buffer_(nullptr), mask_(RoundUpToPowerOfTwo(capacity) - 1), enqueue_pos_(0), dequeue_pos_(0) {
+    buffer_ = new Cell[mask_ + 1];
+    for (size_t i = 0; i <= mask_; ++i) {
+      buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~BoundedMPSCQueue() { delete[] buffer_; }
+
+  size_t GetCapacity() const { return mask_ + 1; }
+
+  // thread safe, false if queue is full
+  bool Push(T value) {
+    Cell* cell = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &buffer_[pos & mask_];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // only consumer thread, false if queue is empty
+  bool Pop(T* value) {
+    if (!value) {
+      return false;
+    }
+
+    Cell* cell = &buffer_[dequeue_pos_ & mask_];
+    const size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != dequeue_pos_ + 1) {
+      return false;
+    }
+
+    *value = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BoundedMPSCQueue);
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t capacity) {
+    size_t result = 2;
+    while (result < capacity) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  enum { cache_line_size = 64 };
+
+  Cell* buffer_;
+  const size_t mask_;
+  char pad0_[cache_line_size];  // producers and consumer positions on different cache lines
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[cache_line_size];
+  size_t dequeue_pos_;
+};
+
+}  // namespace server
+}  // namespace fastotv
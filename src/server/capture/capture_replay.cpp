@@ -0,0 +1,371 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/capture/capture_replay.h"
+
+#include <errno.h>       // for errno, EAGAIN
+#include <poll.h>        // for poll
+#include <string.h>      // for memcpy
+#include <sys/socket.h>  // for send, recv
+#include <unistd.h>      // for close
+
+#include <algorithm>  // for min
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <common/net/net.h>        // for connect
+#include <common/sys_byteorder.h>  // for HostToNet32
+
+#include "inner/inner_client.h"              // for InnerClient
+#include "server/capture/traffic_capture.h"  // for TrafficCaptureReader, ReplacePasswords
+
+namespace fastotv {
+namespace server {
+namespace capture {
+
+namespace {
+
+typedef fastotv::inner::InnerClient::protocoled_size_t protocoled_size_t;
+
+// request: name, responce: OK|FAIL name
+std::string GetCommandName(common::protocols::three_way_handshake::cmd_id_t seq, const std::string& cmd_str) {
+  std::istringstream fields(cmd_str);
+  std::string name;
+  if (seq == RESPONSE_COMMAND) {
+    fields >> name;
+  }
+  fields >> name;
+  return name;
+}
+
+}  // namespace
+
+ReplayStats::ReplayStats()
+    : frames(0), connections(0), connect_errors(0), server_frames(0), remapped(0), unmatched(0) {}
+
+CaptureReplay::Connection::Connection() : fd(-1), input(), server_requests(), outgoing() {}
+
+CaptureReplay::CaptureReplay(const common::net::HostAndPort& host, double speed)
+    : host_(host), speed_(speed), password_(), stop_(false), compressor_(), connections_(), stats_() {}
+
+CaptureReplay::~CaptureReplay() {
+  for (auto& connection : connections_) {
+    close(connection.second.fd);
+  }
+}
+
+common::ErrnoError CaptureReplay::Run(TrafficCaptureReader* reader) {
+  if (!reader) {
+    return common::make_errno_error_inval();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  CaptureRecord record;
+  while (!stop_ && reader->Next(&record)) {
+    if (speed_ > 0) {
+      const auto offset = std::chrono::microseconds(static_cast<int64_t>(record.timestamp_usec / speed_));
+      WaitUntil(start + offset);
+    } else {
+      Poll(0);
+    }
+
+    if (record.type == CaptureRecord::CLOSED) {
+      auto it = connections_.find(record.connection);
+      if (it != connections_.end() && !it->second.outgoing.empty()) {
+        it->second.outgoing.push_back({std::string(), std::chrono::steady_clock::time_point(), true});
+        continue;
+      }
+      CloseConnection(record.connection);
+      continue;
+    }
+
+    Connection* connection = FindOrConnect(record.connection);
+    if (!connection) {
+      continue;
+    }
+
+    if (!password_.empty()) {
+      ReplacePasswords(&record.frame, password_);
+    }
+
+    const auto wait_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(responce_wait_msec);
+    connection->outgoing.push_back({record.frame, wait_deadline, false});
+    FlushOutgoing(record.connection);
+  }
+
+  while (!stop_ && HaveOutgoing()) {  // responces still waiting for live requests
+    Poll(poll_timeout_msec);
+  }
+
+  while (!connections_.empty()) {
+    CloseConnection(connections_.begin()->first);
+  }
+  return common::ErrnoError();
+}
+
+void CaptureReplay::Stop() {
+  stop_ = true;
+}
+
+ReplayStats CaptureReplay::GetStats() const {
+  return stats_;
+}
+
+void CaptureReplay::SetPassword(const std::string& password) {
+  password_ = password;
+}
+
+CaptureReplay::Connection* CaptureReplay::FindOrConnect(uint32_t id) {
+  auto it = connections_.find(id);
+  if (it != connections_.end()) {
+    return &it->second;
+  }
+
+  common::net::socket_info client_info;
+  common::ErrnoError err = common::net::connect(host_, common::net::ST_SOCK_STREAM, nullptr, &client_info);
+  if (err) {
+    stats_.connect_errors++;
+    return nullptr;
+  }
+
+  stats_.connections++;
+  Connection& connection = connections_[id];
+  connection.fd = client_info.fd();
+  return &connection;
+}
+
+void CaptureReplay::CloseConnection(uint32_t id) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) {
+    return;
+  }
+
+  close(it->second.fd);
+  connections_.erase(it);
+}
+
+void CaptureReplay::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+  while (!stop_) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      Poll(0);
+      return;
+    }
+
+    const int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+    Poll(std::min<int64_t>(left, poll_timeout_msec));
+  }
+}
+
+void CaptureReplay::Poll(int timeout_msec) {
+  if (connections_.empty()) {
+    if (timeout_msec > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout_msec));
+    }
+    return;
+  }
+
+  std::vector<struct pollfd> pfds;
+  std::vector<uint32_t> ids;
+  for (const auto& connection : connections_) {
+    struct pollfd pfd;
+    pfd.fd = connection.second.fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    pfds.push_back(pfd);
+    ids.push_back(connection.first);
+  }
+
+  if (poll(pfds.data(), pfds.size(), timeout_msec) > 0) {
+    for (size_t i = 0; i < pfds.size(); ++i) {
+      if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+
+      auto it = connections_.find(ids[i]);
+      if (it != connections_.end() && !ReadConnection(&it->second)) {
+        CloseConnection(ids[i]);
+      }
+    }
+  }
+
+  FlushAllOutgoing();  // new live requests or expired waits
+}
+
+void CaptureReplay::FlushOutgoing(uint32_t id) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) {
+    return;
+  }
+
+  Connection* connection = &it->second;
+  while (!connection->outgoing.empty()) {
+    OutgoingFrame& out = connection->outgoing.front();
+    if (out.close) {
+      CloseConnection(id);
+      return;
+    }
+
+    if (!RemapResponce(connection, &out.frame)) {
+      if (std::chrono::steady_clock::now() < out.wait_deadline) {
+        return;
+      }
+      stats_.unmatched++;
+    }
+
+    common::ErrnoError err = SendFrame(connection, out.frame);
+    if (err) {
+      CloseConnection(id);
+      return;
+    }
+    stats_.frames++;
+    connection->outgoing.pop_front();
+  }
+}
+
+void CaptureReplay::FlushAllOutgoing() {
+  std::vector<uint32_t> ids;
+  for (const auto& connection : connections_) {
+    if (!connection.second.outgoing.empty()) {
+      ids.push_back(connection.first);
+    }
+  }
+
+  for (uint32_t id : ids) {
+    FlushOutgoing(id);
+  }
+}
+
+bool CaptureReplay::HaveOutgoing() const {
+  for (const auto& connection : connections_) {
+    if (!connection.second.outgoing.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CaptureReplay::ReadConnection(Connection* connection) {
+  char buff[read_buffer_size];
+  ssize_t res = recv(connection->fd, buff, sizeof(buff), MSG_DONTWAIT);
+  if (res == 0) {
+    return false;
+  }
+
+  if (res < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+
+  connection->input.append(buff, res);
+  while (connection->input.size() >= sizeof(protocoled_size_t)) {
+    protocoled_size_t size;
+    memcpy(&size, connection->input.data(), sizeof(protocoled_size_t));
+    size = common::NetToHost32(size);
+    if (size > fastotv::inner::InnerClient::MAX_COMMAND_SIZE) {
+      return false;
+    }
+
+    if (connection->input.size() < sizeof(protocoled_size_t) + size) {
+      break;
+    }
+
+    const common::char_buffer_t compressed =
+        MAKE_CHAR_BUFFER_SIZE(connection->input.data() + sizeof(protocoled_size_t), size);
+    connection->input.erase(0, sizeof(protocoled_size_t) + size);
+    common::char_buffer_t un_compressed;
+    common::Error err = compressor_.Decode(compressed, &un_compressed);
+    if (err) {
+      return false;
+    }
+    HandleServerFrame(connection, un_compressed.as_string());
+  }
+  return true;
+}
+
+void CaptureReplay::HandleServerFrame(Connection* connection, const std::string& frame) {
+  stats_.server_frames++;
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t id;
+  std::string cmd_str;
+  common::Error err = common::protocols::three_way_handshake::ParseCommand(frame, &seq, &id, &cmd_str);
+  if (err || seq != REQUEST_COMMAND) {
+    return;
+  }
+
+  connection->server_requests.push_back(std::make_pair(GetCommandName(seq, cmd_str), id));
+}
+
+bool CaptureReplay::RemapResponce(Connection* connection, std::string* frame) {
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t recorded_id;
+  std::string cmd_str;
+  common::Error err = common::protocols::three_way_handshake::ParseCommand(*frame, &seq, &recorded_id, &cmd_str);
+  if (err || seq != RESPONSE_COMMAND) {  // client requests and approves use client ids
+    return true;
+  }
+
+  const std::string name = GetCommandName(seq, cmd_str);
+  auto& requests = connection->server_requests;
+  for (auto req = requests.begin(); req != requests.end(); ++req) {
+    if (req->first != name) {
+      continue;
+    }
+
+    // [seq] [id] ..., id could also be part of payload
+    const size_t id_pos = frame->find(' ') + 1;
+    if (id_pos == 0 || frame->compare(id_pos, recorded_id.size(), recorded_id) != 0) {
+      stats_.unmatched++;
+      return true;
+    }
+
+    frame->replace(id_pos, recorded_id.size(), req->second);
+    requests.erase(req);
+    stats_.remapped++;
+    return true;
+  }
+  return false;
+}
+
+common::ErrnoError CaptureReplay::SendFrame(Connection* connection, const std::string& frame) {
+  common::char_buffer_t compressed;
+  common::Error err = compressor_.Encode(frame, &compressed);
+  if (err) {
+    return common::make_errno_error(err->GetDescription(), EINVAL);
+  }
+
+  const protocoled_size_t size = common::HostToNet32(compressed.size());
+  std::string data(reinterpret_cast<const char*>(&size), sizeof(protocoled_size_t));
+  data.append(compressed.data(), compressed.size());
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t res = send(connection->fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return common::make_errno_error("Replay send failed", errno);
+    }
+    written += res;
+  }
+  return common::ErrnoError();
+}
+
+}  // namespace capture
+}  // namespace server
+}  // namespace fastotv
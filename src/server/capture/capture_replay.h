@@ -0,0 +1,111 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint32_t, uint64_t
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>   // for string
+#include <utility>  // for pair
+
+#include <common/error.h>      // for ErrnoError
+#include <common/macros.h>     // for WARN_UNUSED_RESULT
+#include <common/net/types.h>  // for HostAndPort
+
+#include <common/text_decoders/compress_snappy_edcoder.h>  // for CompressSnappyEDcoder
+
+#include "commands/commands.h"  // for cmd_seq_t
+
+namespace fastotv {
+namespace server {
+namespace capture {
+
+class TrafficCaptureReader;
+
+struct ReplayStats {
+  ReplayStats();
+
+  uint64_t frames;
+  uint64_t connections;
+  uint64_t connect_errors;
+  uint64_t server_frames;
+  uint64_t remapped;   // responces sent with id of live server request
+  uint64_t unmatched;  // responces without live server request, sent as recorded
+};
+
+// drives server with captured connections and frames keeping interleaving, speed 2 is twice faster
+// responces to server requests get ids of live requests, matched by command name in order
+// responce waiting for its live request holds back only own connection, sent as recorded after responce_wait_msec
+class CaptureReplay {
+ public:
+  enum { poll_timeout_msec = 10, responce_wait_msec = 5000, read_buffer_size = 16 * 1024 };
+
+  CaptureReplay(const common::net::HostAndPort& host, double speed);  // speed 0 as fast as possible
+  ~CaptureReplay();
+
+  common::ErrnoError Run(TrafficCaptureReader* reader) WARN_UNUSED_RESULT;  // blocks until replayed or stopped
+  void Stop();                                                             // thread safe
+  ReplayStats GetStats() const;
+  void SetPassword(const std::string& password);  // for masked passwords of recorded logins, before Run
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(CaptureReplay);
+
+  struct OutgoingFrame {
+    std::string frame;
+    std::chrono::steady_clock::time_point wait_deadline;
+    bool close;  // recorded close after frames still waiting
+  };
+
+  struct Connection {
+    Connection();
+
+    int fd;
+    std::string input;
+    std::deque<std::pair<std::string, common::protocols::three_way_handshake::cmd_seq_t>> server_requests;
+    std::deque<OutgoingFrame> outgoing;  // in recorded order, front can wait for live server request
+  };
+
+  Connection* FindOrConnect(uint32_t id);
+  void CloseConnection(uint32_t id);
+  void WaitUntil(std::chrono::steady_clock::time_point deadline);
+  void Poll(int timeout_msec);
+  bool ReadConnection(Connection* connection);  // false if closed
+  void HandleServerFrame(Connection* connection, const std::string& frame);
+  void FlushOutgoing(uint32_t id);  // sends ready frames, connection can be closed
+  void FlushAllOutgoing();
+  bool HaveOutgoing() const;
+  bool RemapResponce(Connection* connection, std::string* frame);  // false if live request not received yet
+  common::ErrnoError SendFrame(Connection* connection, const std::string& frame) WARN_UNUSED_RESULT;
+
+  const common::net::HostAndPort host_;
+  const double speed_;
+  std::string password_;
+  std::atomic<bool> stop_;
+  common::CompressSnappyEDcoder compressor_;
+  std::map<uint32_t, Connection> connections_;
+  ReplayStats stats_;
+};
+
+}  // namespace capture
+}  // namespace server
+}  // namespace fastotv
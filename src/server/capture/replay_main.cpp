@@ -0,0 +1,121 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>  // for signal, SIGINT
+#include <stdio.h>   // for fprintf, stderr
+#include <stdlib.h>  // for exit, EXIT_FAILURE
+#include <unistd.h>  // for getopt, optarg
+
+#include <chrono>
+#include <string>  // for string
+
+#include <common/convert2string.h>  // for ConvertFromString
+#include <common/logger.h>          // for INIT_LOGGER
+
+#include "server/capture/capture_replay.h"   // for CaptureReplay
+#include "server/capture/traffic_capture.h"  // for TrafficCaptureReader
+
+namespace {
+
+fastotv::server::capture::CaptureReplay* replay = nullptr;
+
+void HandleStopSignal(int sig) {
+  UNUSED(sig);
+  if (replay) {
+    replay->Stop();
+  }
+}
+
+void PrintUsage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s -f capture file [-s host:port] [-x speed, 1 real time, 0 as fast as possible] "
+          "[-p password for all logins, captures keep them masked]\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  common::net::HostAndPort host("localhost", SERVICE_HOST_PORT);
+  std::string capture_path;
+  double speed = 1;
+  std::string password;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "f:s:x:p:")) != -1) {
+    bool res = true;
+    switch (opt) {
+      case 'f':
+        capture_path = optarg;
+        break;
+      case 's':
+        res = common::ConvertFromString(optarg, &host);
+        break;
+      case 'x':
+        res = common::ConvertFromString(optarg, &speed) && speed >= 0;
+        break;
+      case 'p':
+        password = optarg;
+        break;
+      default: /* '?' */
+        res = false;
+        break;
+    }
+    if (!res) {
+      PrintUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (capture_path.empty()) {
+    PrintUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  INIT_LOGGER(PROJECT_NAME_TITLE, common::logging::LOG_LEVEL_WARNING);
+  fastotv::server::capture::TrafficCaptureReader reader;
+  common::ErrnoError err = reader.Open(capture_path);
+  if (err) {
+    fprintf(stderr, "%s\n", err->GetDescription().c_str());
+    return EXIT_FAILURE;
+  }
+
+  fastotv::server::capture::CaptureReplay capture_replay(host, speed);
+  capture_replay.SetPassword(password);
+  replay = &capture_replay;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+
+  const auto start = std::chrono::steady_clock::now();
+  err = capture_replay.Run(&reader);
+  replay = nullptr;
+  if (err) {
+    fprintf(stderr, "%s\n", err->GetDescription().c_str());
+    return EXIT_FAILURE;
+  }
+
+  const double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const fastotv::server::capture::ReplayStats stats = capture_replay.GetStats();
+  printf(
+      "elapsed_sec: %.3f\nframes: %llu\nconnections: %llu\nconnect_errors: %llu\nserver_frames: %llu\n"
+      "remapped_responces: %llu\nunmatched_responces: %llu\n",
+      elapsed_sec, static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.connections),
+      static_cast<unsigned long long>(stats.connect_errors), static_cast<unsigned long long>(stats.server_frames),
+      static_cast<unsigned long long>(stats.remapped), static_cast<unsigned long long>(stats.unmatched));
+  return EXIT_SUCCESS;
+}
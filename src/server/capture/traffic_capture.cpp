@@ -0,0 +1,314 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/capture/traffic_capture.h"
+
+#include <errno.h>   // for errno
+#include <string.h>  // for memcpy, memcmp
+
+#include <utility>  // for move
+
+#include <common/logger.h>                  // for WARNING_LOG
+#include <common/sys_byteorder.h>           // for HostToNet32
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+namespace fastotv {
+namespace server {
+namespace capture {
+
+const char kCaptureMagic[8] = {'F', 'T', 'V', 'C', 'A', 'P', '0', '1'};
+const char kMaskedPassword[] = "***";
+
+CaptureRecord::CaptureRecord() : type(FRAME), timestamp_usec(0), connection(0), frame() {}
+
+CaptureRecord::CaptureRecord(Type type, uint64_t timestamp_usec, uint32_t connection, const std::string& frame)
+    : type(type), timestamp_usec(timestamp_usec), connection(connection), frame(frame) {}
+
+bool CaptureRecord::Equals(const CaptureRecord& record) const {
+  return type == record.type && timestamp_usec == record.timestamp_usec && connection == record.connection &&
+         frame == record.frame;
+}
+
+std::string EncodeCaptureRecord(const CaptureRecord& record) {
+  const uint64_t timestamp = common::HostToNet64(record.timestamp_usec);
+  const uint32_t connection = common::HostToNet32(record.connection);
+  const uint32_t size = common::HostToNet32(record.frame.size());
+
+  std::string result(CaptureRecord::header_size, 0);
+  result[0] = static_cast<char>(record.type);
+  memcpy(&result[1], &timestamp, sizeof(timestamp));
+  memcpy(&result[9], &connection, sizeof(connection));
+  memcpy(&result[13], &size, sizeof(size));
+  result += record.frame;
+  return result;
+}
+
+bool ReplacePasswords(std::string* frame, const std::string& password) {
+  static const std::string key = "\"password\"";
+  bool replaced = false;
+  size_t pos = 0;
+  while ((pos = frame->find(key, pos)) != std::string::npos) {
+    pos = frame->find_first_not_of(" \t", pos + key.size());
+    if (pos == std::string::npos || (*frame)[pos] != ':') {
+      continue;
+    }
+
+    pos = frame->find_first_not_of(" \t", pos + 1);
+    if (pos == std::string::npos || (*frame)[pos] != '"') {
+      continue;
+    }
+
+    const size_t value_start = pos + 1;
+    size_t value_end = value_start;
+    while (value_end < frame->size() && (*frame)[value_end] != '"') {
+      value_end += (*frame)[value_end] == '\\' ? 2 : 1;
+    }
+    if (value_end >= frame->size()) {  // truncated
+      return replaced;
+    }
+
+    frame->replace(value_start, value_end - value_start, password);
+    pos = value_start + password.size() + 1;
+    replaced = true;
+  }
+  return replaced;
+}
+
+TrafficCapture::TrafficCapture(const std::string& path)
+    : path_(path),
+      file_(nullptr),
+      queue_(nullptr),
+      thread_(),
+      started_(false),
+      dropped_(0),
+      start_time_(),
+      connections_mutex_(),
+      connections_(),
+      next_connection_(0),
+      stop_mutex_(),
+      stop_cond_(),
+      stop_(false) {}
+
+TrafficCapture::~TrafficCapture() {
+  Stop();
+  delete queue_;
+}
+
+common::ErrnoError TrafficCapture::Start(size_t queue_size) {
+  if (started_ || thread_) {
+    return common::make_errno_error("Capture already started", EINVAL);
+  }
+
+  file_ = fopen(path_.c_str(), "wb");
+  if (!file_) {
+    return common::make_errno_error("Can't open capture file: " + path_, errno);
+  }
+
+  if (fwrite(kCaptureMagic, sizeof(kCaptureMagic), 1, file_) != 1) {
+    const int err = errno;
+    fclose(file_);
+    file_ = nullptr;
+    return common::make_errno_error("Can't write capture file: " + path_, err);
+  }
+
+  if (!queue_) {
+    queue_ = new BoundedMPSCQueue<std::string>(queue_size);
+  }
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_ = false;
+  }
+
+  start_time_ = std::chrono::steady_clock::now();
+  thread_ = THREAD_MANAGER()->CreateThread(&TrafficCapture::Run, this);
+  if (!thread_->Start()) {
+    thread_.reset();
+    fclose(file_);
+    file_ = nullptr;
+    return common::make_errno_error("Can't start capture thread", EAGAIN);
+  }
+
+  started_ = true;
+  return common::ErrnoError();
+}
+
+void TrafficCapture::Stop() {
+  if (!thread_) {
+    return;
+  }
+
+  started_ = false;
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_ = true;
+    stop_cond_.notify_all();
+  }
+  thread_->Join();
+  thread_.reset();
+  Drain();
+  fclose(file_);
+  file_ = nullptr;
+
+  const uint64_t dropped = dropped_.exchange(0);
+  if (dropped) {
+    WARNING_LOG() << "Traffic capture dropped records: " << dropped;
+  }
+}
+
+void TrafficCapture::RecordFrame(const void* connection, const std::string& frame) {
+  if (!started_) {
+    return;
+  }
+
+  uint32_t id;
+  {
+    std::unique_lock<std::mutex> lock(connections_mutex_);
+    auto it = connections_.find(connection);
+    if (it == connections_.end()) {
+      it = connections_.insert(std::make_pair(connection, next_connection_++)).first;
+    }
+    id = it->second;
+  }
+
+  std::string masked = frame;
+  ReplacePasswords(&masked, kMaskedPassword);
+  Post(CaptureRecord::FRAME, id, masked);
+}
+
+void TrafficCapture::RecordClosed(const void* connection) {
+  if (!started_) {
+    return;
+  }
+
+  uint32_t id;
+  {
+    std::unique_lock<std::mutex> lock(connections_mutex_);
+    auto it = connections_.find(connection);
+    if (it == connections_.end()) {  // nothing received
+      return;
+    }
+    id = it->second;
+    connections_.erase(it);
+  }
+  Post(CaptureRecord::CLOSED, id, std::string());
+}
+
+uint64_t TrafficCapture::GetDroppedCount() const {
+  return dropped_;
+}
+
+void TrafficCapture::Post(CaptureRecord::Type type, uint32_t connection, const std::string& frame) {
+  const uint64_t timestamp =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time_).count();
+  if (!queue_->Push(EncodeCaptureRecord(CaptureRecord(type, timestamp, connection, frame)))) {
+    dropped_++;
+  }
+}
+
+void TrafficCapture::Run() {
+  uint64_t reported_dropped = 0;
+  while (true) {
+    Drain();
+
+    const uint64_t dropped = dropped_;
+    if (dropped != reported_dropped) {
+      WARNING_LOG() << "Traffic capture queue is full, dropped records: " << dropped - reported_dropped;
+      reported_dropped = dropped;
+    }
+
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    if (stop_cond_.wait_for(lock, std::chrono::milliseconds(drain_interval_msec), [this]() { return stop_; })) {
+      break;
+    }
+  }
+  dropped_ -= reported_dropped;
+}
+
+void TrafficCapture::Drain() {
+  std::string record;
+  bool written = false;
+  while (queue_->Pop(&record)) {
+    if (fwrite(record.data(), record.size(), 1, file_) != 1) {
+      dropped_++;
+    }
+    written = true;
+  }
+  if (written) {
+    fflush(file_);
+  }
+}
+
+TrafficCaptureReader::TrafficCaptureReader() : file_(nullptr) {}
+
+TrafficCaptureReader::~TrafficCaptureReader() {
+  if (file_) {
+    fclose(file_);
+  }
+}
+
+common::ErrnoError TrafficCaptureReader::Open(const std::string& path) {
+  if (file_) {
+    fclose(file_);
+  }
+
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_) {
+    return common::make_errno_error("Can't open capture file: " + path, errno);
+  }
+
+  char magic[sizeof(kCaptureMagic)];
+  if (fread(magic, sizeof(magic), 1, file_) != 1 || memcmp(magic, kCaptureMagic, sizeof(magic)) != 0) {
+    fclose(file_);
+    file_ = nullptr;
+    return common::make_errno_error("Not a capture file: " + path, EINVAL);
+  }
+  return common::ErrnoError();
+}
+
+bool TrafficCaptureReader::Next(CaptureRecord* record) {
+  if (!file_ || !record) {
+    return false;
+  }
+
+  char header[CaptureRecord::header_size];
+  if (fread(header, sizeof(header), 1, file_) != 1) {
+    return false;
+  }
+
+  uint64_t timestamp;
+  uint32_t connection;
+  uint32_t size;
+  memcpy(&timestamp, &header[1], sizeof(timestamp));
+  memcpy(&connection, &header[9], sizeof(connection));
+  memcpy(&size, &header[13], sizeof(size));
+
+  std::string frame(common::NetToHost32(size), 0);
+  if (!frame.empty() && fread(&frame[0], frame.size(), 1, file_) != 1) {
+    return false;
+  }
+
+  record->type = static_cast<CaptureRecord::Type>(header[0]);
+  record->timestamp_usec = common::NetToHost64(timestamp);
+  record->connection = common::NetToHost32(connection);
+  record->frame = std::move(frame);
+  return true;
+}
+
+}  // namespace capture
+}  // namespace server
+}  // namespace fastotv
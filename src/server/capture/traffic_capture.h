@@ -0,0 +1,137 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t, uint32_t
+#include <stdio.h>   // for FILE
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <string>  // for string
+#include <unordered_map>
+
+#include <common/error.h>   // for ErrnoError
+#include <common/macros.h>  // for WARN_UNUSED_RESULT
+
+#include "server/bounded_mpsc_queue.h"  // for BoundedMPSCQueue
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+namespace capture {
+
+// file: magic, records
+// record: [uint8_t]type [uint64_t]timestamp usec since capture start [uint32_t]connection [uint32_t]size [size]frame
+// integers in network byte order, frames decoded (not compressed) inner commands
+struct CaptureRecord {
+  enum Type : uint8_t { FRAME = 0, CLOSED = 1 };
+  enum { header_size = 17 };
+
+  CaptureRecord();
+  CaptureRecord(Type type, uint64_t timestamp_usec, uint32_t connection, const std::string& frame);
+
+  bool Equals(const CaptureRecord& record) const;
+
+  Type type;
+  uint64_t timestamp_usec;
+  uint32_t connection;
+  std::string frame;
+};
+
+inline bool operator==(const CaptureRecord& left, const CaptureRecord& right) {
+  return left.Equals(right);
+}
+
+extern const char kCaptureMagic[8];
+
+std::string EncodeCaptureRecord(const CaptureRecord& record);
+
+extern const char kMaskedPassword[];
+
+// values of all "password" json fields in frame replaced, false if frame has none
+bool ReplacePasswords(std::string* frame, const std::string& password);
+
+// inbound frames of all connections, records encoded on caller thread, written by background thread
+// passwords (who_are_you) masked before recording, replay substitutes them
+class TrafficCapture {
+ public:
+  enum { default_queue_size = 65536, drain_interval_msec = 10 };
+
+  explicit TrafficCapture(const std::string& path);
+  ~TrafficCapture();
+
+  common::ErrnoError Start(size_t queue_size = default_queue_size) WARN_UNUSED_RESULT;  // truncates file
+  void Stop();  // writes pending records, call after producers stopped
+
+  // thread safe, connection is only key, ids assigned on first frame, dropped if queue is full
+  void RecordFrame(const void* connection, const std::string& frame);
+  void RecordClosed(const void* connection);
+  uint64_t GetDroppedCount() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TrafficCapture);
+
+  void Post(CaptureRecord::Type type, uint32_t connection, const std::string& frame);
+  void Run();
+  void Drain();
+
+  const std::string path_;
+  FILE* file_;
+  BoundedMPSCQueue<std::string>* queue_;
+  std::shared_ptr<common::threads::Thread<void>> thread_;
+  std::atomic<bool> started_;
+  std::atomic<uint64_t> dropped_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  std::mutex connections_mutex_;
+  std::unordered_map<const void*, uint32_t> connections_;
+  uint32_t next_connection_;
+
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cond_;
+  bool stop_;
+};
+
+class TrafficCaptureReader {
+ public:
+  TrafficCaptureReader();
+  ~TrafficCaptureReader();
+
+  common::ErrnoError Open(const std::string& path) WARN_UNUSED_RESULT;
+  bool Next(CaptureRecord* record);  // false on end of file or truncated record
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TrafficCaptureReader);
+
+  FILE* file_;
+};
+
+}  // namespace capture
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,289 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/chat_message_scanner.h"
+
+#include <stdlib.h>  // for strtol
+#include <string.h>  // for memcmp, memcpy
+
+#define CHAT_MESSAGE_CHANNEL_ID_FIELD "channel_id"
+#define CHAT_MESSAGE_LOGIN_FIELD "login"
+#define CHAT_MESSAGE_MESSAGE_FIELD "message"
+#define CHAT_MESSAGE_TYPE_FIELD "type"
+
+namespace fastotv {
+namespace server {
+
+namespace {
+
+class Scanner {
+ public:
+  Scanner(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+  void SkipSpaces() {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')) {
+      pos_++;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipSpaces();
+    if (pos_ == end_ || *pos_ != c) {
+      return false;
+    }
+    pos_++;
+    return true;
+  }
+
+  bool IsEnd() {
+    SkipSpaces();
+    return pos_ == end_;
+  }
+
+  // content without quotes, escapes validated not decoded
+  bool ScanString(const char** str, size_t* size, bool* escaped) {
+    if (!Consume('"')) {
+      return false;
+    }
+
+    const char* start = pos_;
+    *escaped = false;
+    while (pos_ != end_) {
+      const unsigned char c = *pos_;
+      if (c == '"') {
+        *str = start;
+        *size = pos_ - start;
+        pos_++;
+        return true;
+      }
+      if (c < 0x20) {
+        return false;
+      }
+      if (c == '\\') {
+        *escaped = true;
+        if (!SkipEscape()) {
+          return false;
+        }
+        continue;
+      }
+      pos_++;
+    }
+    return false;
+  }
+
+  bool ScanInteger(long* value) {
+    SkipSpaces();
+    const char* start = pos_;
+    if (!SkipInteger()) {
+      return false;
+    }
+
+    char buff[16] = {0};
+    const size_t len = pos_ - start;
+    if (len > sizeof(buff) - 1) {
+      return false;
+    }
+    memcpy(buff, start, len);
+
+    char* num_end = nullptr;
+    *value = strtol(buff, &num_end, 10);
+    return *num_end == '\0';
+  }
+
+  // other fields, only strings, numbers and literals, nested values not supported
+  bool SkipValue() {
+    SkipSpaces();
+    if (pos_ == end_) {
+      return false;
+    }
+
+    if (*pos_ == '"') {
+      const char* str;
+      size_t size;
+      bool escaped;
+      return ScanString(&str, &size, &escaped);
+    }
+
+    if (*pos_ == '-' || IsDigit(*pos_)) {
+      return SkipNumber();
+    }
+
+    return SkipLiteral("true", 4) || SkipLiteral("false", 5) || SkipLiteral("null", 4);
+  }
+
+ private:
+  // -?(0|[1-9][0-9]*), no leading zeros
+  bool SkipInteger() {
+    if (pos_ != end_ && *pos_ == '-') {
+      pos_++;
+    }
+    if (pos_ == end_ || !IsDigit(*pos_)) {
+      return false;
+    }
+    if (*pos_++ == '0') {
+      return true;
+    }
+    SkipDigits();
+    return true;
+  }
+
+  bool SkipNumber() {
+    if (!SkipInteger()) {
+      return false;
+    }
+
+    if (pos_ != end_ && *pos_ == '.') {
+      pos_++;
+      if (!SkipDigits()) {
+        return false;
+      }
+    }
+
+    if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+      pos_++;
+      if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+        pos_++;
+      }
+      if (!SkipDigits()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool SkipDigits() {  // false if none
+    const char* start = pos_;
+    while (pos_ != end_ && IsDigit(*pos_)) {
+      pos_++;
+    }
+    return pos_ != start;
+  }
+
+  bool SkipLiteral(const char* literal, size_t size) {
+    if (static_cast<size_t>(end_ - pos_) < size || memcmp(pos_, literal, size) != 0) {
+      return false;
+    }
+    pos_ += size;
+    return true;
+  }
+
+  bool SkipEscape() {
+    pos_++;  // backslash
+    if (pos_ == end_) {
+      return false;
+    }
+
+    const char c = *pos_++;
+    if (c == 'u') {
+      for (size_t i = 0; i < 4; ++i, ++pos_) {
+        if (pos_ == end_ || !IsHex(*pos_)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    return c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't';
+  }
+
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+  static bool IsHex(char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+
+  const char* pos_;
+  const char* const end_;
+};
+
+bool IsKey(const char* key, size_t size, const char* expected, size_t expected_size) {
+  return size == expected_size && memcmp(key, expected, size) == 0;
+}
+
+#define IS_KEY(key, size, field) IsKey(key, size, field, sizeof(field) - 1)
+
+}  // namespace
+
+ChatMessageHeader::ChatMessageHeader()
+    : channel(), login(), type(ChatMessage::CONTROL), message_size(0), message_escaped(false) {}
+
+bool ScanChatMessage(const char* data, size_t size, ChatMessageHeader* header) {
+  if (!data || !header) {
+    return false;
+  }
+
+  Scanner scanner(data, size);
+  if (!scanner.Consume('{')) {
+    return false;
+  }
+
+  ChatMessageHeader result;
+  bool have_message = false;
+  if (!scanner.Consume('}')) {
+    do {
+      const char* key;
+      size_t key_size;
+      bool escaped;
+      if (!scanner.ScanString(&key, &key_size, &escaped) || escaped || !scanner.Consume(':')) {
+        return false;
+      }
+
+      const char* value;
+      size_t value_size;
+      if (IS_KEY(key, key_size, CHAT_MESSAGE_CHANNEL_ID_FIELD) || IS_KEY(key, key_size, CHAT_MESSAGE_LOGIN_FIELD)) {
+        if (!scanner.ScanString(&value, &value_size, &escaped) || escaped) {  // ids compared as is
+          return false;
+        }
+        std::string* field = IS_KEY(key, key_size, CHAT_MESSAGE_LOGIN_FIELD) ? &result.login : &result.channel;
+        field->assign(value, value_size);
+      } else if (IS_KEY(key, key_size, CHAT_MESSAGE_MESSAGE_FIELD)) {
+        if (!scanner.ScanString(&value, &value_size, &escaped)) {
+          return false;
+        }
+        result.message_size = value_size;
+        result.message_escaped = escaped;
+        have_message = true;
+      } else if (IS_KEY(key, key_size, CHAT_MESSAGE_TYPE_FIELD)) {
+        long type;
+        if (!scanner.ScanInteger(&type)) {
+          return false;
+        }
+        if (type != ChatMessage::CONTROL && type != ChatMessage::MESSAGE) {
+          return false;
+        }
+        result.type = static_cast<ChatMessage::Type>(type);
+      } else if (!scanner.SkipValue()) {
+        return false;
+      }
+    } while (scanner.Consume(','));
+
+    if (!scanner.Consume('}')) {
+      return false;
+    }
+  }
+
+  if (!scanner.IsEnd()) {
+    return false;
+  }
+
+  if (result.channel == invalid_stream_id || result.login.empty() || !have_message || result.message_size == 0) {
+    return false;
+  }
+
+  *header = result;
+  return true;
+}
+
+}  // namespace server
+}  // namespace fastotv
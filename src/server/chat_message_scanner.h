@@ -0,0 +1,45 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include "client_server_types.h"  // for stream_id, login_t
+
+#include "commands_info/chat_message.h"  // for ChatMessage::Type
+
+namespace fastotv {
+namespace server {
+
+struct ChatMessageHeader {
+  ChatMessageHeader();
+
+  stream_id channel;
+  login_t login;
+  ChatMessage::Type type;
+  size_t message_size;   // as on wire, never less than decoded size
+  bool message_escaped;  // if false message_size is decoded size
+};
+
+// relay fast path, checks only fields needed to route message without building json tree
+// false if not flat object with plain strings or fields invalid, full parse should decide then
+bool ScanChatMessage(const char* data, size_t size, ChatMessageHeader* header);
+
+}  // namespace server
+}  // namespace fastotv
@@ -38,6 +38,12 @@
 #define SERVER_SEND_CHAT_MESSAGE_REQ_1E GENERATE_REQUEST_FMT_ARGS(SERVER_SEND_CHAT_MESSAGE, "'%s'")
 #define SERVER_SEND_CHAT_MESSAGE_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(SERVER_SEND_CHAT_MESSAGE, "'%s'")
 #define SERVER_SEND_CHAT_MESSAGE_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(SERVER_SEND_CHAT_MESSAGE, "")
+#define SERVER_SEND_CHAT_MESSAGES_REQ_1E GENERATE_REQUEST_FMT_ARGS(SERVER_SEND_CHAT_MESSAGES, "'%s'")
+#define SERVER_SEND_CHAT_MESSAGES_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(SERVER_SEND_CHAT_MESSAGES, "")
+
+// presence
+#define SERVER_PRESENCE_REQ_1E GENERATE_REQUEST_FMT_ARGS(SERVER_PRESENCE, "'%s'")
+#define SERVER_PRESENCE_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(SERVER_PRESENCE, "")
 
 // responces
 // get_server_info
@@ -109,6 +115,45 @@ common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessageAppro
                                                                      error_text);
 }
 
+serializet_t MakeChatMessagesBatch(const std::vector<serializet_t>& msgs) {
+  size_t size = msgs.size() + 2;
+  for (const serializet_t& msg : msgs) {
+    size += msg.size();
+  }
+
+  serializet_t batch;
+  batch.reserve(size);
+  batch += '[';
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    if (i) {
+      batch += ',';
+    }
+    batch += msgs[i];
+  }
+  batch += ']';
+  return batch;
+}
+
+common::protocols::three_way_handshake::cmd_request_t ServerSendChatMessagesRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& msgs) {
+  return common::protocols::three_way_handshake::MakeRequest(id, SERVER_SEND_CHAT_MESSAGES_REQ_1E, msgs);
+}
+common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessagesApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id) {
+  return common::protocols::three_way_handshake::MakeApproveResponse(id, SERVER_SEND_CHAT_MESSAGES_APPROVE_SUCCESS);
+}
+
+common::protocols::three_way_handshake::cmd_request_t ServerPresenceRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& presence) {
+  return common::protocols::three_way_handshake::MakeRequest(id, SERVER_PRESENCE_REQ_1E, presence);
+}
+common::protocols::three_way_handshake::cmd_approve_t ServerPresenceApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id) {
+  return common::protocols::three_way_handshake::MakeApproveResponse(id, SERVER_PRESENCE_APPROVE_SUCCESS);
+}
+
 common::protocols::three_way_handshake::cmd_request_t PingRequest(
     common::protocols::three_way_handshake::cmd_seq_t id) {
   return common::protocols::three_way_handshake::MakeRequest(id, SERVER_PING_REQ);
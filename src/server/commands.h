@@ -19,6 +19,7 @@
 #pragma once
 
 #include <string>  // for string
+#include <vector>  // for vector
 
 #include "client_server_types.h"
 
@@ -64,6 +65,21 @@ common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessageAppro
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text);
 
+// send_chat_messages server, msgs is json array of serialized chat messages
+serializet_t MakeChatMessagesBatch(const std::vector<serializet_t>& msgs);
+common::protocols::three_way_handshake::cmd_request_t ServerSendChatMessagesRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& msgs);
+common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessagesApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id);
+
+// presence server
+common::protocols::three_way_handshake::cmd_request_t ServerPresenceRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& presence);
+common::protocols::three_way_handshake::cmd_approve_t ServerPresenceApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id);
+
 // responces
 // get_server_info
 common::protocols::three_way_handshake::cmd_response_t GetServerInfoResponceSuccsess(
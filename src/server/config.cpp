@@ -20,13 +20,22 @@
 
 #include <string.h>  // for strcmp
 
-#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+#include <common/convert2string.h>  // for ConvertFromString
+#include <common/logger.h>          // for COMPACT_LOG_WARNING, WARNING_LOG
 
 #include "inih/ini.h"
 
 #define CHANNEL_COMMANDS_IN_NAME "COMMANDS_IN"
 #define CHANNEL_COMMANDS_OUT_NAME "COMMANDS_OUT"
 #define CHANNEL_CLIENTS_STATE_NAME "CLIENTS_STATE"
+#define STREAM_COMMANDS_IN_NAME "COMMANDS_IN_STREAM"
+#define STREAM_COMMANDS_OUT_NAME "COMMANDS_OUT_STREAM"
+#define STREAM_COMMANDS_GROUP_NAME "fastotv_servers"
+#define DEVICES_REGISTRY_NAME "DEVICES_REGISTRY"
+#define CHANNEL_DEVICES_REGISTRY_NAME "DEVICES_REGISTRY_CHANGES"
+#define CHANNEL_NODE_PREFIX_NAME "COMMANDS_IN_NODE_"
+#define CHANNEL_CHAT_PREFIX_NAME "CHAT_"
+#define WATCHERS_PREFIX_NAME "WATCHERS_"
 
 #define CONFIG_SERVER_OPTIONS "server"
 #define CONFIG_SERVER_OPTIONS_HOST_FIELD "host"
@@ -35,14 +44,58 @@
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_IN_FIELD "redis_channel_in_name"
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_OUT_FIELD "redis_channel_out_name"
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_STATUS_FIELD "redis_channel_clients_state_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_USE_STREAMS_FIELD "redis_use_streams"
+#define CONFIG_SERVER_OPTIONS_REDIS_STREAM_IN_FIELD "redis_stream_in_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_STREAM_OUT_FIELD "redis_stream_out_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_STREAM_GROUP_FIELD "redis_stream_group_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_STREAM_CONSUMER_FIELD "redis_stream_consumer_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_DEVICES_REGISTRY_FIELD "redis_devices_registry_name"
 #define CONFIG_SERVER_OPTIONS_BANDWIDT_SERVER_FIELD "bandwidth_server"
+#define CONFIG_SERVER_OPTIONS_NODE_ID_FIELD "node_id"
+#define CONFIG_SERVER_OPTIONS_IO_LOOPS_FIELD "io_loops"
+#define CONFIG_SERVER_OPTIONS_WORKER_THREADS_FIELD "worker_threads"
+#define CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD "metrics_server"
+#define CONFIG_SERVER_OPTIONS_LOOP_STALL_THRESHOLD_FIELD "loop_stall_threshold_msec"
+#define CONFIG_SERVER_OPTIONS_TRACE_BUFFER_SIZE_FIELD "trace_buffer_size"
+#define CONFIG_SERVER_OPTIONS_CAPTURE_FILE_FIELD "capture_file"
+#define CONFIG_SERVER_OPTIONS_ACCEPT_BACKLOG_FIELD "accept_backlog"
+#define CONFIG_SERVER_OPTIONS_MAX_CONNECTIONS_FIELD "max_connections"
+#define CONFIG_SERVER_OPTIONS_ACCEPT_RATE_FIELD "accept_rate"
+#define CONFIG_SERVER_OPTIONS_HANDSHAKE_TIMEOUT_FIELD "handshake_timeout_sec"
+#define CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_FIELD "rate_limit_chat"
+#define CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_LOGIN_FIELD "rate_limit_chat_login"
+#define CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_FIELD "rate_limit_channels"
+#define CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_LOGIN_FIELD "rate_limit_channels_login"
+#define CONFIG_SERVER_OPTIONS_CHAT_BATCH_WINDOW_FIELD "chat_batch_window_msec"
+#define CONFIG_SERVER_OPTIONS_PRESENCE_INTERVAL_FIELD "presence_interval_msec"
+#define CONFIG_SERVER_OPTIONS_PRESENCE_JOIN_SAMPLE_FIELD "presence_join_sample"
 
 /*
   [server]
   host=fastotv.com:7040
   redis_server=localhost:6379
   redis_unix_path=/var/run/redis/redis.sock
+  redis_use_streams=false
+  redis_stream_consumer_name=node1
   bandwidth_server=localhost:5544
+  node_id=node1
+  io_loops=4
+  worker_threads=2
+  metrics_server=localhost:8070
+  loop_stall_threshold_msec=1000
+  trace_buffer_size=0
+  capture_file=/tmp/fastotv.cap
+  accept_backlog=1024
+  max_connections=100000
+  accept_rate=2000
+  handshake_timeout_sec=10
+  rate_limit_chat=1/5
+  rate_limit_chat_login=2/10
+  rate_limit_channels=0.2/3
+  rate_limit_channels_login=0.5/6
+  chat_batch_window_msec=5
+  presence_interval_msec=2000
+  presence_join_sample=100
 */
 
 namespace fastotv {
@@ -82,6 +135,29 @@ int ini_handler_fasto(void* user_data, const char* section, const char* name, co
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_STATUS_FIELD)) {
     pconfig->server.redis.channel_clients_state = value;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_USE_STREAMS_FIELD)) {
+    bool use_streams;
+    if (!common::ConvertFromString(value, &use_streams)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_REDIS_USE_STREAMS_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.redis.use_streams = use_streams;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_STREAM_IN_FIELD)) {
+    pconfig->server.redis.stream_in = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_STREAM_OUT_FIELD)) {
+    pconfig->server.redis.stream_out = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_STREAM_GROUP_FIELD)) {
+    pconfig->server.redis.stream_group = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_STREAM_CONSUMER_FIELD)) {
+    pconfig->server.redis.stream_consumer = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_DEVICES_REGISTRY_FIELD)) {
+    pconfig->server.redis.devices_registry = value;
+    return 1;
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_BANDWIDT_SERVER_FIELD)) {
     common::net::HostAndPort hs;
     bool res = common::ConvertFromString(value, &hs);
@@ -91,13 +167,159 @@ int ini_handler_fasto(void* user_data, const char* section, const char* name, co
     }
     pconfig->server.bandwidth_host = hs;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_NODE_ID_FIELD)) {
+    pconfig->server.node_id = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_IO_LOOPS_FIELD)) {
+    size_t io_loops;
+    if (!common::ConvertFromString(value, &io_loops) || io_loops == 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_IO_LOOPS_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.io_loops = io_loops;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_WORKER_THREADS_FIELD)) {
+    size_t worker_threads;
+    if (!common::ConvertFromString(value, &worker_threads)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_WORKER_THREADS_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.worker_threads = worker_threads;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD)) {
+    common::net::HostAndPort hs;
+    bool res = common::ConvertFromString(value, &hs);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.metrics_host = hs;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_LOOP_STALL_THRESHOLD_FIELD)) {
+    uint32_t threshold;
+    if (!common::ConvertFromString(value, &threshold)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_LOOP_STALL_THRESHOLD_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.loop_stall_threshold_msec = threshold;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_TRACE_BUFFER_SIZE_FIELD)) {
+    size_t trace_buffer_size;
+    if (!common::ConvertFromString(value, &trace_buffer_size)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_TRACE_BUFFER_SIZE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.trace_buffer_size = trace_buffer_size;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_CAPTURE_FILE_FIELD)) {
+    pconfig->server.capture_path = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_ACCEPT_BACKLOG_FIELD)) {
+    int backlog;
+    if (!common::ConvertFromString(value, &backlog) || backlog <= 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_ACCEPT_BACKLOG_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.accept_backlog = backlog;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_MAX_CONNECTIONS_FIELD)) {
+    size_t max_connections;
+    if (!common::ConvertFromString(value, &max_connections)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_MAX_CONNECTIONS_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.max_connections = max_connections;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_ACCEPT_RATE_FIELD)) {
+    size_t accept_rate;
+    if (!common::ConvertFromString(value, &accept_rate)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_ACCEPT_RATE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.accept_rate = accept_rate;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_HANDSHAKE_TIMEOUT_FIELD)) {
+    uint32_t timeout;
+    if (!common::ConvertFromString(value, &timeout)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_HANDSHAKE_TIMEOUT_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.handshake_timeout_sec = timeout;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_FIELD)) {
+    if (!ParseRateLimit(value, &pconfig->server.rate_limits[CHAT_RATE_LIMIT])) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_FIELD " value: " << value;
+      return 0;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_LOGIN_FIELD)) {
+    if (!ParseRateLimit(value, &pconfig->server.login_rate_limits[CHAT_RATE_LIMIT])) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHAT_LOGIN_FIELD " value: " << value;
+      return 0;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_FIELD)) {
+    if (!ParseRateLimit(value, &pconfig->server.rate_limits[CHANNELS_RATE_LIMIT])) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_FIELD " value: " << value;
+      return 0;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_LOGIN_FIELD)) {
+    if (!ParseRateLimit(value, &pconfig->server.login_rate_limits[CHANNELS_RATE_LIMIT])) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_RATE_LIMIT_CHANNELS_LOGIN_FIELD " value: " << value;
+      return 0;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_CHAT_BATCH_WINDOW_FIELD)) {
+    uint32_t window;
+    if (!common::ConvertFromString(value, &window)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_CHAT_BATCH_WINDOW_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.chat_batch_window_msec = window;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_PRESENCE_INTERVAL_FIELD)) {
+    uint32_t interval;
+    if (!common::ConvertFromString(value, &interval)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_PRESENCE_INTERVAL_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.presence_interval_msec = interval;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_PRESENCE_JOIN_SAMPLE_FIELD)) {
+    uint32_t sample;
+    if (!common::ConvertFromString(value, &sample)) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_PRESENCE_JOIN_SAMPLE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.presence_join_sample = sample;
+    return 1;
   } else {
     return 0; /* unknown section/name, error */
   }
 }
 }  // namespace
 
-ServerSettings::ServerSettings() : host(), redis(), bandwidth_host() {
+ServerSettings::ServerSettings()
+    : host(),
+      redis(),
+      bandwidth_host(),
+      node_id(),
+      io_loops(1),
+      worker_threads(2),
+      metrics_host(),
+      loop_stall_threshold_msec(1000),
+      trace_buffer_size(0),
+      capture_path(),
+      accept_backlog(128),
+      max_connections(0),
+      accept_rate(0),
+      handshake_timeout_sec(10),
+      rate_limits(),
+      login_rate_limits(),
+      chat_batch_window_msec(0),
+      presence_interval_msec(0),
+      presence_join_sample(0) {
   // in config by default
   // redis.redis_host = redis_default_host;
   // redis.redis_unix_socket = redis_default_unix_path;
@@ -106,6 +328,17 @@ ServerSettings::ServerSettings() : host(), redis(), bandwidth_host() {
   redis.channel_out = CHANNEL_COMMANDS_OUT_NAME;
   redis.channel_clients_state = CHANNEL_CLIENTS_STATE_NAME;
 
+  redis.use_streams = false;
+  redis.stream_in = STREAM_COMMANDS_IN_NAME;
+  redis.stream_out = STREAM_COMMANDS_OUT_NAME;
+  redis.stream_group = STREAM_COMMANDS_GROUP_NAME;
+
+  redis.devices_registry = DEVICES_REGISTRY_NAME;
+  redis.channel_devices_registry = CHANNEL_DEVICES_REGISTRY_NAME;
+  redis.channel_node_prefix = CHANNEL_NODE_PREFIX_NAME;
+  redis.channel_chat_prefix = CHANNEL_CHAT_PREFIX_NAME;
+  redis.watchers_prefix = WATCHERS_PREFIX_NAME;
+
   // bandwidth_host = bandwidth_default_host;
 }
 
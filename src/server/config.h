@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stdint.h>  // for uint32_t
+
 #include <string>  // for string
 
 #include <common/error.h>      // for Error
@@ -26,6 +28,8 @@
 
 #include "redis/redis_sub_config.h"
 
+#include "server/rate_limiter.h"  // for RateLimit
+
 namespace fastotv {
 namespace server {
 
@@ -35,6 +39,22 @@ struct ServerSettings {
   common::net::HostAndPort host;
   redis::RedisSubConfig redis;
   common::net::HostAndPort bandwidth_host;
+  std::string node_id;  // unique in cluster, empty if single node
+  size_t io_loops;      // more than one enables stream affinity migration between loops
+  size_t worker_threads;  // json (de)serialization offload, 0 handle inline
+  common::net::HostAndPort metrics_host;  // prometheus /metrics endpoint, disabled if not valid
+  uint32_t loop_stall_threshold_msec;     // loop thread backtrace logged if callback is longer, 0 disables
+  size_t trace_buffer_size;               // last request spans served on /trace, 0 disables
+  std::string capture_path;               // inbound frames recorded for fastotv_replay, disabled if empty
+  int accept_backlog;                     // listen queue length
+  size_t max_connections;                 // new connections closed above, 0 unlimited
+  size_t accept_rate;                     // new connections per second, 0 unlimited
+  uint32_t handshake_timeout_sec;         // not authorized connections closed after, 0 disables
+  RateLimit rate_limits[RATE_LIMIT_CLASSES_COUNT];        // per connection, over limit requests failed
+  RateLimit login_rate_limits[RATE_LIMIT_CLASSES_COUNT];  // per registered login, all its connections
+  uint32_t chat_batch_window_msec;  // chat messages grouped per stream for clients supporting it, 0 disables
+  uint32_t presence_interval_msec;  // enter/leave chat messages replaced by periodic watchers changes, 0 disables
+  uint32_t presence_join_sample;    // with presence, every Nth join announced to PRESENCE_FEATURE clients, 0 none
 };
 
 struct Config {
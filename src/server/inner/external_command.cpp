@@ -0,0 +1,117 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/inner/external_command.h"
+
+extern "C" {
+#include "sds_fasto.h"
+}
+
+#include <common/logger.h>   // for COMPACT_LOG_WARNING
+#include <common/macros.h>   // for STRINGIZE
+#include <common/sprintf.h>  // for MemSPrintf
+
+#define NO_STREAM_ENTRY_ID "-"
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+ExternalCommand::ExternalCommand()
+    : uid(), device_id(), id(), command(), input_command(), stream_entry_id(), message(), forwarded(false) {}
+
+bool ParseExternalCommand(const std::string& msg, ExternalCommand* out) {
+  size_t space_pos = msg.find_first_of(' ');
+  if (space_pos == std::string::npos) {
+    const std::string resp = common::MemSPrintf("UNKNOWN COMMAND: %s", msg);
+    WARNING_LOG() << resp;
+    return false;
+  }
+
+  const user_id_t uid = msg.substr(0, space_pos);
+  const std::string device_and_cmd = msg.substr(space_pos + 1);
+  size_t next_space_pos = device_and_cmd.find_first_of(' ');
+  if (next_space_pos == std::string::npos) {
+    const std::string resp = common::MemSPrintf("UNKNOWN COMMAND: %s", msg);
+    WARNING_LOG() << resp;
+    return false;
+  }
+
+  const device_id_t dev = device_and_cmd.substr(0, next_space_pos);
+  const std::string cmd = device_and_cmd.substr(next_space_pos + 1);
+  const std::string input_command = common::MemSPrintf(STRINGIZE(REQUEST_COMMAND) " %s" END_OF_COMMAND, cmd);
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t id;
+  std::string cmd_str;
+  common::Error err = common::protocols::three_way_handshake::ParseCommand(input_command, &seq, &id, &cmd_str);
+  if (err) {
+    std::string resp = err->GetDescription();
+    WARNING_LOG() << resp;
+    return false;
+  }
+
+  ExternalCommand ecmd;
+  ecmd.uid = uid;
+  ecmd.device_id = dev;
+  ecmd.id = id;
+  ecmd.input_command = input_command;
+  ecmd.message = msg;
+
+  int argc;
+  sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
+  if (argv) {
+    if (argc > 0) {
+      ecmd.command = argv[0];
+    }
+    sdsfreesplitres(argv, argc);
+  }
+
+  *out = ecmd;
+  return true;
+}
+
+std::string MakeForwardedCommand(const ExternalCommand& cmd) {
+  const std::string entry_id = cmd.stream_entry_id.empty() ? NO_STREAM_ENTRY_ID : cmd.stream_entry_id;
+  return entry_id + " " + cmd.message;
+}
+
+bool ParseForwardedCommand(const std::string& msg, ExternalCommand* out) {
+  size_t space_pos = msg.find_first_of(' ');
+  if (space_pos == std::string::npos) {
+    const std::string resp = common::MemSPrintf("UNKNOWN FORWARDED COMMAND: %s", msg);
+    WARNING_LOG() << resp;
+    return false;
+  }
+
+  ExternalCommand ecmd;
+  if (!ParseExternalCommand(msg.substr(space_pos + 1), &ecmd)) {
+    return false;
+  }
+
+  const std::string entry_id = msg.substr(0, space_pos);
+  if (entry_id != NO_STREAM_ENTRY_ID) {
+    ecmd.stream_entry_id = entry_id;
+  }
+  ecmd.forwarded = true;
+  *out = ecmd;
+  return true;
+}
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,53 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>  // for string
+
+#include "commands/commands.h"
+
+#include "server/user_info.h"  // for user_id_t
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+struct ExternalCommand {
+  ExternalCommand();
+
+  user_id_t uid;
+  device_id_t device_id;
+  common::protocols::three_way_handshake::cmd_seq_t id;
+  std::string command;        // command name, for fail responces
+  std::string input_command;  // full request line
+  std::string stream_entry_id;  // not empty if readed from stream, should be acked
+  std::string message;          // original external message, forwarded as is
+  bool forwarded;               // received from other node, never forward again
+};
+
+// [user_id_t]login [device_id_t]device_id [cmd_id_t]seq [std::string]command args ...
+bool ParseExternalCommand(const std::string& msg, ExternalCommand* out);
+
+// to owner node: [std::string]stream_entry_id|- message, owner acks stream entry after handling
+std::string MakeForwardedCommand(const ExternalCommand& cmd);
+bool ParseForwardedCommand(const std::string& msg, ExternalCommand* out);
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/inner/inner_connections_index.h"
+
+#include <utility>  // for make_pair
+
+#include "server/inner/inner_tcp_client.h"
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+InnerConnectionsIndex::InnerConnectionsIndex() : shards_() {}
+
+bool InnerConnectionsIndex::Insert(Symbol uid, Symbol dev, InnerTcpClient* connection) {
+  if (uid.IsEmpty() || !connection) {
+    return false;
+  }
+
+  const key_t key = MakeKey(uid, dev);
+  Shard& shard = GetShard(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  return shard.connections.insert(std::make_pair(key, connection)).second;
+}
+
+bool InnerConnectionsIndex::Remove(Symbol uid, Symbol dev, InnerTcpClient* connection) {
+  const key_t key = MakeKey(uid, dev);
+  Shard& shard = GetShard(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.connections.find(key);
+  if (it == shard.connections.end() || it->second != connection) {
+    return false;
+  }
+
+  shard.connections.erase(it);
+  return true;
+}
+
+InnerTcpClient* InnerConnectionsIndex::Find(const user_id_t& uid, const device_id_t& dev) const {
+  key_t key;
+  if (!FindKey(uid, dev, &key)) {
+    return nullptr;
+  }
+
+  Shard& shard = GetShard(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.connections.find(key);
+  if (it == shard.connections.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+common::libev::IoLoop* InnerConnectionsIndex::FindOwnerLoop(const user_id_t& uid, const device_id_t& dev) const {
+  key_t key;
+  if (!FindKey(uid, dev, &key)) {
+    return nullptr;
+  }
+
+  Shard& shard = GetShard(key);
+  std::unique_lock<std::mutex> lock(shard.mutex);  // connection can't be deleted while locked
+  auto it = shard.connections.find(key);
+  if (it == shard.connections.end()) {
+    return nullptr;
+  }
+  return it->second->GetOwnerLoop();
+}
+
+size_t InnerConnectionsIndex::GetSize() const {
+  size_t size = 0;
+  for (size_t i = 0; i < shards_count; ++i) {
+    std::unique_lock<std::mutex> lock(shards_[i].mutex);
+    size += shards_[i].connections.size();
+  }
+  return size;
+}
+
+InnerConnectionsIndex::key_t InnerConnectionsIndex::MakeKey(Symbol uid, Symbol dev) {
+  return (static_cast<key_t>(uid.GetId()) << 32) | dev.GetId();
+}
+
+bool InnerConnectionsIndex::FindKey(const user_id_t& uid, const device_id_t& dev, key_t* key) {
+  SymbolTable* table = SymbolTable::GetInstance();
+  Symbol::id_t uid_id;
+  Symbol::id_t dev_id;
+  if (!table->Find(uid, &uid_id) || !table->Find(dev, &dev_id)) {
+    return false;
+  }
+
+  *key = (static_cast<key_t>(uid_id) << 32) | dev_id;
+  return true;
+}
+
+InnerConnectionsIndex::Shard& InnerConnectionsIndex::GetShard(key_t key) const {
+  return shards_[(key ^ (key >> 32)) % shards_count];
+}
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+#include <mutex>
+#include <unordered_map>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "server/user_info.h"  // for user_id_t
+#include "symbol.h"            // for Symbol
+
+namespace common {
+namespace libev {
+class IoLoop;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+class InnerTcpClient;
+
+// registered connections by (user, device), key is pair of interned ids
+// sharded, concurrent loops lock only one shard, no strings copied
+class InnerConnectionsIndex {
+ public:
+  enum { shards_count = 16 };
+
+  InnerConnectionsIndex();
+
+  // thread safe
+  bool Insert(Symbol uid, Symbol dev, InnerTcpClient* connection);  // false if device already connected
+  bool Remove(Symbol uid, Symbol dev, InnerTcpClient* connection);  // false if registered other connection
+  InnerTcpClient* Find(const user_id_t& uid, const device_id_t& dev) const;  // pointer valid only in owner loop
+  common::libev::IoLoop* FindOwnerLoop(const user_id_t& uid, const device_id_t& dev) const;
+  size_t GetSize() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(InnerConnectionsIndex);
+
+  typedef uint64_t key_t;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<key_t, InnerTcpClient*> connections;
+  };
+
+  static key_t MakeKey(Symbol uid, Symbol dev);
+  static bool FindKey(const user_id_t& uid, const device_id_t& dev, key_t* key);  // false if never registered
+  Shard& GetShard(key_t key) const;
+
+  mutable Shard shards_[shards_count];
+};
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -22,20 +22,26 @@ extern "C" {
 #include "sds_fasto.h"
 }
 
-#include <common/error.h>   // for Error, DEBUG_MSG_...
-#include <common/logger.h>  // for COMPACT_LOG_WARNING
-#include <common/macros.h>  // for STRINGIZE
+#include <common/error.h>          // for Error, DEBUG_MSG_...
+#include <common/libev/io_loop.h>  // for IoLoop
+#include <common/logger.h>         // for COMPACT_LOG_WARNING
+#include <common/macros.h>         // for STRINGIZE
 
 #include "inner/inner_server_command_seq_parser.h"  // for RequestCallback
 
+#include "server/async_logger.h"  // for ASYNC_INFO_LOG_RATE_LIMITED
 #include "server/inner/inner_tcp_client.h"
 #include "server/inner/inner_tcp_handler.h"
+#include "server/metrics/request_tracer.h"  // for RequestTracer
 
 #include "server/responce_info.h"  // for ResponceInfo
 #include "server/user_info.h"      // for user_id_t
 
 // publish COMMANDS_IN 'user_id 0 1 ping' 0 => request
 // publish COMMANDS_OUT '1 [OK|FAIL] ping args...'
+// streams mode: XADD COMMANDS_IN_STREAM * msg 'user_id 0 1 ping', responce in COMMANDS_OUT_STREAM
+// cluster mode: commands for devices connected to other node forwarded to COMMANDS_IN_NODE_<node_id>
+// stream entry acked only after command written to device or fail published, forwarded entries by owner node
 // id cmd cause
 
 namespace fastotv {
@@ -53,104 +59,143 @@ void InnerSubHandler::ProcessSubscribed(common::protocols::three_way_handshake::
   const char* command = argc > 1 ? argv[1] : "null";              // command
   const std::string json = argc > 2 ? argv[2] : "{}";             // encoded args
 
+  metrics::RequestTracer::GetInstance()->End(nullptr, request_id, "device");
   ResponceInfo resp(request_id, state_command, command, json);
   PublishResponce(resp);
 }
 
 void InnerSubHandler::HandleMessage(const std::string& channel, const std::string& msg) {
-  // [user_id_t]login [device_id_t]device_id [cmd_id_t]seq [std::string]command args ...
-  // [cmd_id_t]seq OK/FAIL [std::string]command args ..
-  INFO_LOG() << "InnerSubHandler channel: " << channel << ", msg: " << msg;
-  size_t space_pos = msg.find_first_of(' ');
-  if (space_pos == std::string::npos) {
-    const std::string resp = common::MemSPrintf("UNKNOWN COMMAND: %s", msg);
-    WARNING_LOG() << resp;
+  if (parent_->IsDevicesRegistryChannel(channel)) {
+    parent_->ApplyDevicesRegistryChange(msg);
     return;
   }
 
-  const user_id_t uid = msg.substr(0, space_pos);
-  const std::string device_and_cmd = msg.substr(space_pos + 1);
-  size_t next_space_pos = device_and_cmd.find_first_of(' ');
-  if (next_space_pos == std::string::npos) {
-    const std::string resp = common::MemSPrintf("UNKNOWN COMMAND: %s", msg);
-    WARNING_LOG() << resp;
+  ASYNC_INFO_LOG_RATE_LIMITED(external_commands_log_limit)
+      << "InnerSubHandler channel: " << channel << ", msg: " << msg;
+  ExternalCommand ecmd;
+  if (parent_->IsClusterNodeChannel(channel)) {
+    if (!ParseForwardedCommand(msg, &ecmd)) {
+      return;
+    }
+  } else if (!ParseExternalCommand(msg, &ecmd)) {
     return;
   }
 
-  const device_id_t dev = device_and_cmd.substr(0, next_space_pos);
-  const std::string cmd = device_and_cmd.substr(next_space_pos + 1);
-  const std::string input_command = common::MemSPrintf(STRINGIZE(REQUEST_COMMAND) " %s" END_OF_COMMAND, cmd);
-  common::protocols::three_way_handshake::cmd_id_t seq;
-  common::protocols::three_way_handshake::cmd_seq_t id;
-  std::string cmd_str;
-  common::Error err = common::protocols::three_way_handshake::ParseCommand(input_command, &seq, &id, &cmd_str);
-  if (err) {
-    std::string resp = err->GetDescription();
-    WARNING_LOG() << resp;
+  if (!PostExternalCommand(ecmd)) {  // no redelivery for published messages
+    if (PublishFail(ecmd, "{\"cause\": \"server busy\"}")) {
+      FinishCommand(ecmd);
+    }
+  }
+}
+
+bool InnerSubHandler::HandleStreamEntry(const std::string& stream,
+                                        const std::string& entry_id,
+                                        const std::string& msg) {
+  ASYNC_INFO_LOG_RATE_LIMITED(external_commands_log_limit)
+      << "InnerSubHandler stream: " << stream << ", entry: " << entry_id << ", msg: " << msg;
+  ExternalCommand ecmd;
+  if (!ParseExternalCommand(msg, &ecmd)) {
+    parent_->AckExternalCommand(entry_id);  // never will be handled
+    return true;
+  }
+
+  ecmd.stream_entry_id = entry_id;
+  return PostExternalCommand(ecmd);  // if queue is full entry stays pending, consumer reads it again later
+}
+
+bool InnerSubHandler::PostExternalCommand(const ExternalCommand& cmd) {
+  // listen thread, handoff into loop
+  metrics::RequestTracer::GetInstance()->Begin(nullptr, cmd.id, "queue");
+  if (!parent_->PostExternalCommand(cmd)) {
+    metrics::RequestTracer::GetInstance()->End(nullptr, cmd.id, "queue");
+    return false;
+  }
+
+  return true;
+}
+
+void InnerSubHandler::FinishCommand(const ExternalCommand& cmd) {
+  if (!cmd.stream_entry_id.empty()) {
+    parent_->AckExternalCommand(cmd.stream_entry_id);
+  }
+}
+
+void InnerSubHandler::ExecuteCommand(const ExternalCommand& cmd) {
+  if (parent_->ExecInConnectionLoop(cmd.uid, cmd.device_id, [this, cmd]() { ExecuteCommand(cmd); })) {
+    return;
+  }
+
+  InnerTcpClient* fclient = parent_->FindInnerConnectionByUserIDAndDeviceID(cmd.uid, cmd.device_id);
+  if (fclient && fclient->IsMigrating()) {  // registered in this loop after queued migration
+    fclient->GetOwnerLoop()->ExecInLoopThread([this, cmd]() { ExecuteCommand(cmd); });
     return;
   }
 
-  InnerTcpClient* fclient = parent_->FindInnerConnectionByUserIDAndDeviceID(uid, dev);
+  metrics::RequestTracer::GetInstance()->End(nullptr, cmd.id, "queue");
   if (!fclient) {
-    int argc;
-    sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
-    char* command = argv[0];
-
-    ResponceInfo resp(id, FAIL_COMMAND, command, "{\"cause\": \"not connected\"}");
-    std::string resp_str;
-    common::Error err = resp.SerializeToString(&resp_str);
-    if (err) {
-      PublishResponce(resp);
-      sdsfreesplitres(argv, argc);
-      return;
+    std::string node;
+    if (!cmd.forwarded && parent_->FindDeviceNode(cmd.uid, cmd.device_id, &node)) {
+      // owner node publishes responce and acks stream entry itself
+      size_t receivers = 0;
+      common::Error err = parent_->ForwardToNode(node, MakeForwardedCommand(cmd), &receivers);
+      if (!err && receivers != 0) {
+        return;
+      }
+    }
+    if (PublishFail(cmd, "{\"cause\": \"not connected\"}")) {
+      FinishCommand(cmd);
     }
-
-    WARNING_LOG() << resp_str;
-    PublishResponce(resp);
-    sdsfreesplitres(argv, argc);
     return;
   }
 
-  common::protocols::three_way_handshake::cmd_request_t req(id, input_command);
-  common::ErrnoError errn = fclient->Write(req);
+  common::protocols::three_way_handshake::cmd_request_t req(cmd.id, cmd.input_command);
+  common::ErrnoError errn;
+  {
+    metrics::ScopedSpan span(nullptr, cmd.id, "write", cmd.command.c_str());
+    errn = fclient->Write(req);
+  }
   if (errn) {
-    int argc;
-    sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
-    char* command = argv[0];
-
-    ResponceInfo resp(id, FAIL_COMMAND, command, "{\"cause\": \"not handled\"}");
-    std::string resp_str;
-    common::Error err = resp.SerializeToString(&resp_str);
-    if (err) {
-      PublishResponce(resp);
-      sdsfreesplitres(argv, argc);
-      return;
+    if (PublishFail(cmd, "{\"cause\": \"not handled\"}")) {
+      FinishCommand(cmd);
     }
-
-    WARNING_LOG() << resp_str;
-    PublishResponce(resp);
-    sdsfreesplitres(argv, argc);
     return;
   }
 
+  FinishCommand(cmd);  // device responce goes to channel out, not redelivered
+
+  metrics::RequestTracer::GetInstance()->Begin(nullptr, cmd.id, "device");
+
   auto cb = std::bind(&InnerSubHandler::ProcessSubscribed, this, std::placeholders::_1, std::placeholders::_2,
                       std::placeholders::_3);
-  fastotv::inner::RequestCallback rc(id, cb);
+  fastotv::inner::RequestCallback rc(cmd.id, cb);
   parent_->SubscribeRequest(rc);
 }
 
-void InnerSubHandler::PublishResponce(const ResponceInfo& resp) {
+bool InnerSubHandler::PublishFail(const ExternalCommand& cmd, const std::string& cause_json) {
+  ResponceInfo resp(cmd.id, FAIL_COMMAND, cmd.command, cause_json);
+  std::string resp_str;
+  common::Error err = resp.SerializeToString(&resp_str);
+  if (!err) {
+    WARNING_LOG() << resp_str;
+  }
+  return PublishResponce(resp);
+}
+
+bool InnerSubHandler::PublishResponce(const ResponceInfo& resp) {
+  metrics::ScopedSpan span(nullptr, resp.GetRequestId(), "publish_out");
   std::string resp_str;
   common::Error err = resp.SerializeToString(&resp_str);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    return;
+    return false;
   }
 
   err = parent_->PublishToChannelOut(resp_str);
   if (err) {
     WARNING_LOG() << "Publish message: " << resp_str << " to channel out failed.";
+    return false;
   }
+  return true;
 }
 
 }  // namespace inner
@@ -22,7 +22,9 @@
 
 #include "commands/commands.h"
 
+#include "server/inner/external_command.h"  // for ExternalCommand
 #include "server/redis/redis_pub_sub_handler.h"
+#include "server/redis/redis_stream_consumer.h"  // for RedisStreamHandler
 
 namespace fastotv {
 namespace server {
@@ -31,18 +33,26 @@ namespace inner {
 
 class InnerTcpHandlerHost;
 
-class InnerSubHandler : public redis::RedisSubHandler {
+class InnerSubHandler : public redis::RedisSubHandler, public redis::RedisStreamHandler {
  public:
+  enum { external_commands_log_limit = 10 };  // per second
+
   explicit InnerSubHandler(InnerTcpHandlerHost* parent);
   virtual ~InnerSubHandler();
 
+  void ExecuteCommand(const ExternalCommand& cmd);  // should be called from loop thread
+
  protected:
   void HandleMessage(const std::string& channel, const std::string& msg) override;
+  bool HandleStreamEntry(const std::string& stream, const std::string& entry_id, const std::string& msg) override;
 
  private:
+  bool PostExternalCommand(const ExternalCommand& cmd);
+  void FinishCommand(const ExternalCommand& cmd);  // handled or failed, stream entry acked
+  bool PublishFail(const ExternalCommand& cmd, const std::string& cause_json);
   void ProcessSubscribed(common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[]);
 
-  void PublishResponce(const ResponceInfo& resp);
+  bool PublishResponce(const ResponceInfo& resp);
 
   InnerTcpHandlerHost* parent_;
 };
@@ -18,19 +18,75 @@
 
 #include "server/inner/inner_tcp_client.h"
 
-#include <common/libev/tcp/tcp_server.h>
+#include <common/libev/io_loop.h>
+
+#include "server/slab_allocator.h"  // for SlabAllocator
 
 namespace fastotv {
 namespace server {
 namespace inner {
 
+namespace {
+
+SlabAllocator<sizeof(InnerTcpClient)>* GetClientsAllocator() {
+  static SlabAllocator<sizeof(InnerTcpClient)>* allocator = new SlabAllocator<sizeof(InnerTcpClient)>;
+  return allocator;
+}
+
+}  // namespace
+
 const AuthInfo InnerTcpClient::anonim_user(USER_LOGIN, USER_PASSWORD, USER_DEVICE_ID);
 
-InnerTcpClient::InnerTcpClient(common::libev::tcp::TcpServer* server, const common::net::socket_info& info)
-    : InnerClient(server, info), hinfo_(), uid_(), current_stream_id_(invalid_stream_id) {}
+InnerTcpClient::InnerTcpClient(common::libev::IoLoop* server, const common::net::socket_info& info)
+    : InnerClient(server, info),
+      login_(),
+      device_id_(),
+      uid_(),
+      current_stream_id_(),
+      password_(),
+      rate_buckets_(),
+      rate_limited_count_(0),
+      features_(0),
+      owner_loop_(server),
+      migrating_(false) {}
+
+void* InnerTcpClient::operator new(size_t size) {
+  if (size != sizeof(InnerTcpClient)) {  // derived
+    return ::operator new(size);
+  }
+  return GetClientsAllocator()->Allocate();
+}
+
+void InnerTcpClient::operator delete(void* ptr, size_t size) {
+  if (size != sizeof(InnerTcpClient)) {
+    ::operator delete(ptr);
+    return;
+  }
+  GetClientsAllocator()->Deallocate(ptr);
+}
+
+size_t InnerTcpClient::GetAllocatedCount() {
+  return GetClientsAllocator()->GetAllocatedCount();
+}
+
+size_t InnerTcpClient::GetReservedBytes() {
+  return GetClientsAllocator()->GetReservedBytes();
+}
 
 bool InnerTcpClient::IsAnonimUser() const {
-  return anonim_user == hinfo_;
+  static const Symbol anonim_login(anonim_user.GetLogin());
+  static const Symbol anonim_device_id(anonim_user.GetDeviceID());
+  return login_ == anonim_login && device_id_ == anonim_device_id && password_ == anonim_user.GetPassword();
+}
+
+bool InnerTcpClient::ConsumeRateLimit(RateLimitClass cls,
+                                      const RateLimit& limit,
+                                      std::chrono::steady_clock::time_point now) {
+  return rate_buckets_[cls].Consume(limit, now);
+}
+
+uint32_t InnerTcpClient::IncRateLimitedCount() {
+  return ++rate_limited_count_;
 }
 
 const char* InnerTcpClient::ClassName() const {
@@ -40,29 +96,78 @@ const char* InnerTcpClient::ClassName() const {
 InnerTcpClient::~InnerTcpClient() {}
 
 void InnerTcpClient::SetServerHostInfo(const AuthInfo& info) {
-  hinfo_ = info;
+  login_ = Symbol(info.GetLogin());
+  password_ = info.GetPassword();
+  device_id_ = Symbol(info.GetDeviceID());
+  features_ = info.GetFeatures();
 }
 
 AuthInfo InnerTcpClient::GetServerHostInfo() const {
-  return hinfo_;
+  AuthInfo info(login_.ToString(), password_, device_id_.ToString());
+  info.SetFeatures(features_);
+  return info;
+}
+
+const login_t& InnerTcpClient::GetLogin() const {
+  return login_.ToString();
+}
+
+const device_id_t& InnerTcpClient::GetDeviceID() const {
+  return device_id_.ToString();
+}
+
+Symbol InnerTcpClient::GetLoginSymbol() const {
+  return login_;
+}
+
+Symbol InnerTcpClient::GetDeviceIDSymbol() const {
+  return device_id_;
+}
+
+bool InnerTcpClient::HaveFeature(ClientFeature feature) const {
+  return features_ & feature;
 }
 
 void InnerTcpClient::SetUid(user_id_t id) {
-  uid_ = id;
+  uid_ = Symbol(id);
 }
 
-user_id_t InnerTcpClient::GetUid() const {
+const user_id_t& InnerTcpClient::GetUid() const {
+  return uid_.ToString();
+}
+
+Symbol InnerTcpClient::GetUidSymbol() const {
   return uid_;
 }
 
-void InnerTcpClient::SetCurrentStreamId(stream_id sid) {
+void InnerTcpClient::SetCurrentStream(Symbol sid) {
   current_stream_id_ = sid;
 }
 
-user_id_t InnerTcpClient::GetCurrentStreamId() const {
+const stream_id& InnerTcpClient::GetCurrentStreamId() const {
+  return current_stream_id_.ToString();
+}
+
+Symbol InnerTcpClient::GetCurrentStreamSymbol() const {
   return current_stream_id_;
 }
 
+void InnerTcpClient::SetOwnerLoop(common::libev::IoLoop* loop) {
+  owner_loop_ = loop;
+}
+
+common::libev::IoLoop* InnerTcpClient::GetOwnerLoop() const {
+  return owner_loop_;
+}
+
+void InnerTcpClient::SetMigrating(bool migrating) {
+  migrating_ = migrating;
+}
+
+bool InnerTcpClient::IsMigrating() const {
+  return migrating_;
+}
+
 }  // namespace inner
 }  // namespace server
 }  // namespace fastotv
@@ -18,20 +18,27 @@
 
 #pragma once
 
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t
+
+#include <atomic>
+#include <chrono>
+#include <string>  // for string
+
 #include "commands_info/auth_info.h"  // for AuthInfo
+#include "symbol.h"                   // for Symbol
 
 #include "inner/inner_client.h"  // for InnerClient
 
-#include "server/user_info.h"  // for user_id_t
+#include "server/rate_limiter.h"  // for TokenBucket
+#include "server/user_info.h"     // for user_id_t
 
 #include "commands_info/chat_message.h"
 
 namespace common {
 namespace libev {
-namespace tcp {
-class TcpServer;
+class IoLoop;
 }
-}  // namespace libev
 }  // namespace common
 namespace common {
 namespace net {
@@ -47,26 +54,57 @@ class InnerTcpClient : public fastotv::inner::InnerClient {
  public:
   static const AuthInfo anonim_user;
 
-  InnerTcpClient(common::libev::tcp::TcpServer* server, const common::net::socket_info& info);
+  InnerTcpClient(common::libev::IoLoop* server, const common::net::socket_info& info);
   ~InnerTcpClient();
 
+  // slab allocated, many idle connections
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+  static size_t GetAllocatedCount();
+  static size_t GetReservedBytes();  // slabs, never returned to heap
+
   const char* ClassName() const override;
 
   void SetServerHostInfo(const AuthInfo& info);
-  AuthInfo GetServerHostInfo() const;
+  AuthInfo GetServerHostInfo() const;  // copy, prefer GetLogin/GetDeviceID
+  const login_t& GetLogin() const;
+  const device_id_t& GetDeviceID() const;
+  Symbol GetLoginSymbol() const;
+  Symbol GetDeviceIDSymbol() const;
+  bool HaveFeature(ClientFeature feature) const;  // advertised in who_are_you
 
   void SetUid(user_id_t id);
-  user_id_t GetUid() const;
+  const user_id_t& GetUid() const;
+  Symbol GetUidSymbol() const;
 
-  void SetCurrentStreamId(stream_id sid);
-  user_id_t GetCurrentStreamId() const;
+  void SetCurrentStream(Symbol sid);  // only known channels, ids from clients never interned
+  const stream_id& GetCurrentStreamId() const;
+  Symbol GetCurrentStreamSymbol() const;  // for broadcast filters
 
   bool IsAnonimUser() const;
 
+  bool ConsumeRateLimit(RateLimitClass cls, const RateLimit& limit, std::chrono::steady_clock::time_point now);
+  uint32_t IncRateLimitedCount();  // over limit requests
+
+  // loop which owns or will own connection after migration, thread safe
+  void SetOwnerLoop(common::libev::IoLoop* loop);
+  common::libev::IoLoop* GetOwnerLoop() const;
+
+  void SetMigrating(bool migrating);
+  bool IsMigrating() const;
+
  private:
-  AuthInfo hinfo_;
-  user_id_t uid_;
-  stream_id current_stream_id_;
+  // interned, shared by connections of same user and channel
+  Symbol login_;
+  Symbol device_id_;
+  Symbol uid_;
+  Symbol current_stream_id_;
+  std::string password_;  // not interned, interned strings never released
+  TokenBucket rate_buckets_[RATE_LIMIT_CLASSES_COUNT];
+  uint32_t rate_limited_count_;
+  client_features_t features_;
+  std::atomic<common::libev::IoLoop*> owner_loop_;
+  std::atomic<bool> migrating_;
 };
 
 }  // namespace inner
@@ -33,77 +33,427 @@
 #include "commands_info/channels_info.h"  // for ChannelsInfo
 #include "commands_info/client_info.h"    // for ClientInfo
 #include "commands_info/ping_info.h"      // for ClientPingInfo
+#include "commands_info/presence_info.h"  // for PresenceInfo
 #include "inner/inner_client.h"           // for InnerClient
+#include "probes.h"                       // for FASTOTV_PROBE2
 
 #include "server/commands.h"
 
+#include "server/redis/redis_chat_fanout.h"
+#include "server/redis/redis_devices_registry.h"
 #include "server/redis/redis_pub_sub.h"
+#include "server/redis/redis_stream_consumer.h"
+#include "server/redis/redis_watchers_counter.h"
 
 #include "server/inner/inner_external_notifier.h"  // for InnerSubHandler
 #include "server/inner/inner_tcp_client.h"         // for InnerTcpClient
 
+#include "server/metrics/loop_monitor.h"    // for LoopMonitor, LoopWatchdog
+#include "server/metrics/metrics.h"         // for Registry, ScopedLatency
+#include "server/metrics/request_tracer.h"  // for RequestTracer, ScopedSpan
+
 #include "commands_info/runtime_channel_info.h"
-#include "commands_info/server_info.h"  // for ServerInfo
-#include "server/server_host.h"         // for ServerHost
-#include "server/user_info.h"           // for user_id_t, UserInfo
-#include "server/user_state_info.h"     // for UserStateInfo
+#include "commands_info/server_info.h"       // for ServerInfo
+#include "server/async_logger.h"             // for ASYNC_INFO_LOG
+#include "server/capture/traffic_capture.h"  // for TrafficCapture
+#include "server/chat_message_scanner.h"     // for ScanChatMessage
+#include "server/server_host.h"              // for ServerHost
+#include "server/worker_pool.h"              // for WorkerPool
+#include "server/user_info.h"                // for user_id_t, UserInfo
+#include "server/user_state_info.h"          // for UserStateInfo
+
+#define COMMAND_DURATION_METRIC "fastotv_inner_command_duration_seconds"
+#define BROADCAST_DURATION_METRIC "fastotv_chat_broadcast_duration_seconds"
+#define HANDSHAKE_STAGE_DURATION_METRIC "fastotv_handshake_stage_duration_seconds"
+#define CONNECTIONS_METRIC "fastotv_connections"
+#define USERS_METRIC "fastotv_users"
+#define PENDING_REQUESTS_METRIC "fastotv_pending_requests"
+#define STREAM_VIEWERS_METRIC "fastotv_stream_viewers"
+#define OTHER_STREAMS_LABEL "other"
+#define REJECTED_CONNECTIONS_METRIC "fastotv_rejected_connections_total"
+#define HANDSHAKE_TIMEOUTS_METRIC "fastotv_handshake_timeouts_total"
+#define RATE_LIMITED_REQUESTS_METRIC "fastotv_rate_limited_requests_total"
+
+#define RATE_LIMITED_ERROR "Rate limit exceeded"
+#define MAX_CHAT_MESSAGE_SIZE 2048
+#define SYMBOL_TABLE_FULL_ERROR "Symbol table is full"
 
 namespace fastotv {
 namespace server {
 namespace inner {
 
+namespace {
+
+bool InternChannels(const ChannelsInfo& channels) {  // bounded by database, runtime info accepts only these ids
+  for (const ChannelInfo& channel : channels.GetChannels()) {
+    Symbol interned;
+    if (!Symbol::Intern(channel.GetId(), &interned)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool InternUser(const user_id_t& uid, const AuthInfo& auth) {  // connection keeps them as symbols
+  Symbol interned;
+  return Symbol::Intern(uid, &interned) && Symbol::Intern(auth.GetLogin(), &interned) &&
+         Symbol::Intern(auth.GetDeviceID(), &interned);
+}
+
+}  // namespace
+
 InnerTcpHandlerHost::InnerTcpHandlerHost(ServerHost* parent, const Config& config)
     : parent_(parent),
       sub_commands_in_(nullptr),
+      stream_commands_in_(nullptr),
+      devices_registry_(nullptr),
+      chat_fanout_(nullptr),
+      watchers_counter_(nullptr),
       handler_(nullptr),
-      ping_client_id_timer_(INVALID_TIMER_ID),
+      workers_(nullptr),
+      watchdog_(nullptr),
+      capture_(nullptr),
+      jobs_generation_(0),
+      connections_count_(0),
+      accept_window_start_(),
+      accept_window_count_(0),
+      login_rate_limiter_(),
       reread_cache_id_timer_(INVALID_TIMER_ID),
       config_(config),
-      chat_channels_() {
+      external_commands_(external_commands_queue_size),
+      loop_(nullptr),
+      loops_(),
+      external_commands_drain_scheduled_(false),
+      chat_channels_mutex_(),
+      chat_channels_(),
+      commands_duration_(),
+      broadcast_duration_(nullptr),
+      handshake_find_user_duration_(nullptr),
+      handshake_register_duration_(nullptr),
+      connections_gauge_(nullptr),
+      anonim_users_gauge_(nullptr),
+      registered_users_gauge_(nullptr),
+      pending_requests_gauge_(nullptr),
+      rejected_by_limit_counter_(nullptr),
+      rejected_by_rate_counter_(nullptr),
+      handshake_timeouts_counter_(nullptr),
+      connection_rate_limited_counters_(),
+      login_rate_limited_counters_() {
+  metrics::Registry* registry = metrics::Registry::GetInstance();
+  static const char* commands[] = {CLIENT_PING,
+                                   CLIENT_GET_SERVER_INFO,
+                                   CLIENT_GET_CHANNELS,
+                                   CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                                   CLIENT_SEND_CHAT_MESSAGE,
+                                   SERVER_PING,
+                                   SERVER_WHO_ARE_YOU,
+                                   SERVER_GET_CLIENT_INFO,
+                                   SERVER_SEND_CHAT_MESSAGE,
+                                   SERVER_SEND_CHAT_MESSAGES,
+                                   SERVER_PRESENCE};
+  for (const char* command : commands) {
+    commands_duration_[command] =
+        registry->GetHistogram(COMMAND_DURATION_METRIC, "Inner command handling time.", {{"command", command}});
+  }
+  broadcast_duration_ = registry->GetHistogram(BROADCAST_DURATION_METRIC, "Local chat message delivery time.");
+  handshake_find_user_duration_ = registry->GetHistogram(HANDSHAKE_STAGE_DURATION_METRIC, "Handshake stage time.",
+                                                         {{"stage", "find_user"}});
+  handshake_register_duration_ = registry->GetHistogram(HANDSHAKE_STAGE_DURATION_METRIC, "Handshake stage time.",
+                                                        {{"stage", "register"}});
+  connections_gauge_ = registry->GetGauge(CONNECTIONS_METRIC, "Connected clients.");
+  anonim_users_gauge_ = registry->GetGauge(USERS_METRIC, "Authorized users.", {{"type", "anonim"}});
+  registered_users_gauge_ = registry->GetGauge(USERS_METRIC, "Authorized users.", {{"type", "registered"}});
+  pending_requests_gauge_ = registry->GetGauge(PENDING_REQUESTS_METRIC, "Requests offloaded into worker pool.");
+  rejected_by_limit_counter_ = registry->GetCounter(REJECTED_CONNECTIONS_METRIC,
+                                                    "Connections closed by admission control.", {{"reason", "limit"}});
+  rejected_by_rate_counter_ = registry->GetCounter(REJECTED_CONNECTIONS_METRIC,
+                                                   "Connections closed by admission control.", {{"reason", "rate"}});
+  handshake_timeouts_counter_ =
+      registry->GetCounter(HANDSHAKE_TIMEOUTS_METRIC, "Connections closed without handshake in time.");
+  static const char* rate_limit_classes[RATE_LIMIT_CLASSES_COUNT] = {"chat", "channels"};
+  for (size_t i = 0; i < RATE_LIMIT_CLASSES_COUNT; ++i) {
+    connection_rate_limited_counters_[i] =
+        registry->GetCounter(RATE_LIMITED_REQUESTS_METRIC, "Requests failed by rate limit.",
+                             {{"class", rate_limit_classes[i]}, {"scope", "connection"}});
+    login_rate_limited_counters_[i] =
+        registry->GetCounter(RATE_LIMITED_REQUESTS_METRIC, "Requests failed by rate limit.",
+                             {{"class", rate_limit_classes[i]}, {"scope", "login"}});
+  }
+
   handler_ = new InnerSubHandler(this);
-  sub_commands_in_ = new redis::RedisPubSub(handler_);
-  redis_subscribe_command_in_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisPubSub::Listen, sub_commands_in_);
+  if (config.server.loop_stall_threshold_msec) {
+    watchdog_ = new metrics::LoopWatchdog(config.server.loop_stall_threshold_msec);
+  }
+  if (config.server.worker_threads) {
+    workers_ = new WorkerPool(config.server.worker_threads, worker_queue_size);
+    workers_->Start();
+  }
+  if (!config.server.capture_path.empty()) {
+    capture_ = new capture::TrafficCapture(config.server.capture_path);
+    common::ErrnoError err = capture_->Start();
+    if (err) {
+      WARNING_LOG() << "Traffic capture disabled: " << err->GetDescription();
+      destroy(&capture_);
+    } else {
+      INFO_LOG() << "Traffic capture started: " << config.server.capture_path;
+    }
+  }
 
+  sub_commands_in_ = new redis::RedisPubSub(handler_);
   sub_commands_in_->SetConfig(config.server.redis);
-  bool result = redis_subscribe_command_in_thread_->Start();
-  if (!result) {
-    WARNING_LOG() << "Don't started listen thread for external commands.";
+  std::vector<std::string> channels;
+  if (config.server.redis.use_streams) {
+    redis::RedisSubConfig stream_config = config.server.redis;
+    if (stream_config.stream_consumer.empty()) {
+      stream_config.stream_consumer = common::ConvertToString(config.server.host);
+    }
+    stream_commands_in_ = new redis::RedisStreamConsumer(handler_);
+    stream_commands_in_->SetConfig(stream_config);
+    redis_stream_command_in_thread_ =
+        THREAD_MANAGER()->CreateThread(&redis::RedisStreamConsumer::Listen, stream_commands_in_);
+    bool result = redis_stream_command_in_thread_->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started listen thread for external commands stream.";
+    }
+  } else {
+    channels.push_back(config.server.redis.channel_in);
+  }
+
+  if (!config.server.node_id.empty()) {
+    devices_registry_ = new redis::RedisDevicesRegistry(this);
+    devices_registry_->SetConfig(config.server.redis, config.server.node_id);
+    redis_devices_registry_thread_ =
+        THREAD_MANAGER()->CreateThread(&redis::RedisDevicesRegistry::Listen, devices_registry_);
+    bool result = redis_devices_registry_thread_->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started devices registry thread.";
+    }
+
+    chat_fanout_ = new redis::RedisChatFanout(this);
+    chat_fanout_->SetConfig(config.server.redis, config.server.node_id);
+    redis_chat_fanout_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisChatFanout::Listen, chat_fanout_);
+    result = redis_chat_fanout_thread_->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started chat fan-out thread.";
+    }
+
+    watchers_counter_ = new redis::RedisWatchersCounter;
+    watchers_counter_->SetConfig(config.server.redis, config.server.node_id);
+    redis_watchers_counter_thread_ =
+        THREAD_MANAGER()->CreateThread(&redis::RedisWatchersCounter::Listen, watchers_counter_);
+    result = redis_watchers_counter_thread_->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started watchers counter thread.";
+    }
+
+    channels.push_back(config.server.redis.channel_node_prefix + config.server.node_id);
+    channels.push_back(config.server.redis.channel_devices_registry);
+  }
+
+  if (!channels.empty()) {
+    sub_commands_in_->SetChannels(channels);
+    redis_subscribe_command_in_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisPubSub::Listen, sub_commands_in_);
+    bool result = redis_subscribe_command_in_thread_->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started listen thread for external commands.";
+    }
   }
 }
 
 InnerTcpHandlerHost::~InnerTcpHandlerHost() {
+  if (watchdog_) {
+    watchdog_->Stop();
+  }
+  if (workers_) {
+    workers_->Stop();
+  }
   sub_commands_in_->Stop();
-  redis_subscribe_command_in_thread_->Join();
+  if (stream_commands_in_) {
+    stream_commands_in_->Stop();
+  }
+  if (devices_registry_) {
+    devices_registry_->Stop();
+  }
+  if (chat_fanout_) {
+    chat_fanout_->Stop();
+  }
+  if (watchers_counter_) {
+    watchers_counter_->Stop();
+  }
+  if (redis_subscribe_command_in_thread_) {
+    redis_subscribe_command_in_thread_->Join();
+  }
+  if (redis_stream_command_in_thread_) {
+    redis_stream_command_in_thread_->Join();
+  }
+  if (redis_devices_registry_thread_) {
+    redis_devices_registry_thread_->Join();
+  }
+  if (redis_chat_fanout_thread_) {
+    redis_chat_fanout_thread_->Join();
+  }
+  if (redis_watchers_counter_thread_) {
+    redis_watchers_counter_thread_->Join();
+  }
+  delete watchers_counter_;
+  delete chat_fanout_;
+  delete devices_registry_;
+  delete stream_commands_in_;
   delete sub_commands_in_;
+  delete workers_;
+  delete watchdog_;
+  delete capture_;
+  for (LoopContext& context : loops_) {
+    delete context.monitor;
+  }
   delete handler_;
 }
 
+InnerTcpHandlerHost::ConnectionJobs::ConnectionJobs() : generation(0), pending(0), deferred() {}
+
+InnerTcpHandlerHost::PendingHandshake::PendingHandshake() : deadline(), rejected(false) {}
+
+InnerTcpHandlerHost::LoopContext::LoopContext()
+    : loop(nullptr),
+      ping_timer(INVALID_TIMER_ID),
+      watchers_update_timer(INVALID_TIMER_ID),
+      lag_probe_timer(INVALID_TIMER_ID),
+      handshake_timer(INVALID_TIMER_ID),
+      chat_batch_timer(INVALID_TIMER_ID),
+      presence_timer(INVALID_TIMER_ID),
+      monitor(nullptr),
+      read_start(),
+      stream_viewers(),
+      stream_viewers_gauges(),
+      jobs(),
+      handshakes(),
+      rejected(),
+      pending_chat(),
+      presence(),
+      presence_joins(0) {}
+
+void InnerTcpHandlerHost::SetIoLoops(const std::vector<common::libev::IoLoop*>& loops) {
+  loops_.resize(loops.size());
+  for (size_t i = 0; i < loops.size(); ++i) {
+    loops_[i].loop = loops[i];
+    loops_[i].monitor = new metrics::LoopMonitor(loops[i]->GetName());
+    if (watchdog_) {
+      watchdog_->AddMonitor(loops_[i].monitor);
+    }
+  }
+
+  if (watchdog_ && !watchdog_->Start()) {
+    WARNING_LOG() << "Don't started loops watchdog thread.";
+  }
+}
+
 void InnerTcpHandlerHost::PreLooped(common::libev::IoLoop* server) {
+  LoopContext* context = FindLoopContext(server);
+  CHECK(context) << "Unknown loop: " << server->GetFormatedName();
+  context->ping_timer = server->CreateTimer(ping_timeout_clients, true);
+  const double lag_probe_interval = lag_probe_interval_msec / 1000.0;
+  context->lag_probe_timer = server->CreateTimer(lag_probe_interval, true);
+  context->monitor->Attach(lag_probe_interval);
+  if (watchers_counter_) {
+    context->watchers_update_timer = server->CreateTimer(watchers_update_timeout, true);
+  }
+  if (config_.server.chat_batch_window_msec) {
+    context->chat_batch_timer = server->CreateTimer(config_.server.chat_batch_window_msec / 1000.0, true);
+  }
+  if (config_.server.presence_interval_msec) {
+    context->presence_timer = server->CreateTimer(config_.server.presence_interval_msec / 1000.0, true);
+  }
+
+  if (context != &loops_[0]) {  // affinity loop
+    return;
+  }
+
   UpdateCache();
-  ping_client_id_timer_ = server->CreateTimer(ping_timeout_clients, true);
   reread_cache_id_timer_ = server->CreateTimer(reread_cache_timeout, true);
+  if (config_.server.handshake_timeout_sec) {
+    context->handshake_timer = server->CreateTimer(handshake_check_timeout, true);
+  }
+  loop_ = server;
+  ScheduleExternalCommandsDrain();  // commands received before loop started
 }
 
 void InnerTcpHandlerHost::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
-  UNUSED(server);
-  UNUSED(client);
+  InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
+  if (iclient->IsMigrating()) {
+    DEBUG_LOG() << "Client[" << client->GetFormatedName() << "] moved from loop[" << server->GetFormatedName()
+                << "]";
+  }
 }
 
 void InnerTcpHandlerHost::PostLooped(common::libev::IoLoop* server) {
-  if (ping_client_id_timer_ != INVALID_TIMER_ID) {
-    server->RemoveTimer(ping_client_id_timer_);
-    ping_client_id_timer_ = INVALID_TIMER_ID;
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return;
   }
 
+  if (context->ping_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->ping_timer);
+    context->ping_timer = INVALID_TIMER_ID;
+  }
+
+  if (context->watchers_update_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->watchers_update_timer);
+    context->watchers_update_timer = INVALID_TIMER_ID;
+  }
+
+  if (context->lag_probe_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->lag_probe_timer);
+    context->lag_probe_timer = INVALID_TIMER_ID;
+  }
+  context->monitor->Detach();
+
+  if (context->chat_batch_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->chat_batch_timer);
+    context->chat_batch_timer = INVALID_TIMER_ID;
+  }
+  context->pending_chat.clear();
+
+  if (context->presence_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->presence_timer);
+    context->presence_timer = INVALID_TIMER_ID;
+  }
+  context->presence.clear();
+
+  if (context != &loops_[0]) {
+    return;
+  }
+
+  loop_ = nullptr;
   if (reread_cache_id_timer_ != INVALID_TIMER_ID) {
     server->RemoveTimer(reread_cache_id_timer_);
     reread_cache_id_timer_ = INVALID_TIMER_ID;
   }
+
+  if (context->handshake_timer != INVALID_TIMER_ID) {
+    server->RemoveTimer(context->handshake_timer);
+    context->handshake_timer = INVALID_TIMER_ID;
+  }
 }
 
 void InnerTcpHandlerHost::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
-  if (ping_client_id_timer_ == id) {
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return;
+  }
+
+  if (context->lag_probe_timer == id) {
+    context->monitor->ProbeFired();
+    return;
+  }
+
+  metrics::LoopMonitor::CallbackScope scope(context->monitor, metrics::LoopMonitor::TIMER_EMITED);
+  if (context->chat_batch_timer == id) {
+    FlushPendingChatMessages(context);
+  } else if (context->presence_timer == id) {
+    FlushPresence(context);
+  } else if (context->ping_timer == id) {
     std::vector<common::libev::IoClient*> online_clients = server->GetClients();
+    size_t pinged = 0;
     for (size_t i = 0; i < online_clients.size(); ++i) {
       common::libev::IoClient* client = online_clients[i];
       InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
@@ -116,13 +466,23 @@ void InnerTcpHandlerHost::TimerEmited(common::libev::IoLoop* server, common::lib
           DCHECK(!err) << "Close client error: " << err->GetDescription();
           delete client;
         } else {
-          INFO_LOG() << "Pinged to client[" << client->GetFormatedName() << "], from server["
-                     << server->GetFormatedName() << "], " << online_clients.size() << " client(s) connected.";
+          pinged++;
         }
       }
     }
-  } else if (reread_cache_id_timer_ == id) {
+    ASYNC_INFO_LOG() << "Pinged " << pinged << " client(s) from server[" << server->GetFormatedName() << "], "
+                     << online_clients.size() << " client(s) connected.";
+  } else if (context->watchers_update_timer == id) {
+    redis::RedisWatchersCounter::counters_t watchers;
+    for (const auto& viewers : context->stream_viewers) {
+      watchers[viewers.first.ToString()] = viewers.second;
+    }
+    watchers_counter_->UpdateLocal(context - &loops_[0], watchers);
+  } else if (reread_cache_id_timer_ == id && context == &loops_[0]) {
     UpdateCache();
+    login_rate_limiter_.Prune(config_.server.login_rate_limits, std::chrono::steady_clock::now());
+  } else if (context->handshake_timer == id) {
+    CloseExpiredHandshakes(context);
   }
 }
 
@@ -143,24 +503,175 @@ void InnerTcpHandlerHost::ChildStatusChanged(common::libev::IoChild* client, int
 #endif
 
 void InnerTcpHandlerHost::Accepted(common::libev::IoClient* client) {
-  common::protocols::three_way_handshake::cmd_request_t whoareyou = WhoAreYouRequest(NextRequestID());
+  metrics::LoopMonitor::CallbackScope scope(FindLoopMonitor(client->GetServer()), metrics::LoopMonitor::ACCEPTED);
+  if (static_cast<InnerTcpClient*>(client)->IsMigrating()) {  // already handshaked in other loop
+    return;
+  }
+
+  connections_gauge_->Inc();
+  connections_count_++;
   InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-  if (iclient) {
-    common::ErrnoError err = iclient->Write(whoareyou);
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  LoopContext* context = FindLoopContext(client->GetServer());
+  if (context) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    PendingHandshake& handshake = context->handshakes[iclient];
+    handshake.deadline = now + std::chrono::seconds(config_.server.handshake_timeout_sec);
+    metrics::Counter* reject_reason = AdmitConnection(now);
+    if (reject_reason) {
+      reject_reason->Inc();
+      RejectConnection(context, iclient);
+      return;
     }
   }
+
+  common::protocols::three_way_handshake::cmd_request_t whoareyou = WhoAreYouRequest(NextRequestID());
+  common::ErrnoError err = iclient->Write(whoareyou);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+}
+
+metrics::Counter* InnerTcpHandlerHost::AdmitConnection(std::chrono::steady_clock::time_point now) {
+  if (config_.server.max_connections && connections_count_ > config_.server.max_connections) {
+    return rejected_by_limit_counter_;
+  }
+
+  if (!config_.server.accept_rate) {
+    return nullptr;
+  }
+
+  if (now - accept_window_start_ >= std::chrono::seconds(1)) {
+    accept_window_start_ = now;
+    accept_window_count_ = 0;
+  }
+  if (++accept_window_count_ > config_.server.accept_rate) {
+    return rejected_by_rate_counter_;
+  }
+  return nullptr;
+}
+
+void InnerTcpHandlerHost::RejectConnection(LoopContext* context, InnerTcpClient* client) {
+  // not closed in accept callback, loop still registering client
+  context->handshakes[client].rejected = true;
+  context->rejected.push_back(client);
+  if (context->rejected.size() == 1) {
+    common::libev::IoLoop* server = context->loop;
+    server->ExecInLoopThread([this, server]() { CloseRejectedConnections(server); });
+  }
+}
+
+void InnerTcpHandlerHost::CloseRejectedConnections(common::libev::IoLoop* server) {
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return;
+  }
+
+  std::vector<InnerTcpClient*> rejected;
+  rejected.swap(context->rejected);
+  for (InnerTcpClient* client : rejected) {
+    auto it = context->handshakes.find(client);
+    if (it == context->handshakes.end() || !it->second.rejected) {  // closed by peer
+      continue;
+    }
+
+    common::ErrnoError err = client->Close();
+    DCHECK(!err) << "Close client error: " << err->GetDescription();
+    delete client;
+  }
+}
+
+void InnerTcpHandlerHost::CloseExpiredHandshakes(LoopContext* context) {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<InnerTcpClient*> expired;
+  for (const auto& handshake : context->handshakes) {
+    if (!handshake.second.rejected && handshake.second.deadline <= now) {
+      expired.push_back(handshake.first);
+    }
+  }
+
+  for (InnerTcpClient* client : expired) {
+    handshake_timeouts_counter_->Inc();
+    DEBUG_LOG() << "Handshake timeout, client: " << client->GetFormatedName();
+    common::ErrnoError err = client->Close();
+    DCHECK(!err) << "Close client error: " << err->GetDescription();
+    delete client;
+  }
+}
+
+void InnerTcpHandlerHost::FinishHandshake(InnerTcpClient* client) {
+  LoopContext* context = FindLoopContext(client->GetServer());
+  if (context) {
+    context->handshakes.erase(client);
+  }
+}
+
+bool InnerTcpHandlerHost::IsRateLimited(InnerTcpClient* client, RateLimitClass cls) {
+  const RateLimit& limit = config_.server.rate_limits[cls];
+  const RateLimit& login_limit = config_.server.login_rate_limits[cls];
+  if (!limit.IsEnabled() && !login_limit.IsEnabled()) {
+    return false;
+  }
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  metrics::Counter* counter = nullptr;
+  if (!client->ConsumeRateLimit(cls, limit, now)) {
+    counter = connection_rate_limited_counters_[cls];
+  } else if (!client->IsAnonimUser() &&  // anonim login shared by all anonim users
+             !login_rate_limiter_.Consume(client->GetLoginSymbol(), cls, login_limit, now)) {
+    counter = login_rate_limited_counters_[cls];
+  }
+
+  if (!counter) {
+    return false;
+  }
+
+  counter->Inc();
+  const uint32_t limited = client->IncRateLimitedCount();
+  if ((limited & (limited - 1)) == 0) {  // 1, 2, 4, ... log not flooded by abusive peer
+    WARNING_LOG() << "Rate limited client: " << client->GetFormatedName() << ", login: " << client->GetLogin()
+                  << ", failed requests: " << limited;
+  }
+  return true;
+}
+
+void InnerTcpHandlerHost::WriteRateLimitedResponce(
+    InnerTcpClient* client,
+    const common::protocols::three_way_handshake::cmd_response_t& resp) {
+  common::ErrnoError err = client->Write(resp);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
 }
 
 void InnerTcpHandlerHost::Closed(common::libev::IoClient* client) {
+  metrics::LoopMonitor::CallbackScope scope(FindLoopMonitor(client->GetServer()), metrics::LoopMonitor::CLOSED);
   InnerTcpClient* iconnection = static_cast<InnerTcpClient*>(client);
-  AuthInfo auth = iconnection->GetServerHostInfo();
+  if (capture_) {
+    capture_->RecordClosed(iconnection);
+  }
+
   common::libev::IoLoop* server = client->GetServer();
-  SendLeaveChatMessage(server, iconnection->GetCurrentStreamId(), auth.GetLogin());
+  LoopContext* context = FindLoopContext(server);
+  if (context) {  // offloaded requests results dropped
+    context->jobs.erase(iconnection);
+    context->handshakes.erase(iconnection);
+  }
+
+  const Symbol sid = iconnection->GetCurrentStreamSymbol();
+  if (!sid.IsEmpty()) {
+    SendLeaveChatMessage(server, sid, iconnection->GetLogin());
+    RemoveStreamViewer(server, sid);
+  }
 
+  connections_gauge_->Dec();
+  connections_count_--;
   if (iconnection->IsAnonimUser()) {  // anonim user
-    INFO_LOG() << "Byu anonim user: " << auth.GetLogin();
+    anonim_users_gauge_->Dec();
+    INFO_LOG() << "Byu anonim user: " << iconnection->GetLogin();
+    return;
+  }
+
+  if (iconnection->GetUidSymbol().IsEmpty()) {  // rejected or closed before handshake
     return;
   }
 
@@ -170,12 +681,25 @@ void InnerTcpHandlerHost::Closed(common::libev::IoClient* client) {
     return;
   }
 
-  user_id_t uid = iconnection->GetUid();
-  PublishUserStateInfo(UserStateInfo(uid, auth.GetDeviceID(), false));
-  INFO_LOG() << "Byu registered user: " << auth.GetLogin();
+  const user_id_t uid = iconnection->GetUid();
+  if (devices_registry_) {
+    devices_registry_->UnRegister(uid, iconnection->GetDeviceID());
+  }
+  PublishUserStateInfo(UserStateInfo(uid, iconnection->GetDeviceID(), false));
+  registered_users_gauge_->Dec();
+  INFO_LOG() << "Byu registered user: " << iconnection->GetLogin();
 }
 
 void InnerTcpHandlerHost::DataReceived(common::libev::IoClient* client) {
+  metrics::LoopMonitor::CallbackScope scope(FindLoopMonitor(client->GetServer()),
+                                            metrics::LoopMonitor::DATA_RECEIVED);
+  if (metrics::RequestTracer::GetInstance()->IsEnabled()) {
+    LoopContext* context = FindLoopContext(client->GetServer());
+    if (context) {
+      context->read_start = std::chrono::steady_clock::now();
+    }
+  }
+
   std::string buff;
   InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
   common::ErrnoError err = iclient->ReadCommand(&buff);
@@ -187,6 +711,14 @@ void InnerTcpHandlerHost::DataReceived(common::libev::IoClient* client) {
     return;
   }
 
+  if (capture_) {
+    capture_->RecordFrame(iclient, buff);
+  }
+
+  if (IsJobsPending(iclient, buff)) {  // handled after offloaded, keeps order of responces
+    return;
+  }
+
   HandleInnerDataReceived(iclient, buff);
 }
 
@@ -195,16 +727,174 @@ void InnerTcpHandlerHost::DataReadyToWrite(common::libev::IoClient* client) {
 }
 
 common::Error InnerTcpHandlerHost::PublishToChannelOut(const std::string& msg) {
+  if (stream_commands_in_) {
+    return stream_commands_in_->AppendToStreamOut(msg);
+  }
   return sub_commands_in_->PublishToChannelOut(msg);
 }
 
+bool InnerTcpHandlerHost::PostExternalCommand(const ExternalCommand& cmd) {
+  if (!external_commands_.Push(cmd)) {
+    WARNING_LOG() << "External commands queue is full, command: " << cmd.command;
+    return false;
+  }
+
+  ScheduleExternalCommandsDrain();
+  return true;
+}
+
+void InnerTcpHandlerHost::AckExternalCommand(const std::string& stream_entry_id) {
+  if (!stream_commands_in_) {
+    return;
+  }
+
+  if (!stream_commands_in_->Ack(stream_entry_id)) {  // stays pending, will be redelivered after restart
+    WARNING_LOG() << "Acks queue is full, entry: " << stream_entry_id;
+  }
+}
+
+void InnerTcpHandlerHost::ScheduleExternalCommandsDrain() {
+  common::libev::IoLoop* server = loop_;
+  if (!server) {
+    return;
+  }
+
+  if (external_commands_drain_scheduled_.exchange(true)) {  // loop already woken up
+    return;
+  }
+
+  server->ExecInLoopThread([this]() { DrainExternalCommands(); });
+}
+
+void InnerTcpHandlerHost::DrainExternalCommands() {
+  external_commands_drain_scheduled_ = false;
+
+  ExternalCommand cmd;
+  size_t handled = 0;
+  while (handled < external_commands_batch_size && external_commands_.Pop(&cmd)) {
+    handler_->ExecuteCommand(cmd);  // acks stream entry when command finished, maybe in other loop
+    handled++;
+  }
+
+  if (handled == external_commands_batch_size) {  // maybe not empty, give time to clients
+    ScheduleExternalCommandsDrain();
+  }
+}
+
 void InnerTcpHandlerHost::UpdateCache() {
   std::vector<stream_id> channels;
   common::Error err = parent_->GetChatChannels(&channels);
   if (err) {
     return;
   }
-  chat_channels_ = channels;
+
+  std::unordered_set<Symbol> chat_channels;
+  for (const stream_id& sid : channels) {
+    Symbol channel;
+    if (!Symbol::Intern(sid, &channel)) {
+      WARNING_LOG() << SYMBOL_TABLE_FULL_ERROR << ", chat channel: " << sid;
+      continue;
+    }
+    chat_channels.insert(channel);
+  }
+
+  std::unique_lock<std::mutex> lock(chat_channels_mutex_);
+  chat_channels_.swap(chat_channels);
+}
+
+bool InnerTcpHandlerHost::IsChatChannel(Symbol sid) const {
+  std::unique_lock<std::mutex> lock(chat_channels_mutex_);
+  return chat_channels_.find(sid) != chat_channels_.end();
+}
+
+metrics::Histogram* InnerTcpHandlerHost::FindCommandDuration(const char* command) const {
+  auto it = commands_duration_.find(command);
+  if (it == commands_duration_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+InnerTcpHandlerHost::LoopContext* InnerTcpHandlerHost::FindLoopContext(common::libev::IoLoop* server) {
+  for (LoopContext& context : loops_) {
+    if (context.loop == server) {
+      return &context;
+    }
+  }
+  return nullptr;
+}
+
+const InnerTcpHandlerHost::LoopContext* InnerTcpHandlerHost::FindLoopContext(common::libev::IoLoop* server) const {
+  for (const LoopContext& context : loops_) {
+    if (context.loop == server) {
+      return &context;
+    }
+  }
+  return nullptr;
+}
+
+metrics::LoopMonitor* InnerTcpHandlerHost::FindLoopMonitor(common::libev::IoLoop* server) {
+  LoopContext* context = FindLoopContext(server);
+  return context ? context->monitor : nullptr;
+}
+
+common::libev::IoLoop* InnerTcpHandlerHost::GetStreamOwnerLoop(stream_id sid) const {
+  if (loops_.size() < 2) {
+    return nullptr;
+  }
+
+  return loops_[std::hash<stream_id>()(sid) % loops_.size()].loop;
+}
+
+void InnerTcpHandlerHost::MigrateClient(InnerTcpClient* client,
+                                        common::libev::IoLoop* target,
+                                        common::protocols::three_way_handshake::cmd_seq_t id,
+                                        Symbol channel) {
+  // leave previous stream here, all its viewers in this loop
+  common::libev::IoLoop* server = client->GetServer();
+  const Symbol prev_channel = client->GetCurrentStreamSymbol();
+  if (!prev_channel.IsEmpty()) {
+    client->SetCurrentStream(Symbol());
+    RemoveStreamViewer(server, prev_channel);
+    SendLeaveChatMessage(server, prev_channel, client->GetLogin());
+  }
+
+  std::deque<std::string> deferred;  // requests after this one, no offloaded pending here
+  LoopContext* context = FindLoopContext(server);
+  auto it = context->jobs.find(client);
+  if (it != context->jobs.end()) {
+    deferred.swap(it->second.deferred);
+    context->jobs.erase(it);
+  }
+
+  client->SetMigrating(true);
+  client->SetOwnerLoop(target);
+  server->UnRegisterClient(client);
+  target->ExecInLoopThread([this, target, client, id, channel, deferred]() {
+    target->RegisterClient(client);
+    client->SetMigrating(false);
+    HandleRuntimeChannelInfo(client, id, channel);
+    if (deferred.empty()) {
+      return;
+    }
+
+    const uint64_t generation = ++jobs_generation_;
+    ConnectionJobs jobs;
+    jobs.generation = generation;
+    jobs.deferred = deferred;
+    FindLoopContext(target)->jobs[client] = jobs;
+    HandleDeferredRequests(target, client, generation);
+  });
+}
+
+bool InnerTcpHandlerHost::ExecInConnectionLoop(user_id_t user, device_id_t dev, std::function<void()> func) const {
+  common::libev::IoLoop* owner = parent_->FindInnerConnectionLoop(user, dev);
+  if (!owner || owner->IsLoopThread()) {
+    return false;
+  }
+
+  owner->ExecInLoopThread(func);
+  return true;
 }
 
 void InnerTcpHandlerHost::PublishUserStateInfo(const UserStateInfo& state) {
@@ -228,12 +918,80 @@ inner::InnerTcpClient* InnerTcpHandlerHost::FindInnerConnectionByUserIDAndDevice
   return parent_->FindInnerConnectionByUserIDAndDeviceID(user, dev);
 }
 
+bool InnerTcpHandlerHost::IsClusterNodeChannel(const std::string& channel) const {
+  return devices_registry_ && channel == config_.server.redis.channel_node_prefix + config_.server.node_id;
+}
+
+bool InnerTcpHandlerHost::IsDevicesRegistryChannel(const std::string& channel) const {
+  return devices_registry_ && channel == config_.server.redis.channel_devices_registry;
+}
+
+void InnerTcpHandlerHost::ApplyDevicesRegistryChange(const std::string& change) {
+  if (!devices_registry_) {
+    return;
+  }
+
+  devices_registry_->ApplyChange(change);
+}
+
+bool InnerTcpHandlerHost::FindDeviceNode(user_id_t user, device_id_t dev, std::string* node) const {
+  if (!devices_registry_) {
+    return false;
+  }
+
+  std::string owner;
+  if (!devices_registry_->FindNode(user, dev, &owner) || owner == config_.server.node_id) {
+    return false;
+  }
+
+  *node = owner;
+  return true;
+}
+
+common::Error InnerTcpHandlerHost::ForwardToNode(const std::string& node, const std::string& msg, size_t* receivers) {
+  return sub_commands_in_->Publish(config_.server.redis.channel_node_prefix + node, msg, receivers);
+}
+
+void InnerTcpHandlerHost::HandleDeviceOwnedByOtherNode(const user_id_t& uid,
+                                                       const device_id_t& dev,
+                                                       const std::string& node) {
+  // registry thread, lost lease race, close local connection
+  common::libev::IoLoop* server = loop_;
+  if (!server) {
+    return;
+  }
+
+  WARNING_LOG() << "Double connection, device: " << dev << " already connected to node: " << node;
+  std::function<void()> close_cb = [this, uid, dev]() {
+    InnerTcpClient* fclient = parent_->FindInnerConnectionByUserIDAndDeviceID(uid, dev);
+    if (!fclient) {
+      return;
+    }
+
+    common::ErrnoError err = fclient->Close();
+    DCHECK(!err) << "Close client error: " << err->GetDescription();
+    delete fclient;
+  };
+  if (!ExecInConnectionLoop(uid, dev, close_cb)) {
+    server->ExecInLoopThread(close_cb);
+  }
+}
+
 void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
                                                     common::protocols::three_way_handshake::cmd_seq_t id,
                                                     int argc,
                                                     char* argv[]) {
   UNUSED(argc);
   char* command = argv[0];
+  metrics::ScopedLatency latency(FindCommandDuration(command));
+  metrics::RequestTracer* tracer = metrics::RequestTracer::GetInstance();
+  if (tracer->IsEnabled()) {
+    const LoopContext* context = FindLoopContext(connection->GetServer());
+    if (context) {
+      tracer->AddSpan(connection, id, "read_parse", command, context->read_start, std::chrono::steady_clock::now());
+    }
+  }
+  metrics::ScopedSpan span(connection, id, "dispatch", command);
   if (IS_EQUAL_COMMAND(command, CLIENT_PING)) {
     ClientPingInfo ping;
     json_object* jping_info = nullptr;
@@ -294,164 +1052,388 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
     return;
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_CHANNELS)) {
     inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-    AuthInfo hinf = client->GetServerHostInfo();
+    if (IsRateLimited(client, CHANNELS_RATE_LIMIT)) {
+      WriteRateLimitedResponce(client, GetChannelsResponceFail(id, RATE_LIMITED_ERROR));
+      return;
+    }
+
+    HandleGetChannels(client, id);
+    return;
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
+    inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
+    if (IsRateLimited(client, CHANNELS_RATE_LIMIT)) {
+      WriteRateLimitedResponce(client, GetRuntimeChannelInfoResponceFail(id, RATE_LIMITED_ERROR));
+      return;
+    }
+
+    if (argc > 1) {
+      Symbol channel;  // ids from the users channels interned on load, unknown never interned
+      if (!Symbol::Find(argv[1], &channel) || channel.IsEmpty()) {
+        common::ErrnoError err = common::make_errno_error("Unknown channel", EINVAL);
+        common::protocols::three_way_handshake::cmd_response_t resp =
+            GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
+        err = connection->Write(resp);
+        if (err) {
+          DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        }
+        return;
+      }
+
+      common::libev::IoLoop* owner = GetStreamOwnerLoop(channel.ToString());
+      if (owner && owner != client->GetServer()) {  // stream affinity, chat and watchers stay in one thread
+        MigrateClient(client, owner, id, channel);
+        return;
+      }
+
+      HandleRuntimeChannelInfo(client, id, channel);
+      return;
+    } else {
+      common::ErrnoError err = common::make_errno_error_inval();
+      common::protocols::three_way_handshake::cmd_response_t resp =
+          GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
+      err = connection->Write(resp);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      err = connection->Close();
+      DCHECK(!err) << "Close connection error: " << err->GetDescription();
+      delete connection;
+      return;
+    }
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
+    inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
+    if (IsRateLimited(client, CHAT_RATE_LIMIT)) {
+      WriteRateLimitedResponce(client, SendChatMessageResponceFail(id, RATE_LIMITED_ERROR));
+      return;
+    }
+
+    if (argc > 1) {
+      HandleSendChatMessage(client, id, argv[1]);
+      return;
+    } else {
+      common::ErrnoError err = common::make_errno_error_inval();
+      common::protocols::three_way_handshake::cmd_response_t resp =
+          SendChatMessageResponceFail(id, err->GetDescription());
+      err = connection->Write(resp);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      err = connection->Close();
+      DCHECK(!err) << "Close connection error: " << err->GetDescription();
+      delete connection;
+      return;
+    }
+  }
+
+  WARNING_LOG() << "UNKNOWN COMMAND: " << command;
+}
+
+void InnerTcpHandlerHost::HandleRuntimeChannelInfo(InnerTcpClient* client,
+                                                   common::protocols::three_way_handshake::cmd_seq_t id,
+                                                   Symbol channel) {
+  common::libev::IoLoop* server = client->GetServer();
+  bool is_anonim = client->IsAnonimUser();
+  const login_t& login = client->GetLogin();
+  const Symbol prev_channel = client->GetCurrentStreamSymbol();
+
+  client->SetCurrentStream(channel);
+  size_t watchers = GetOnlineUserByStreamId(server, channel);  // calc watchers
+  AddStreamViewer(server, channel, login, is_anonim);           // add to watcher
+  if (!prev_channel.IsEmpty()) {
+    RemoveStreamViewer(server, prev_channel);
+  }
+
+  RuntimeChannelInfo rinf;
+  rinf.SetChannelId(channel.ToString());
+  rinf.SetWatchersCount(watchers);
+  if (!is_anonim) {  // registered user
+    rinf.SetChatEnabled(false);
+    rinf.SetChatReadOnly(true);
+    rinf.SetChannelType(PRIVATE_CHANNEL);
+
+    if (IsChatChannel(channel)) {
+      rinf.SetChatEnabled(true);
+      rinf.SetChatReadOnly(false);
+      rinf.SetChannelType(OFFICAL_CHANNEL);
+    }
+  } else {  // anonim have only offical channels and readonly mode
+    rinf.SetChannelType(OFFICAL_CHANNEL);
+    rinf.SetChatEnabled(true);
+    rinf.SetChatReadOnly(true);
+  }
+
+  serializet_t rchannel_str;
+  common::Error err_ser = rinf.SerializeToString(&rchannel_str);
+  if (err_ser) {
+    DEBUG_MSG_ERROR(err_ser, common::logging::LOG_LEVEL_ERR);
+    return;
+  }
+
+  common::protocols::three_way_handshake::cmd_response_t channels_responce =
+      GetRuntimeChannelInfoResponceSuccsess(id, rchannel_str);
+  common::ErrnoError err = client->Write(channels_responce);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  } else {
+    if (prev_channel.IsEmpty()) {  // first channel
+      SendEnterChatMessage(server, channel, login);
+    } else {
+      SendLeaveChatMessage(server, prev_channel, login);
+      SendEnterChatMessage(server, channel, login);
+    }
+  }
+}
+
+namespace {
+
+struct ChannelsJob {
+  ChannelsJob() : find_err(), ser_err(), channels_str() {}
+
+  common::Error find_err;
+  common::Error ser_err;
+  serializet_t channels_str;
+};
+
+struct ChatMessageJob {
+  ChatMessageJob() : err(), sid(), msg_ser() {}
+
+  common::Error err;
+  stream_id sid;
+  serializet_t msg_ser;
+};
+
+}  // namespace
+
+void InnerTcpHandlerHost::HandleGetChannels(InnerTcpClient* client,
+                                            common::protocols::three_way_handshake::cmd_seq_t id) {
+  std::shared_ptr<ChannelsJob> job = std::make_shared<ChannelsJob>();
+  const AuthInfo hinf = client->GetServerHostInfo();
+  const void* scope = client;  // only for tracing, connection can be closed while job in progress
+  auto work = [this, hinf, job, scope, id]() {
+    metrics::ScopedSpan span(scope, id, "work", CLIENT_GET_CHANNELS);
     UserInfo user;
-    user_id_t uid;
-    common::Error err = parent_->FindUser(hinf, &uid, &user);
-    if (err) {
-      common::protocols::three_way_handshake::cmd_response_t resp = GetChannelsResponceFail(id, err->GetDescription());
-      common::ErrnoError err = connection->Write(resp);
+    user_id_t uid;
+    job->find_err = parent_->FindUser(hinf, &uid, &user);
+    if (job->find_err) {
+      return;
+    }
+
+    ChannelsInfo chan = user.GetChannelInfo();
+    if (!InternChannels(chan)) {
+      job->find_err = common::make_error(SYMBOL_TABLE_FULL_ERROR);
+      return;
+    }
+    job->ser_err = chan.SerializeToString(&job->channels_str);
+  };
+  auto done = [id, job](InnerTcpClient* client) {
+    metrics::ScopedSpan span(client, id, "respond", CLIENT_GET_CHANNELS);
+    if (job->find_err) {
+      common::protocols::three_way_handshake::cmd_response_t resp =
+          GetChannelsResponceFail(id, job->find_err->GetDescription());
+      common::ErrnoError err = client->Write(resp);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       }
-      err = connection->Close();
+      err = client->Close();
       DCHECK(!err) << "Close connection error: " << err->GetDescription();
-      delete connection;
+      delete client;
       return;
     }
 
-    serializet_t channels_str;
-    ChannelsInfo chan = user.GetChannelInfo();
-    common::Error err_ser = chan.SerializeToString(&channels_str);
-    if (err_ser) {
-      DEBUG_MSG_ERROR(err_ser, common::logging::LOG_LEVEL_ERR);
+    if (job->ser_err) {
+      DEBUG_MSG_ERROR(job->ser_err, common::logging::LOG_LEVEL_ERR);
       return;
     }
 
     common::protocols::three_way_handshake::cmd_response_t channels_responce =
-        GetChannelsResponceSuccsess(id, channels_str);
-    common::ErrnoError errn = connection->Write(channels_responce);
+        GetChannelsResponceSuccsess(id, job->channels_str);
+    common::ErrnoError errn = client->Write(channels_responce);
     if (errn) {
       DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
     }
+  };
+
+  if (!PostJob(client, work, done)) {
+    work();
+    done(client);
+  }
+}
+
+void InnerTcpHandlerHost::WriteSendChatMessageFail(InnerTcpClient* client,
+                                                   common::protocols::three_way_handshake::cmd_seq_t id,
+                                                   common::Error reason) {
+  common::protocols::three_way_handshake::cmd_response_t resp =
+      SendChatMessageResponceFail(id, reason->GetDescription());
+  common::ErrnoError err = client->Write(resp);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+  err = client->Close();
+  DCHECK(!err) << "Close connection error: " << err->GetDescription();
+  delete client;
+}
+
+void InnerTcpHandlerHost::HandleSendChatMessage(InnerTcpClient* client,
+                                                common::protocols::three_way_handshake::cmd_seq_t id,
+                                                const serializet_t& msg_str) {
+  ChatMessageHeader header;
+  // limit is for decoded message, escaped size near it decided by full parse
+  if (ScanChatMessage(msg_str.data(), msg_str.size(), &header) &&
+      (!header.message_escaped || header.message_size <= MAX_CHAT_MESSAGE_SIZE)) {
+    metrics::ScopedSpan span(client, id, "relay", CLIENT_SEND_CHAT_MESSAGE);
+    if (header.message_size > MAX_CHAT_MESSAGE_SIZE) {
+      WriteSendChatMessageFail(client, id, common::make_error_inval());
+      return;
+    }
+
+    BrodcastChatMessage(client->GetServer(), header.channel, msg_str);
+    common::protocols::three_way_handshake::cmd_response_t resp = SendChatMessageResponceSuccsess(id, msg_str);
+    common::ErrnoError err = client->Write(resp);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
     return;
-  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
-    inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-    if (argc > 1) {
-      common::libev::IoLoop* server = client->GetServer();
-      bool is_anonim = client->IsAnonimUser();
-      AuthInfo ainf = client->GetServerHostInfo();
-      const login_t login = ainf.GetLogin();
-      const stream_id channel = argv[1];
-      const stream_id prev_channel = client->GetCurrentStreamId();
-
-      size_t watchers = GetOnlineUserByStreamId(server, channel);  // calc watchers
-      client->SetCurrentStreamId(channel);                         // add to watcher
-
-      RuntimeChannelInfo rinf;
-      rinf.SetChannelId(channel);
-      rinf.SetWatchersCount(watchers);
-      if (!is_anonim) {  // registered user
-        rinf.SetChatEnabled(false);
-        rinf.SetChatReadOnly(true);
-        rinf.SetChannelType(PRIVATE_CHANNEL);
-
-        for (size_t i = 0; i < chat_channels_.size(); ++i) {
-          if (chat_channels_[i] == channel) {
-            rinf.SetChatEnabled(true);
-            rinf.SetChatReadOnly(false);
-            rinf.SetChannelType(OFFICAL_CHANNEL);
-            break;
-          }
-        }
-      } else {  // anonim have only offical channels and readonly mode
-        rinf.SetChannelType(OFFICAL_CHANNEL);
-        rinf.SetChatEnabled(true);
-        rinf.SetChatReadOnly(true);
-      }
+  }
 
-      serializet_t rchannel_str;
-      common::Error err_ser = rinf.SerializeToString(&rchannel_str);
-      if (err_ser) {
-        DEBUG_MSG_ERROR(err_ser, common::logging::LOG_LEVEL_ERR);
-        return;
-      }
+  std::shared_ptr<ChatMessageJob> job = std::make_shared<ChatMessageJob>();
+  const void* scope = client;
+  auto work = [msg_str, job, scope, id]() {
+    metrics::ScopedSpan span(scope, id, "work", CLIENT_SEND_CHAT_MESSAGE);
+    json_object* jmsg = json_tokener_parse(msg_str.c_str());
+    if (!jmsg) {
+      job->err = common::make_error_inval();
+      return;
+    }
 
-      common::protocols::three_way_handshake::cmd_response_t channels_responce =
-          GetRuntimeChannelInfoResponceSuccsess(id, rchannel_str);
-      common::ErrnoError err = connection->Write(channels_responce);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      } else {
-        if (prev_channel == invalid_stream_id) {  // first channel
-          SendEnterChatMessage(server, channel, login);
-        } else {
-          SendLeaveChatMessage(server, prev_channel, login);
-          SendEnterChatMessage(server, channel, login);
-        }
-      }
+    ChatMessage msg;
+    job->err = msg.DeSerialize(jmsg);
+    json_object_put(jmsg);
+    if (job->err) {
       return;
-    } else {
-      common::ErrnoError err = common::make_errno_error_inval();
-      common::protocols::three_way_handshake::cmd_response_t resp =
-          GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
-      err = connection->Write(resp);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
-      err = connection->Close();
-      DCHECK(!err) << "Close connection error: " << err->GetDescription();
-      delete connection;
+    }
+
+    if (msg.GetMessage().size() > MAX_CHAT_MESSAGE_SIZE) {
+      job->err = common::make_error_inval();
       return;
     }
-  } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
-    if (argc > 1) {
-      inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-      serializet_t msg_str = argv[1];
-      json_object* jmsg = json_tokener_parse(argv[1]);
-      if (!jmsg) {
-        common::ErrnoError err = common::make_errno_error_inval();
-        common::protocols::three_way_handshake::cmd_response_t resp =
-            SendChatMessageResponceFail(id, err->GetDescription());
-        err = connection->Write(resp);
-        if (err) {
-          DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        }
-        err = connection->Close();
-        DCHECK(!err) << "Close connection error: " << err->GetDescription();
-        delete connection;
-        return;
-      }
 
-      ChatMessage msg;
-      common::Error err_des = msg.DeSerialize(jmsg);
-      json_object_put(jmsg);
-      if (err_des) {
-        common::protocols::three_way_handshake::cmd_response_t resp =
-            SendChatMessageResponceFail(id, err_des->GetDescription());
-        common::ErrnoError err = connection->Write(resp);
-        if (err) {
-          DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        }
-        err = connection->Close();
-        DCHECK(!err) << "Close connection error: " << err->GetDescription();
-        delete connection;
-        return;
-      }
+    job->sid = msg.GetChannelId();
+    job->err = msg.SerializeToString(&job->msg_ser);
+  };
+  auto done = [this, id, msg_str, job](InnerTcpClient* client) {
+    metrics::ScopedSpan span(client, id, "respond", CLIENT_SEND_CHAT_MESSAGE);
+    if (job->err) {
+      WriteSendChatMessageFail(client, id, job->err);
+      return;
+    }
 
-      BrodcastChatMessage(client->GetServer(), msg);
-      common::protocols::three_way_handshake::cmd_response_t resp = SendChatMessageResponceSuccsess(id, msg_str);
-      common::ErrnoError err = connection->Write(resp);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+    BrodcastChatMessage(client->GetServer(), job->sid, job->msg_ser);
+    common::protocols::three_way_handshake::cmd_response_t resp = SendChatMessageResponceSuccsess(id, msg_str);
+    common::ErrnoError err = client->Write(resp);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+  };
+
+  if (!PostJob(client, work, done)) {
+    work();
+    done(client);
+  }
+}
+
+bool InnerTcpHandlerHost::PostJob(InnerTcpClient* client,
+                                  std::function<void()> work,
+                                  std::function<void(InnerTcpClient*)> done) {
+  if (!workers_) {
+    return false;
+  }
+
+  common::libev::IoLoop* server = client->GetServer();
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return false;
+  }
+
+  auto it = context->jobs.find(client);
+  if (it == context->jobs.end()) {
+    it = context->jobs.insert(std::make_pair(client, ConnectionJobs())).first;
+    it->second.generation = ++jobs_generation_;
+  }
+
+  const uint64_t generation = it->second.generation;
+  bool posted = workers_->Post([this, server, client, generation, work, done]() {
+    work();
+    server->ExecInLoopThread([this, server, client, generation, done]() {
+      pending_requests_gauge_->Dec();
+      FinishJob(server, client, generation, done);
+    });
+  });
+  if (!posted) {
+    if (it->second.pending == 0 && it->second.deferred.empty()) {
+      context->jobs.erase(it);
+    }
+    return false;
+  }
+
+  it->second.pending++;
+  pending_requests_gauge_->Inc();
+  return true;
+}
+
+void InnerTcpHandlerHost::FinishJob(common::libev::IoLoop* server,
+                                    InnerTcpClient* client,
+                                    uint64_t generation,
+                                    std::function<void(InnerTcpClient*)> done) {
+  LoopContext* context = FindLoopContext(server);
+  auto it = context->jobs.find(client);
+  if (it == context->jobs.end() || it->second.generation != generation) {  // connection closed
+    return;
+  }
+
+  it->second.pending--;
+  done(client);
+  HandleDeferredRequests(server, client, generation);
+}
+
+void InnerTcpHandlerHost::HandleDeferredRequests(common::libev::IoLoop* server,
+                                                 InnerTcpClient* client,
+                                                 uint64_t generation) {
+  LoopContext* context = FindLoopContext(server);
+  while (true) {  // connection can be closed, migrated or offload again in any request
+    auto it = context->jobs.find(client);
+    if (it == context->jobs.end() || it->second.generation != generation) {
       return;
-    } else {
-      common::ErrnoError err = common::make_errno_error_inval();
-      common::protocols::three_way_handshake::cmd_response_t resp =
-          SendChatMessageResponceFail(id, err->GetDescription());
-      err = connection->Write(resp);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
-      err = connection->Close();
-      DCHECK(!err) << "Close connection error: " << err->GetDescription();
-      delete connection;
+    }
+
+    ConnectionJobs& jobs = it->second;
+    if (jobs.pending != 0) {
+      return;
+    }
+
+    if (jobs.deferred.empty()) {
+      context->jobs.erase(it);
       return;
     }
+
+    const std::string input_command = jobs.deferred.front();
+    jobs.deferred.pop_front();
+    HandleInnerDataReceived(client, input_command);
+  }
+}
+
+bool InnerTcpHandlerHost::IsJobsPending(InnerTcpClient* client, const std::string& input_command) {
+  LoopContext* context = FindLoopContext(client->GetServer());
+  if (!context) {
+    return false;
   }
 
-  WARNING_LOG() << "UNKNOWN COMMAND: " << command;
+  auto it = context->jobs.find(client);
+  if (it == context->jobs.end()) {
+    return false;
+  }
+
+  it->second.deferred.push_back(input_command);
+  return true;
 }
 
 void InnerTcpHandlerHost::HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
@@ -494,6 +1476,7 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
     int argc,
     char* argv[]) {
   char* command = argv[1];
+  metrics::ScopedLatency latency(FindCommandDuration(command));
   if (IS_EQUAL_COMMAND(command, SERVER_PING)) {
     json_object* obj = nullptr;
     common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
@@ -546,7 +1529,11 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
 
     user_id_t uid;
     UserInfo registered_user;
-    common::Error err_find = parent_->FindUser(uauth, &uid, &registered_user);
+    common::Error err_find;
+    {
+      metrics::ScopedLatency latency(handshake_find_user_duration_);
+      err_find = parent_->FindUser(uauth, &uid, &registered_user);
+    }
     if (err_find) {
       common::protocols::three_way_handshake::cmd_approve_t resp =
           WhoAreYouApproveResponceFail(id, err_find->GetDescription());
@@ -561,6 +1548,13 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
       ignore_result(connection->Write(resp));
       return common::make_errno_error(error_str, EINVAL);
     }
+    if (!InternUser(uid, uauth) || !InternChannels(registered_user.GetChannelInfo())) {
+      const std::string error_str = SYMBOL_TABLE_FULL_ERROR;
+      ASYNC_LOG_RATE_LIMITED(common::logging::LOG_LEVEL_ERR, 1) << error_str << ", login: " << uauth.GetLogin();
+      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
+      ignore_result(connection->Write(resp));
+      return common::make_errno_error(error_str, ENOMEM);
+    }
 
     if (uauth == InnerTcpClient::anonim_user) {  // anonim user
       common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceSuccsess(id);
@@ -571,6 +1565,8 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
 
       InnerTcpClient* inner_conn = static_cast<InnerTcpClient*>(connection);
       inner_conn->SetServerHostInfo(uauth);
+      FinishHandshake(inner_conn);
+      anonim_users_gauge_->Inc();
       INFO_LOG() << "Welcome anonim user: " << uauth.GetLogin();
       return common::ErrnoError();
     }
@@ -584,18 +1580,35 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
       return common::make_errno_error(error_str, EINVAL);
     }
 
-    common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceSuccsess(id);
-    common::ErrnoError errn = connection->Write(resp);
-    if (errn) {
-      return errn;
+    std::string owner_node;
+    if (FindDeviceNode(uid, dev, &owner_node)) {
+      const std::string error_str = "Double connection reject, connected to node: " + owner_node;
+      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
+      ignore_result(connection->Write(resp));
+      return common::make_errno_error(error_str, EINVAL);
     }
 
+    metrics::ScopedLatency latency(handshake_register_duration_);
     common::Error err = parent_->RegisterInnerConnectionByUser(uid, uauth, connection);
-    CHECK(!err) << "Register inner connection error: " << err->GetDescription();
+    if (err) {  // same device handshaked concurrently in other loop
+      const std::string error_str = "Double connection reject";
+      WARNING_LOG() << error_str << ", device: " << dev << ", " << err->GetDescription();
+      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
+      ignore_result(connection->Write(resp));
+      return common::make_errno_error(error_str, EINVAL);
+    }
+    FinishHandshake(static_cast<InnerTcpClient*>(connection));
 
+    if (devices_registry_) {  // lease claimed async, conflict resolved in HandleDeviceOwnedByOtherNode
+      devices_registry_->Register(uid, dev);
+    }
     PublishUserStateInfo(UserStateInfo(uid, dev, true));
+    registered_users_gauge_->Inc();
     INFO_LOG() << "Welcome registered user: " << uauth.GetLogin();
-    return common::ErrnoError();
+
+    // registered, on write error closed and unregistered as any other user
+    common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceSuccsess(id);
+    return connection->Write(resp);
   } else if (IS_EQUAL_COMMAND(command, SERVER_GET_CLIENT_INFO)) {
     json_object* obj = nullptr;
     common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
@@ -650,6 +1663,12 @@ common::ErrnoError InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
 
     common::protocols::three_way_handshake::cmd_approve_t resp = ServerSendChatMessageApproveResponceSuccsess(id);
     return connection->Write(resp);
+  } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGES)) {
+    common::protocols::three_way_handshake::cmd_approve_t resp = ServerSendChatMessagesApproveResponceSuccsess(id);
+    return connection->Write(resp);
+  } else if (IS_EQUAL_COMMAND(command, SERVER_PRESENCE)) {
+    common::protocols::three_way_handshake::cmd_approve_t resp = ServerPresenceApproveResponceSuccsess(id);
+    return connection->Write(resp);
   }
 
   const std::string error_str = common::MemSPrintf("UNKNOWN RESPONCE COMMAND: %s", command);
@@ -725,12 +1744,99 @@ common::Error InnerTcpHandlerHost::ParserResponceResponceCommand(int argc, char*
   return common::Error();
 }
 
-void InnerTcpHandlerHost::SendEnterChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login) {
-  BrodcastChatMessage(server, MakeEnterMessage(sid, login));
+void InnerTcpHandlerHost::SendEnterChatMessage(common::libev::IoLoop* server, Symbol sid, login_t login) {
+  LoopContext* context = config_.server.presence_interval_msec ? FindLoopContext(server) : nullptr;
+  if (context) {
+    context->presence[sid]++;
+    const uint32_t sample = config_.server.presence_join_sample;
+    if (sample && ++context->presence_joins % sample == 0) {  // clients without presence never see leaves either
+      SendPresenceNotice(server, sid, MakeEnterMessage(sid.ToString(), login));
+    }
+    return;
+  }
+
+  BrodcastChatMessage(server, MakeEnterMessage(sid.ToString(), login));
+}
+
+void InnerTcpHandlerHost::SendLeaveChatMessage(common::libev::IoLoop* server, Symbol sid, login_t login) {
+  LoopContext* context = config_.server.presence_interval_msec ? FindLoopContext(server) : nullptr;
+  if (context) {
+    context->presence[sid]--;
+    return;
+  }
+
+  BrodcastChatMessage(server, MakeLeaveMessage(sid.ToString(), login));
+}
+
+void InnerTcpHandlerHost::FlushPresence(LoopContext* context) {
+  if (context->presence.empty()) {
+    return;
+  }
+
+  std::unordered_map<Symbol, int64_t> presence;
+  presence.swap(context->presence);
+  common::libev::IoLoop* server = context->loop;
+  std::unordered_map<Symbol, serializet_t> frames;
+  for (const auto& stream : presence) {
+    if (!stream.second) {  // left and came back
+      continue;
+    }
+
+    const PresenceInfo info(stream.first.ToString(), GetOnlineUserByStreamId(server, stream.first), stream.second);
+    common::Error err = info.SerializeToString(&frames[stream.first]);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      frames.erase(stream.first);
+    }
+  }
+
+  if (frames.empty()) {
+    return;
+  }
+
+  std::vector<common::libev::IoClient*> online_clients = server->GetClients();
+  for (size_t i = 0; i < online_clients.size(); ++i) {
+    InnerTcpClient* iclient = static_cast<InnerTcpClient*>(online_clients[i]);
+    if (!iclient || !iclient->HaveFeature(PRESENCE_FEATURE)) {
+      continue;
+    }
+
+    auto it = frames.find(iclient->GetCurrentStreamSymbol());
+    if (it == frames.end()) {
+      continue;
+    }
+
+    const common::protocols::three_way_handshake::cmd_request_t presence_request =
+        ServerPresenceRequest(NextRequestID(), it->second);
+    common::ErrnoError errn = iclient->Write(presence_request);
+    if (errn) {
+      DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
+    }
+  }
 }
 
-void InnerTcpHandlerHost::SendLeaveChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login) {
-  BrodcastChatMessage(server, MakeLeaveMessage(sid, login));
+void InnerTcpHandlerHost::SendPresenceNotice(common::libev::IoLoop* server, Symbol sid, const ChatMessage& msg) {
+  serializet_t msg_ser;
+  common::Error err = msg.SerializeToString(&msg_ser);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    return;
+  }
+
+  std::vector<common::libev::IoClient*> online_clients = server->GetClients();
+  for (size_t i = 0; i < online_clients.size(); ++i) {
+    InnerTcpClient* iclient = static_cast<InnerTcpClient*>(online_clients[i]);
+    if (!iclient || !iclient->HaveFeature(PRESENCE_FEATURE) || iclient->GetCurrentStreamSymbol() != sid) {
+      continue;
+    }
+
+    const common::protocols::three_way_handshake::cmd_request_t message_request =
+        ServerSendChatMessageRequest(NextRequestID(), msg_ser);
+    common::ErrnoError errn = iclient->Write(message_request);
+    if (errn) {
+      DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
+    }
+  }
 }
 
 void InnerTcpHandlerHost::BrodcastChatMessage(common::libev::IoLoop* server, const ChatMessage& msg) {
@@ -741,32 +1847,176 @@ void InnerTcpHandlerHost::BrodcastChatMessage(common::libev::IoLoop* server, con
     return;
   }
 
+  BrodcastChatMessage(server, msg.GetChannelId(), msg_ser);
+}
+
+void InnerTcpHandlerHost::BrodcastChatMessage(common::libev::IoLoop* server,
+                                              stream_id sid,
+                                              const serializet_t& msg_ser) {
+  BrodcastLocalChatMessage(server, sid, msg_ser);
+  if (chat_fanout_) {
+    chat_fanout_->Publish(sid, msg_ser);
+  }
+}
+
+void InnerTcpHandlerHost::BrodcastLocalChatMessage(common::libev::IoLoop* server,
+                                                   stream_id sid,
+                                                   const serializet_t& msg_ser) {
+  Symbol channel;  // ids from chat messages never interned, unknown id has no local viewers
+  if (!Symbol::Find(sid, &channel) || channel.IsEmpty()) {
+    return;
+  }
+
+  if (config_.server.chat_batch_window_msec) {
+    LoopContext* context = FindLoopContext(server);
+    if (context) {
+      context->pending_chat[channel].push_back(msg_ser);
+      return;
+    }
+  }
+
+  DeliverChatMessages(server, channel, {msg_ser});
+}
+
+void InnerTcpHandlerHost::FlushPendingChatMessages(LoopContext* context) {
+  if (context->pending_chat.empty()) {
+    return;
+  }
+
+  std::unordered_map<Symbol, std::vector<serializet_t>> pending;
+  pending.swap(context->pending_chat);
+  for (const auto& stream : pending) {
+    DeliverChatMessages(context->loop, stream.first, stream.second);
+  }
+}
+
+void InnerTcpHandlerHost::DeliverChatMessages(common::libev::IoLoop* server,
+                                              Symbol sid,
+                                              const std::vector<serializet_t>& msgs) {
+  metrics::ScopedLatency latency(broadcast_duration_);
+  size_t msgs_size = 0;
+  for (const serializet_t& msg_ser : msgs) {
+    msgs_size += msg_ser.size();
+  }
+  FASTOTV_PROBE2(broadcast_start, sid.ToString().c_str(), msgs_size);
+  size_t recipients = 0;
+  serializet_t batch;  // built on first batching client
   std::vector<common::libev::IoClient*> online_clients = server->GetClients();
   for (size_t i = 0; i < online_clients.size(); ++i) {
     common::libev::IoClient* client = online_clients[i];
     InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-    if (iclient && iclient->GetCurrentStreamId() == msg.GetChannelId()) {
-      const common::protocols::three_way_handshake::cmd_request_t message_request =
-          ServerSendChatMessageRequest(NextRequestID(), msg_ser);
-      common::ErrnoError errn = iclient->Write(message_request);
-      if (errn) {
-        DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
+    if (!iclient || iclient->GetCurrentStreamSymbol() != sid) {
+      continue;
+    }
+
+    common::ErrnoError errn;
+    if (msgs.size() > 1 && iclient->HaveFeature(CHAT_BATCH_FEATURE)) {
+      if (batch.empty()) {
+        batch = MakeChatMessagesBatch(msgs);
+      }
+      const common::protocols::three_way_handshake::cmd_request_t batch_request =
+          ServerSendChatMessagesRequest(NextRequestID(), batch);
+      errn = iclient->Write(batch_request);
+    } else {
+      for (size_t j = 0; j < msgs.size() && !errn; ++j) {
+        const common::protocols::three_way_handshake::cmd_request_t message_request =
+            ServerSendChatMessageRequest(NextRequestID(), msgs[j]);
+        errn = iclient->Write(message_request);
       }
     }
+    if (errn) {
+      DEBUG_MSG_ERROR(errn, common::logging::LOG_LEVEL_ERR);
+      continue;
+    }
+    recipients++;
+  }
+  FASTOTV_PROBE2(broadcast_done, sid.ToString().c_str(), recipients);
+}
+
+void InnerTcpHandlerHost::HandleChatFrame(const std::string& sid, const std::vector<std::string>& messages) {
+  // fan-out thread, frames from other nodes
+  common::libev::IoLoop* server = GetStreamOwnerLoop(sid);
+  if (!server) {
+    server = loop_;
+  }
+  if (!server) {
+    return;
+  }
+
+  server->ExecInLoopThread([this, server, sid, messages]() {
+    for (const std::string& msg_ser : messages) {
+      BrodcastLocalChatMessage(server, sid, msg_ser);
+    }
+  });
+}
+
+void InnerTcpHandlerHost::AddStreamViewer(common::libev::IoLoop* server,
+                                          Symbol sid,
+                                          const login_t& login,
+                                          bool is_anonim) {
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return;
+  }
+
+  FindStreamViewersGauge(context, sid)->Inc();
+  size_t& viewers = context->stream_viewers[sid];
+  if (viewers++ == 0 && chat_fanout_) {
+    chat_fanout_->Subscribe(sid.ToString());
+  }
+
+  if (watchers_counter_ && !is_anonim) {
+    watchers_counter_->AddUniqueViewer(sid.ToString(), login);
+  }
+}
+
+void InnerTcpHandlerHost::RemoveStreamViewer(common::libev::IoLoop* server, Symbol sid) {
+  LoopContext* context = FindLoopContext(server);
+  if (!context) {
+    return;
+  }
+
+  auto it = context->stream_viewers.find(sid);
+  if (it == context->stream_viewers.end()) {
+    return;
+  }
+
+  FindStreamViewersGauge(context, sid)->Dec();
+  if (--it->second == 0) {
+    context->stream_viewers.erase(it);
+    if (chat_fanout_) {
+      chat_fanout_->UnSubscribe(sid.ToString());
+    }
+  }
+}
+
+metrics::Gauge* InnerTcpHandlerHost::FindStreamViewersGauge(LoopContext* context, Symbol sid) {
+  auto it = context->stream_viewers_gauges.find(sid);
+  if (it != context->stream_viewers_gauges.end()) {
+    return it->second;
   }
+
+  // series never removed, private channel ids would grow them without bound
+  const std::string label = IsChatChannel(sid) ? sid.ToString() : OTHER_STREAMS_LABEL;
+  metrics::Gauge* gauge = metrics::Registry::GetInstance()->GetGauge(STREAM_VIEWERS_METRIC, "Local viewers of stream.",
+                                                                     {{"stream", label}});
+  context->stream_viewers_gauges[sid] = gauge;
+  return gauge;
 }
 
-size_t InnerTcpHandlerHost::GetOnlineUserByStreamId(common::libev::IoLoop* server, stream_id sid) const {
+size_t InnerTcpHandlerHost::GetOnlineUserByStreamId(common::libev::IoLoop* server, Symbol sid) const {
   size_t total = 0;
-  std::vector<common::libev::IoClient*> online_clients = server->GetClients();
-  for (size_t i = 0; i < online_clients.size(); ++i) {
-    common::libev::IoClient* client = online_clients[i];
-    InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-    if (iclient && iclient->GetCurrentStreamId() == sid) {
-      total++;
+  const LoopContext* context = FindLoopContext(server);
+  if (context) {
+    auto it = context->stream_viewers.find(sid);
+    if (it != context->stream_viewers.end()) {
+      total = it->second;
     }
   }
 
+  if (watchers_counter_) {  // other nodes, published with few seconds delay
+    total += watchers_counter_->GetStreamStat(sid.ToString()).watchers;
+  }
   return total;
 }
 
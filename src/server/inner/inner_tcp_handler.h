@@ -18,8 +18,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>  // for shared_ptr
+#include <mutex>
 #include <string>  // for string
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <common/error.h>                   // for Error
@@ -30,8 +37,14 @@
 #include "commands/commands.h"
 #include "inner/inner_server_command_seq_parser.h"  // for InnerServerComman...
 
-#include "server/config.h"  // for Config
+#include "server/bounded_mpsc_queue.h"             // for BoundedMPSCQueue
+#include "server/config.h"                         // for Config
+#include "server/inner/inner_external_notifier.h"  // for ExternalCommand
+#include "server/rate_limiter.h"                   // for LoginRateLimiter
+#include "server/redis/redis_chat_fanout.h"        // for RedisChatFanoutHandler
+#include "server/redis/redis_devices_registry.h"   // for RedisDevicesRegistryObserver
 #include "server/user_info.h"
+#include "symbol.h"
 
 #include "commands_info/chat_message.h"
 
@@ -59,23 +72,48 @@ class InnerClient;
 namespace server {
 class UserStateInfo;
 class ServerHost;
+class WorkerPool;
+namespace capture {
+class TrafficCapture;
+}
+namespace metrics {
+class Counter;
+class Gauge;
+class Histogram;
+class LoopMonitor;
+class LoopWatchdog;
+}  // namespace metrics
 namespace redis {
 class RedisPubSub;
-}
+class RedisStreamConsumer;
+class RedisDevicesRegistry;
+class RedisChatFanout;
+class RedisWatchersCounter;
+}  // namespace redis
 namespace inner {
 
-class InnerSubHandler;
 class InnerTcpClient;
 
-class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser, public common::libev::IoLoopObserver {
+class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser,
+                            public common::libev::IoLoopObserver,
+                            public redis::RedisDevicesRegistryObserver,
+                            public redis::RedisChatFanoutHandler {
  public:
   enum {
     ping_timeout_clients = 60,  // sec
-    reread_cache_timeout = 150
+    reread_cache_timeout = 150,
+    watchers_update_timeout = 1,
+    handshake_check_timeout = 1,
+    lag_probe_interval_msec = 100,
+    external_commands_queue_size = 4096,
+    external_commands_batch_size = 64,
+    worker_queue_size = 1024
   };
 
   explicit InnerTcpHandlerHost(ServerHost* parent, const Config& config);
 
+  void SetIoLoops(const std::vector<common::libev::IoLoop*>& loops);  // first is accepting, before loops started
+
   void PreLooped(common::libev::IoLoop* server) override;
 
   void Accepted(common::libev::IoClient* client) override;
@@ -95,10 +133,109 @@ class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser,
   virtual ~InnerTcpHandlerHost();
 
   common::Error PublishToChannelOut(const std::string& msg);
+  bool PostExternalCommand(const ExternalCommand& cmd);  // thread safe, false if queue is full
+  void AckExternalCommand(const std::string& stream_entry_id);  // thread safe
   inner::InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(user_id_t user, device_id_t dev) const;
+  // true if func will be executed in other connection loop
+  bool ExecInConnectionLoop(user_id_t user, device_id_t dev, std::function<void()> func) const;
+
+  // cluster mode
+  bool IsClusterNodeChannel(const std::string& channel) const;
+  bool IsDevicesRegistryChannel(const std::string& channel) const;
+  void ApplyDevicesRegistryChange(const std::string& change);  // thread safe
+  bool FindDeviceNode(user_id_t user, device_id_t dev, std::string* node) const;  // other node, thread safe
+  common::Error ForwardToNode(const std::string& node, const std::string& msg, size_t* receivers) WARN_UNUSED_RESULT;
+
+  void HandleDeviceOwnedByOtherNode(const user_id_t& uid, const device_id_t& dev, const std::string& node) override;
+  void HandleChatFrame(const std::string& sid, const std::vector<std::string>& messages) override;
 
  private:
+  struct ConnectionJobs {
+    ConnectionJobs();
+
+    uint64_t generation;              // distinguishes new connection with same address
+    size_t pending;                   // offloaded requests
+    std::deque<std::string> deferred;  // requests received while pending, for ordering
+  };
+
+  struct PendingHandshake {
+    PendingHandshake();
+
+    std::chrono::steady_clock::time_point deadline;
+    bool rejected;  // admission control, closed in next loop iteration
+  };
+
+  struct LoopContext {
+    LoopContext();
+
+    common::libev::IoLoop* loop;
+    common::libev::timer_id_t ping_timer;
+    common::libev::timer_id_t watchers_update_timer;
+    common::libev::timer_id_t lag_probe_timer;
+    common::libev::timer_id_t handshake_timer;
+    common::libev::timer_id_t chat_batch_timer;
+    common::libev::timer_id_t presence_timer;
+    metrics::LoopMonitor* monitor;
+    std::chrono::steady_clock::time_point read_start;  // current frame, only if tracing enabled
+    std::unordered_map<Symbol, size_t> stream_viewers;  // local clients, loop thread only
+    std::unordered_map<Symbol, metrics::Gauge*> stream_viewers_gauges;  // never erased, known channels only
+    std::unordered_map<InnerTcpClient*, ConnectionJobs> jobs;
+    std::unordered_map<InnerTcpClient*, PendingHandshake> handshakes;  // accepted, not authorized yet
+    std::vector<InnerTcpClient*> rejected;
+    std::unordered_map<Symbol, std::vector<serializet_t>> pending_chat;  // delivered on chat_batch_timer
+    std::unordered_map<Symbol, int64_t> presence;                        // viewers changes, on presence_timer
+    uint64_t presence_joins;                                             // join notices sampling
+  };
+
+  // admission control, accepting loop thread only
+  metrics::Counter* AdmitConnection(std::chrono::steady_clock::time_point now);  // rejection reason, nullptr if ok
+  void RejectConnection(LoopContext* context, InnerTcpClient* client);
+  void CloseRejectedConnections(common::libev::IoLoop* server);
+  void CloseExpiredHandshakes(LoopContext* context);
+  void FinishHandshake(InnerTcpClient* client);
+
+  // connection and login buckets, true if request should be failed
+  bool IsRateLimited(InnerTcpClient* client, RateLimitClass cls);
+  void WriteRateLimitedResponce(InnerTcpClient* client,
+                                const common::protocols::three_way_handshake::cmd_response_t& resp);
+
+  // work executed in worker pool, done in connection loop if connection still alive
+  // false if pool is busy, caller should handle request inline
+  bool PostJob(InnerTcpClient* client, std::function<void()> work, std::function<void(InnerTcpClient*)> done);
+  void FinishJob(common::libev::IoLoop* server,
+                 InnerTcpClient* client,
+                 uint64_t generation,
+                 std::function<void(InnerTcpClient*)> done);
+  void HandleDeferredRequests(common::libev::IoLoop* server, InnerTcpClient* client, uint64_t generation);
+  bool IsJobsPending(InnerTcpClient* client, const std::string& input_command);  // defer input if pending
+
+  void HandleGetChannels(InnerTcpClient* client, common::protocols::three_way_handshake::cmd_seq_t id);
+  // plain messages relayed as received, others parsed in worker pool
+  void HandleSendChatMessage(InnerTcpClient* client,
+                             common::protocols::three_way_handshake::cmd_seq_t id,
+                             const serializet_t& msg_str);
+  void WriteSendChatMessageFail(InnerTcpClient* client,
+                                common::protocols::three_way_handshake::cmd_seq_t id,
+                                common::Error reason);  // closes connection
+
+  LoopContext* FindLoopContext(common::libev::IoLoop* server);
+  const LoopContext* FindLoopContext(common::libev::IoLoop* server) const;
+  metrics::LoopMonitor* FindLoopMonitor(common::libev::IoLoop* server);
+  common::libev::IoLoop* GetStreamOwnerLoop(stream_id sid) const;  // nullptr if affinity disabled
+  void MigrateClient(InnerTcpClient* client,
+                     common::libev::IoLoop* target,
+                     common::protocols::three_way_handshake::cmd_seq_t id,
+                     Symbol channel);
+  void HandleRuntimeChannelInfo(InnerTcpClient* client,
+                                common::protocols::three_way_handshake::cmd_seq_t id,
+                                Symbol channel);
+
   void UpdateCache();
+  bool IsChatChannel(Symbol sid) const;
+  metrics::Histogram* FindCommandDuration(const char* command) const;  // nullptr if unknown
+
+  void ScheduleExternalCommandsDrain();
+  void DrainExternalCommands();
 
   void PublishUserStateInfo(const UserStateInfo& state);
 
@@ -127,21 +264,68 @@ class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser,
 
   common::Error ParserResponceResponceCommand(int argc, char* argv[], json_object** out) WARN_UNUSED_RESULT;
 
-  void SendEnterChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login);
-  void SendLeaveChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login);
+  // broadcasted, or only counted for next presence if presence enabled
+  void SendEnterChatMessage(common::libev::IoLoop* server, Symbol sid, login_t login);
+  void SendLeaveChatMessage(common::libev::IoLoop* server, Symbol sid, login_t login);
+  void FlushPresence(LoopContext* context);  // to PRESENCE_FEATURE clients of changed streams
+  void SendPresenceNotice(common::libev::IoLoop* server, Symbol sid, const ChatMessage& msg);  // same clients, local
   void BrodcastChatMessage(common::libev::IoLoop* server, const ChatMessage& msg);
-  size_t GetOnlineUserByStreamId(common::libev::IoLoop* server, stream_id sid) const;
+  void BrodcastChatMessage(common::libev::IoLoop* server, stream_id sid, const serializet_t& msg_ser);
+  void BrodcastLocalChatMessage(common::libev::IoLoop* server, stream_id sid, const serializet_t& msg_ser);
+  void FlushPendingChatMessages(LoopContext* context);
+  // one frame per message, or one server_send_chat_messages frame for clients with CHAT_BATCH_FEATURE
+  void DeliverChatMessages(common::libev::IoLoop* server, Symbol sid, const std::vector<serializet_t>& msgs);
+  void AddStreamViewer(common::libev::IoLoop* server, Symbol sid, const login_t& login, bool is_anonim);
+  void RemoveStreamViewer(common::libev::IoLoop* server, Symbol sid);
+  metrics::Gauge* FindStreamViewersGauge(LoopContext* context, Symbol sid);  // official channels labeled, others shared
+  // cluster wide if watchers counter enabled
+  size_t GetOnlineUserByStreamId(common::libev::IoLoop* server, Symbol sid) const;
 
   ServerHost* const parent_;
 
   redis::RedisPubSub* sub_commands_in_;
+  redis::RedisStreamConsumer* stream_commands_in_;  // only in streams mode
+  redis::RedisDevicesRegistry* devices_registry_;   // only in cluster mode
+  redis::RedisChatFanout* chat_fanout_;              // only in cluster mode
+  redis::RedisWatchersCounter* watchers_counter_;    // only in cluster mode
   InnerSubHandler* handler_;
+  WorkerPool* workers_;
+  metrics::LoopWatchdog* watchdog_;  // nullptr if stall detection disabled
+  capture::TrafficCapture* capture_;  // nullptr if capture disabled
+  std::atomic<uint64_t> jobs_generation_;
+  std::atomic<size_t> connections_count_;  // all loops
+  std::chrono::steady_clock::time_point accept_window_start_;
+  size_t accept_window_count_;
+  LoginRateLimiter login_rate_limiter_;
   std::shared_ptr<common::threads::Thread<void>> redis_subscribe_command_in_thread_;
-  common::libev::timer_id_t ping_client_id_timer_;
+  std::shared_ptr<common::threads::Thread<void>> redis_stream_command_in_thread_;
+  std::shared_ptr<common::threads::Thread<void>> redis_devices_registry_thread_;
+  std::shared_ptr<common::threads::Thread<void>> redis_chat_fanout_thread_;
+  std::shared_ptr<common::threads::Thread<void>> redis_watchers_counter_thread_;
   common::libev::timer_id_t reread_cache_id_timer_;
   const Config config_;
 
-  mutable std::vector<stream_id> chat_channels_;
+  BoundedMPSCQueue<ExternalCommand> external_commands_;
+  std::atomic<common::libev::IoLoop*> loop_;  // accepting loop
+  std::vector<LoopContext> loops_;             // fixed before loops started
+  std::atomic<bool> external_commands_drain_scheduled_;
+
+  mutable std::mutex chat_channels_mutex_;
+  std::unordered_set<Symbol> chat_channels_;
+
+  std::unordered_map<std::string, metrics::Histogram*> commands_duration_;  // fixed in ctor
+  metrics::Histogram* broadcast_duration_;
+  metrics::Histogram* handshake_find_user_duration_;
+  metrics::Histogram* handshake_register_duration_;
+  metrics::Gauge* connections_gauge_;
+  metrics::Gauge* anonim_users_gauge_;
+  metrics::Gauge* registered_users_gauge_;
+  metrics::Gauge* pending_requests_gauge_;
+  metrics::Counter* rejected_by_limit_counter_;
+  metrics::Counter* rejected_by_rate_counter_;
+  metrics::Counter* handshake_timeouts_counter_;
+  metrics::Counter* connection_rate_limited_counters_[RATE_LIMIT_CLASSES_COUNT];
+  metrics::Counter* login_rate_limited_counters_[RATE_LIMIT_CLASSES_COUNT];
 };
 
 }  // namespace inner
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/inner/inner_tcp_loop.h"
+
+#include "server/inner/inner_tcp_client.h"
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+InnerTcpLoop::InnerTcpLoop(common::libev::IoLoopObserver* observer)
+    : IoLoop(new common::libev::LibEvLoop, observer) {}
+
+const char* InnerTcpLoop::ClassName() const {
+  return "InnerTcpLoop";
+}
+
+common::libev::IoClient* InnerTcpLoop::CreateClient(const common::net::socket_info& info) {
+  return new InnerTcpClient(this, info);
+}
+
+#if LIBEV_CHILD_ENABLE
+common::libev::IoChild* InnerTcpLoop::CreateChild() {
+  NOTREACHED();
+  return nullptr;
+}
+#endif
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,496 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/loadgen/loadgen_handler.h"
+
+#include <string>  // for string
+
+#include <json-c/json_object.h>   // for json_object_put
+#include <json-c/json_tokener.h>  // for json_tokener_parse
+
+#include <common/libev/io_loop.h>  // for IoLoop
+#include <common/logger.h>         // for WARNING_LOG
+#include <common/net/net.h>        // for connect
+
+#include "client/commands.h"              // for GetChannelsRequest
+#include "commands_info/channels_info.h"  // for ChannelsInfo
+#include "commands_info/chat_message.h"   // for ChatMessage
+#include "commands_info/client_info.h"    // for ClientInfo
+#include "commands_info/ping_info.h"      // for ServerPingInfo
+#include "inner/inner_client.h"           // for InnerClient
+
+#define LOADGEN_OS "loadgen"
+#define LOADGEN_CPU "loadgen"
+#define LOADGEN_CHAT_MESSAGE "loadgen message"
+
+namespace fastotv {
+namespace server {
+namespace loadgen {
+
+namespace {
+
+const size_t npos = static_cast<size_t>(-1);
+
+uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ParseChannels(int argc, char* argv[], std::vector<stream_id>* out) {
+  if (argc < 3) {
+    return false;
+  }
+
+  json_object* obj = json_tokener_parse(argv[2]);
+  if (!obj) {
+    return false;
+  }
+
+  ChannelsInfo chan;
+  common::Error err = chan.DeSerialize(obj);
+  json_object_put(obj);
+  if (err) {
+    return false;
+  }
+
+  std::vector<stream_id> channels;
+  for (const ChannelInfo& info : chan.GetChannels()) {
+    channels.push_back(info.GetId());
+  }
+  *out = channels;
+  return true;
+}
+
+}  // namespace
+
+LoadgenConfig::LoadgenConfig()
+    : host(),
+      users(),
+      clients(1000),
+      connect_rate(1000),
+      zap_rate(0.1),
+      chat_rate(0.05),
+      ping_rate(0.05),
+      features(0) {}
+
+LoadgenHandler::SimulatedClient::SimulatedClient()
+    : connection(nullptr), auth(), connected_at(), authorized_pos(npos), channels(), channel() {}
+
+LoadgenHandler::PendingRequest::PendingRequest()
+    : command(LoadgenStats::COMMANDS_COUNT), client(npos), sent_at(), channel() {}
+
+LoadgenHandler::LoadgenHandler(const LoadgenConfig& config, size_t first_user, LoadgenStats* stats)
+    : fastotv::inner::InnerServerCommandSeqParser(),
+      common::libev::IoLoopObserver(),
+      config_(config),
+      stats_(stats),
+      tick_timer_(INVALID_TIMER_ID),
+      random_(first_user),
+      clients_(config.clients),
+      clients_by_connection_(),
+      authorized_(),
+      pending_(),
+      next_client_(0),
+      connect_budget_(0),
+      zap_budget_(0),
+      chat_budget_(0),
+      ping_budget_(0) {
+  const AuthInfo anonim(USER_LOGIN, USER_PASSWORD, USER_DEVICE_ID);
+  for (size_t i = 0; i < clients_.size(); ++i) {
+    clients_[i].auth = config.users.empty() ? anonim : config.users[(first_user + i) % config.users.size()];
+    clients_[i].auth.SetFeatures(config.features);
+  }
+}
+
+LoadgenHandler::~LoadgenHandler() {}
+
+void LoadgenHandler::PreLooped(common::libev::IoLoop* server) {
+  tick_timer_ = server->CreateTimer(static_cast<double>(tick_msec) / 1000, true);
+}
+
+void LoadgenHandler::Accepted(common::libev::IoClient* client) {
+  UNUSED(client);
+}
+
+void LoadgenHandler::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
+  UNUSED(server);
+  UNUSED(client);
+}
+
+void LoadgenHandler::Closed(common::libev::IoClient* client) {
+  fastotv::inner::InnerClient* connection = static_cast<fastotv::inner::InnerClient*>(client);
+  size_t index;
+  SimulatedClient* sclient = FindClient(connection, &index);
+  if (!sclient) {
+    return;
+  }
+
+  SetAuthorized(index, false);
+  sclient->connection = nullptr;
+  clients_by_connection_.erase(connection);
+  stats_->RecordDisconnect();
+}
+
+void LoadgenHandler::DataReceived(common::libev::IoClient* client) {
+  std::string buff;
+  fastotv::inner::InnerClient* iclient = static_cast<fastotv::inner::InnerClient*>(client);
+  common::ErrnoError err = iclient->ReadCommand(&buff);
+  if (err) {
+    DisconnectClient(iclient);
+    return;
+  }
+
+  HandleInnerDataReceived(iclient, buff);
+}
+
+void LoadgenHandler::DataReadyToWrite(common::libev::IoClient* client) {
+  UNUSED(client);
+}
+
+void LoadgenHandler::PostLooped(common::libev::IoLoop* server) {
+  if (tick_timer_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(tick_timer_);
+    tick_timer_ = INVALID_TIMER_ID;
+  }
+
+  for (SimulatedClient& sclient : clients_) {
+    if (!sclient.connection) {
+      continue;
+    }
+
+    fastotv::inner::InnerClient* connection = sclient.connection;
+    clients_by_connection_.erase(connection);  // not counted as disconnect
+    sclient.connection = nullptr;
+    DisconnectClient(connection);
+  }
+  authorized_.clear();
+}
+
+void LoadgenHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
+  if (id != tick_timer_) {
+    return;
+  }
+
+  const double tick_sec = static_cast<double>(tick_msec) / 1000;
+  if (next_client_ < clients_.size()) {
+    connect_budget_ += config_.connect_rate * tick_sec;
+    const size_t count = static_cast<size_t>(connect_budget_);
+    connect_budget_ -= count;
+    ConnectClients(server, count);
+  }
+
+  RunActions(&zap_budget_, config_.zap_rate * tick_sec, &LoadgenHandler::Zap);
+  RunActions(&chat_budget_, config_.chat_rate * tick_sec, &LoadgenHandler::Chat);
+  RunActions(&ping_budget_, config_.ping_rate * tick_sec, &LoadgenHandler::Ping);
+}
+
+#if LIBEV_CHILD_ENABLE
+void LoadgenHandler::Accepted(common::libev::IoChild* child) {
+  UNUSED(child);
+}
+
+void LoadgenHandler::Moved(common::libev::IoLoop* server, common::libev::IoChild* child) {
+  UNUSED(server);
+  UNUSED(child);
+}
+
+void LoadgenHandler::ChildStatusChanged(common::libev::IoChild* child, int status) {
+  UNUSED(child);
+  UNUSED(status);
+}
+#endif
+
+void LoadgenHandler::ConnectClients(common::libev::IoLoop* server, size_t count) {
+  for (size_t i = 0; i < count && next_client_ < clients_.size(); ++i) {
+    common::net::socket_info client_info;
+    common::ErrnoError err = common::net::connect(config_.host, common::net::ST_SOCK_STREAM, nullptr, &client_info);
+    if (err) {
+      stats_->RecordConnectError();
+      return;  // retried on next tick
+    }
+
+    fastotv::inner::InnerClient* connection = new fastotv::inner::InnerClient(server, client_info);
+    SimulatedClient& sclient = clients_[next_client_];
+    sclient.connection = connection;
+    sclient.connected_at = std::chrono::steady_clock::now();
+    clients_by_connection_[connection] = next_client_;
+    server->RegisterClient(connection);
+    stats_->RecordSent(LoadgenStats::HANDSHAKE);
+    next_client_++;
+  }
+}
+
+void LoadgenHandler::RunActions(double* budget, double rate, void (LoadgenHandler::*action)(size_t client)) {
+  if (authorized_.empty()) {
+    return;
+  }
+
+  *budget += rate * authorized_.size();
+  while (*budget >= 1 && !authorized_.empty()) {
+    *budget -= 1;
+    std::uniform_int_distribution<size_t> dist(0, authorized_.size() - 1);
+    (this->*action)(authorized_[dist(random_)]);
+  }
+}
+
+void LoadgenHandler::DisconnectClient(fastotv::inner::InnerClient* connection) {
+  common::ErrnoError err = connection->Close();
+  DCHECK(!err) << "Close client error: " << err->GetDescription();
+  delete connection;
+}
+
+void LoadgenHandler::SetAuthorized(size_t client, bool authorized) {
+  SimulatedClient& sclient = clients_[client];
+  if (authorized) {
+    if (sclient.authorized_pos == npos) {
+      sclient.authorized_pos = authorized_.size();
+      authorized_.push_back(client);
+    }
+    return;
+  }
+
+  const size_t pos = sclient.authorized_pos;
+  if (pos == npos) {
+    return;
+  }
+
+  const size_t last = authorized_.back();  // swap with last
+  authorized_[pos] = last;
+  clients_[last].authorized_pos = pos;
+  authorized_.pop_back();
+  sclient.authorized_pos = npos;
+}
+
+LoadgenHandler::SimulatedClient* LoadgenHandler::FindClient(fastotv::inner::InnerClient* connection, size_t* index) {
+  auto it = clients_by_connection_.find(connection);
+  if (it == clients_by_connection_.end()) {
+    return nullptr;
+  }
+
+  *index = it->second;
+  return &clients_[it->second];
+}
+
+void LoadgenHandler::SendRequest(size_t client,
+                                 LoadgenStats::command_t command,
+                                 const common::protocols::three_way_handshake::cmd_request_t& request,
+                                 const stream_id& channel) {
+  fastotv::inner::InnerClient* connection = clients_[client].connection;
+  if (!connection) {
+    return;
+  }
+
+  PendingRequest pending;
+  pending.command = command;
+  pending.client = client;
+  pending.sent_at = std::chrono::steady_clock::now();
+  pending.channel = channel;
+  pending_[request.GetId()] = pending;
+  stats_->RecordSent(command);
+  common::ErrnoError err = connection->Write(request);
+  if (err) {
+    pending_.erase(request.GetId());
+    stats_->RecordFail(command);
+    DisconnectClient(connection);
+  }
+}
+
+void LoadgenHandler::SendResponce(fastotv::inner::InnerClient* connection,
+                                  const common::protocols::three_way_handshake::cmd_response_t& responce) {
+  common::ErrnoError err = connection->Write(responce);
+  if (err) {
+    DisconnectClient(connection);
+  }
+}
+
+void LoadgenHandler::SendApprove(fastotv::inner::InnerClient* connection,
+                                 const common::protocols::three_way_handshake::cmd_approve_t& approve) {
+  common::ErrnoError err = connection->Write(approve);
+  if (err) {
+    DisconnectClient(connection);
+  }
+}
+
+void LoadgenHandler::Zap(size_t client) {
+  SimulatedClient& sclient = clients_[client];
+  if (sclient.channels.empty()) {
+    return;
+  }
+
+  std::uniform_int_distribution<size_t> dist(0, sclient.channels.size() - 1);
+  const stream_id sid = sclient.channels[dist(random_)];
+  SendRequest(client, LoadgenStats::GET_RUNTIME_CHANNEL_INFO,
+              client::GetRuntimeChannelInfoRequest(NextRequestID(), sid), sid);
+}
+
+void LoadgenHandler::Chat(size_t client) {
+  SimulatedClient& sclient = clients_[client];
+  if (sclient.channel.empty()) {  // not watching
+    return;
+  }
+
+  const ChatMessage msg(sclient.channel, sclient.auth.GetLogin(), LOADGEN_CHAT_MESSAGE, ChatMessage::MESSAGE);
+  serializet_t msg_ser;
+  common::Error err = msg.SerializeToString(&msg_ser);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    return;
+  }
+
+  SendRequest(client, LoadgenStats::SEND_CHAT_MESSAGE, client::SendChatMessageRequest(NextRequestID(), msg_ser));
+}
+
+void LoadgenHandler::Ping(size_t client) {
+  SendRequest(client, LoadgenStats::PING, client::PingRequest(NextRequestID()));
+}
+
+void LoadgenHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
+                                               common::protocols::three_way_handshake::cmd_seq_t id,
+                                               int argc,
+                                               char* argv[]) {
+  size_t index;
+  SimulatedClient* sclient = FindClient(connection, &index);
+  if (!sclient) {
+    return;
+  }
+
+  stats_->RecordServerRequest();
+  char* command = argv[0];
+  if (IS_EQUAL_COMMAND(command, SERVER_PING)) {
+    ServerPingInfo ping;
+    serializet_t ping_str;
+    common::Error err = ping.SerializeToString(&ping_str);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    SendResponce(connection, client::PingResponceSuccsess(id, ping_str));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_WHO_ARE_YOU)) {
+    serializet_t auth_str;
+    common::Error err = sclient->auth.SerializeToString(&auth_str);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    SendResponce(connection, client::WhoAreYouResponceSuccsess(id, auth_str));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_GET_CLIENT_INFO)) {
+    const ClientInfo info(sclient->auth.GetLogin(), LOADGEN_OS, LOADGEN_CPU, 0, 0, 0);
+    serializet_t info_str;
+    common::Error err = info.SerializeToString(&info_str);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    SendResponce(connection, client::SystemInfoResponceSuccsess(id, info_str));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGE)) {
+    stats_->RecordChatReceived();
+    SendResponce(connection, client::SendChatMessageResponceSuccsess(id, argc > 1 ? argv[1] : "{}"));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGES)) {
+    json_object* jmsgs = argc > 1 ? json_tokener_parse(argv[1]) : nullptr;
+    if (jmsgs && json_object_is_type(jmsgs, json_type_array)) {
+      stats_->RecordChatReceived(json_object_array_length(jmsgs));
+    }
+    json_object_put(jmsgs);
+    SendResponce(connection, client::SendChatMessagesResponceSuccsess(id));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_PRESENCE)) {
+    SendResponce(connection, client::PresenceResponceSuccsess(id));
+    return;
+  }
+
+  WARNING_LOG() << "UNKNOWN REQUEST COMMAND: " << command;
+}
+
+void LoadgenHandler::HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
+                                                common::protocols::three_way_handshake::cmd_seq_t id,
+                                                int argc,
+                                                char* argv[]) {
+  auto it = pending_.find(id);
+  if (it == pending_.end()) {
+    return;
+  }
+
+  const PendingRequest pending = it->second;
+  pending_.erase(it);
+  if (!IS_EQUAL_COMMAND(argv[0], SUCCESS_COMMAND) || argc < 2) {
+    stats_->RecordFail(pending.command);
+    return;
+  }
+
+  stats_->RecordSuccess(pending.command, MicrosecondsSince(pending.sent_at));
+  SimulatedClient& sclient = clients_[pending.client];
+  switch (pending.command) {
+    case LoadgenStats::GET_SERVER_INFO:
+      SendApprove(connection, client::GetServerInfoApproveResponceSuccsess(id));
+      break;
+    case LoadgenStats::GET_CHANNELS:
+      if (!ParseChannels(argc, argv, &sclient.channels)) {
+        WARNING_LOG() << "Invalid channels responce for: " << sclient.auth.GetLogin();
+      }
+      SendApprove(connection, client::GetChannelsApproveResponceSuccsess(id));
+      break;
+    case LoadgenStats::GET_RUNTIME_CHANNEL_INFO:
+      sclient.channel = pending.channel;
+      SendApprove(connection, client::GetRuntimeChannelInfoApproveResponceSuccsess(id));
+      break;
+    case LoadgenStats::SEND_CHAT_MESSAGE:
+      SendApprove(connection, client::SendChatMessageApproveResponceSuccsess(id));
+      break;
+    case LoadgenStats::PING:
+      SendApprove(connection, client::PingApproveResponceSuccsess(id));
+      break;
+    default:
+      break;
+  }
+}
+
+void LoadgenHandler::HandleInnerApproveCommand(fastotv::inner::InnerClient* connection,
+                                               common::protocols::three_way_handshake::cmd_seq_t id,
+                                               int argc,
+                                               char* argv[]) {
+  UNUSED(id);
+  if (argc < 2 || !IS_EQUAL_COMMAND(argv[1], SERVER_WHO_ARE_YOU)) {
+    return;
+  }
+
+  size_t index;
+  SimulatedClient* sclient = FindClient(connection, &index);
+  if (!sclient) {
+    return;
+  }
+
+  if (!IS_EQUAL_COMMAND(argv[0], SUCCESS_COMMAND)) {
+    stats_->RecordFail(LoadgenStats::HANDSHAKE);
+    return;  // server closes connection
+  }
+
+  stats_->RecordSuccess(LoadgenStats::HANDSHAKE, MicrosecondsSince(sclient->connected_at));
+  SetAuthorized(index, true);
+  SendRequest(index, LoadgenStats::GET_SERVER_INFO, client::GetServerInfoRequest(NextRequestID()));
+  SendRequest(index, LoadgenStats::GET_CHANNELS, client::GetChannelsRequest(NextRequestID()));
+}
+
+}  // namespace loadgen
+}  // namespace server
+}  // namespace fastotv
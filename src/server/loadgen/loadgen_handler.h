@@ -0,0 +1,155 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include <chrono>
+#include <random>
+#include <string>  // for string
+#include <unordered_map>
+#include <vector>
+
+#include <common/libev/io_loop_observer.h>  // for IoLoopObserver
+#include <common/libev/types.h>             // for timer_id_t
+#include <common/net/types.h>               // for HostAndPort
+
+#include "commands_info/auth_info.h"                // for AuthInfo
+#include "inner/inner_server_command_seq_parser.h"  // for InnerServerCommandSeqParser
+
+#include "server/loadgen/loadgen_stats.h"  // for LoadgenStats
+
+namespace fastotv {
+namespace server {
+namespace loadgen {
+
+struct LoadgenConfig {
+  LoadgenConfig();
+
+  common::net::HostAndPort host;
+  std::vector<AuthInfo> users;  // used round robin, anonim user if empty
+  size_t clients;               // per loop
+  double connect_rate;          // new connections per second, per loop
+  // per authorized client, per second
+  double zap_rate;
+  double chat_rate;
+  double ping_rate;
+  client_features_t features;  // advertised by all clients
+};
+
+// simulated players of one loop, replies on server requests like real player
+class LoadgenHandler : public fastotv::inner::InnerServerCommandSeqParser, public common::libev::IoLoopObserver {
+ public:
+  enum { tick_msec = 10 };
+
+  LoadgenHandler(const LoadgenConfig& config, size_t first_user, LoadgenStats* stats);
+
+  void PreLooped(common::libev::IoLoop* server) override;
+
+  void Accepted(common::libev::IoClient* client) override;
+  void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override;
+  void Closed(common::libev::IoClient* client) override;
+
+  void DataReceived(common::libev::IoClient* client) override;
+  void DataReadyToWrite(common::libev::IoClient* client) override;
+  void PostLooped(common::libev::IoLoop* server) override;
+  void TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) override;
+#if LIBEV_CHILD_ENABLE
+  void Accepted(common::libev::IoChild* child) override;
+  void Moved(common::libev::IoLoop* server, common::libev::IoChild* child) override;
+  void ChildStatusChanged(common::libev::IoChild* client, int status) override;
+#endif
+
+  virtual ~LoadgenHandler();
+
+ private:
+  typedef std::chrono::steady_clock::time_point time_point_t;
+
+  struct SimulatedClient {
+    SimulatedClient();
+
+    fastotv::inner::InnerClient* connection;  // nullptr if not connected
+    AuthInfo auth;
+    time_point_t connected_at;
+    size_t authorized_pos;  // position in authorized_, npos if not authorized
+    std::vector<stream_id> channels;
+    stream_id channel;  // current
+  };
+
+  struct PendingRequest {
+    PendingRequest();
+
+    LoadgenStats::command_t command;
+    size_t client;
+    time_point_t sent_at;
+    stream_id channel;  // requested runtime info
+  };
+
+  void ConnectClients(common::libev::IoLoop* server, size_t count);
+  void RunActions(double* budget, double rate, void (LoadgenHandler::*action)(size_t client));
+  void DisconnectClient(fastotv::inner::InnerClient* connection);
+
+  void SetAuthorized(size_t client, bool authorized);
+  SimulatedClient* FindClient(fastotv::inner::InnerClient* connection, size_t* index);
+  void SendRequest(size_t client,
+                   LoadgenStats::command_t command,
+                   const common::protocols::three_way_handshake::cmd_request_t& request,
+                   const stream_id& channel = stream_id());
+  void SendResponce(fastotv::inner::InnerClient* connection,
+                    const common::protocols::three_way_handshake::cmd_response_t& responce);
+  void SendApprove(fastotv::inner::InnerClient* connection,
+                   const common::protocols::three_way_handshake::cmd_approve_t& approve);
+
+  void Zap(size_t client);
+  void Chat(size_t client);
+  void Ping(size_t client);
+
+  void HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
+                                 common::protocols::three_way_handshake::cmd_seq_t id,
+                                 int argc,
+                                 char* argv[]) override;
+  void HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
+                                  common::protocols::three_way_handshake::cmd_seq_t id,
+                                  int argc,
+                                  char* argv[]) override;
+  void HandleInnerApproveCommand(fastotv::inner::InnerClient* connection,
+                                 common::protocols::three_way_handshake::cmd_seq_t id,
+                                 int argc,
+                                 char* argv[]) override;
+
+  const LoadgenConfig config_;
+  LoadgenStats* const stats_;
+  common::libev::timer_id_t tick_timer_;
+  std::mt19937 random_;
+
+  std::vector<SimulatedClient> clients_;
+  std::unordered_map<fastotv::inner::InnerClient*, size_t> clients_by_connection_;
+  std::vector<size_t> authorized_;
+  std::unordered_map<common::protocols::three_way_handshake::cmd_seq_t, PendingRequest> pending_;  // by request id
+  size_t next_client_;  // not connected yet
+
+  double connect_budget_;
+  double zap_budget_;
+  double chat_budget_;
+  double ping_budget_;
+};
+
+}  // namespace loadgen
+}  // namespace server
+}  // namespace fastotv
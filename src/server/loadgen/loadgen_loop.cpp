@@ -0,0 +1,46 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/loadgen/loadgen_loop.h"
+
+#include "inner/inner_client.h"  // for InnerClient
+
+namespace fastotv {
+namespace server {
+namespace loadgen {
+
+LoadgenLoop::LoadgenLoop(common::libev::IoLoopObserver* observer) : IoLoop(new common::libev::LibEvLoop, observer) {}
+
+const char* LoadgenLoop::ClassName() const {
+  return "LoadgenLoop";
+}
+
+common::libev::IoClient* LoadgenLoop::CreateClient(const common::net::socket_info& info) {
+  return new fastotv::inner::InnerClient(this, info);
+}
+
+#if LIBEV_CHILD_ENABLE
+common::libev::IoChild* LoadgenLoop::CreateChild() {
+  NOTREACHED();
+  return nullptr;
+}
+#endif
+
+}  // namespace loadgen
+}  // namespace server
+}  // namespace fastotv
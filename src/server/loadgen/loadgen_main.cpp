@@ -0,0 +1,193 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>  // for signal, SIGINT
+#include <stdio.h>   // for fprintf, stderr
+#include <stdlib.h>  // for exit, EXIT_FAILURE
+#include <unistd.h>  // for getopt, optarg
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>  // for string
+#include <thread>
+#include <vector>
+
+#include <common/convert2string.h>          // for ConvertFromString
+#include <common/logger.h>                  // for WARNING_LOG, INIT_LOGGER
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include "server/loadgen/loadgen_handler.h"  // for LoadgenHandler
+#include "server/loadgen/loadgen_loop.h"     // for LoadgenLoop
+#include "server/loadgen/loadgen_stats.h"    // for LoadgenStats
+
+namespace {
+
+volatile sig_atomic_t stop_requested = 0;
+
+void HandleStopSignal(int sig) {
+  UNUSED(sig);
+  stop_requested = 1;
+}
+
+void PrintUsage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [-s host:port] [-c clients] [-t threads] [-r connects per sec] [-d duration sec]\n"
+          "          [-z zaps per client per sec] [-m chat messages per client per sec] [-p pings per client per sec]\n"
+          "          [-u users file, 'login password device_id' per line] [-o report file]\n"
+          "          [-b receive chat messages batched] [-e receive periodic presence]\n",
+          name);
+}
+
+bool LoadUsers(const std::string& path, std::vector<fastotv::AuthInfo>* users) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    fastotv::login_t login;
+    std::string password;
+    fastotv::device_id_t dev;
+    if (!(fields >> login >> password >> dev)) {
+      continue;
+    }
+    users->push_back(fastotv::AuthInfo(login, password, dev));
+  }
+  return !users->empty();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  fastotv::server::loadgen::LoadgenConfig config;
+  config.host = common::net::HostAndPort("localhost", SERVICE_HOST_PORT);
+  size_t clients = config.clients;
+  size_t threads = 1;
+  double connect_rate = config.connect_rate;
+  uint32_t duration_sec = 60;
+  std::string report_path;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:t:r:d:z:m:p:u:o:be")) != -1) {
+    bool res = true;
+    switch (opt) {
+      case 's':
+        res = common::ConvertFromString(optarg, &config.host);
+        break;
+      case 'c':
+        res = common::ConvertFromString(optarg, &clients);
+        break;
+      case 't':
+        res = common::ConvertFromString(optarg, &threads) && threads != 0;
+        break;
+      case 'r':
+        res = common::ConvertFromString(optarg, &connect_rate);
+        break;
+      case 'd':
+        res = common::ConvertFromString(optarg, &duration_sec);
+        break;
+      case 'z':
+        res = common::ConvertFromString(optarg, &config.zap_rate);
+        break;
+      case 'm':
+        res = common::ConvertFromString(optarg, &config.chat_rate);
+        break;
+      case 'p':
+        res = common::ConvertFromString(optarg, &config.ping_rate);
+        break;
+      case 'u':
+        res = LoadUsers(optarg, &config.users);
+        break;
+      case 'o':
+        report_path = optarg;
+        break;
+      case 'b':
+        config.features |= fastotv::CHAT_BATCH_FEATURE;
+        break;
+      case 'e':
+        config.features |= fastotv::PRESENCE_FEATURE;
+        break;
+      default: /* '?' */
+        res = false;
+        break;
+    }
+    if (!res) {
+      PrintUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  INIT_LOGGER(PROJECT_NAME_TITLE, common::logging::LOG_LEVEL_WARNING);
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+
+  fastotv::server::loadgen::LoadgenStats stats;
+  std::vector<std::unique_ptr<fastotv::server::loadgen::LoadgenHandler>> handlers;
+  std::vector<std::unique_ptr<fastotv::server::loadgen::LoadgenLoop>> loops;
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> loops_threads;
+  size_t first_user = 0;
+  for (size_t i = 0; i < threads; ++i) {
+    fastotv::server::loadgen::LoadgenConfig loop_config = config;
+    loop_config.clients = clients / threads + (i < clients % threads ? 1 : 0);
+    loop_config.connect_rate = connect_rate / threads;
+    handlers.emplace_back(new fastotv::server::loadgen::LoadgenHandler(loop_config, first_user, &stats));
+    loops.emplace_back(new fastotv::server::loadgen::LoadgenLoop(handlers.back().get()));
+    loops.back()->SetName("loadgen_loop_" + common::ConvertToString(i));
+    first_user += loop_config.clients;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& loop : loops) {
+    auto loop_thread = THREAD_MANAGER()->CreateThread(&fastotv::server::loadgen::LoadgenLoop::Exec, loop.get());
+    if (!loop_thread->Start()) {
+      WARNING_LOG() << "Don't started thread for loop: " << loop->GetName();
+    }
+    loops_threads.push_back(loop_thread);
+  }
+
+  const auto deadline = start + std::chrono::seconds(duration_sec);
+  while (!stop_requested && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  for (const auto& loop : loops) {
+    loop->Stop();
+  }
+  for (auto loop_thread : loops_threads) {
+    loop_thread->Join();
+  }
+
+  const double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const std::string report = stats.ToJson(elapsed_sec);
+  if (report_path.empty()) {
+    printf("%s\n", report.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  std::ofstream file(report_path);
+  file << report << std::endl;
+  if (!file) {
+    fprintf(stderr, "Can't write report to: %s\n", report_path.c_str());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
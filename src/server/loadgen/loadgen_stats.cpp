@@ -0,0 +1,109 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/loadgen/loadgen_stats.h"
+
+#include <json-c/json_object.h>  // for json_object_new_object
+
+#include "commands/commands.h"  // for CLIENT_PING
+
+namespace fastotv {
+namespace server {
+namespace loadgen {
+
+namespace {
+
+json_object* MakeMilliseconds(uint64_t usec) {
+  return json_object_new_double(static_cast<double>(usec) / 1000.0);
+}
+
+}  // namespace
+
+LoadgenStats::LoadgenStats()
+    : sent_(),
+      succeeded_(),
+      failed_(),
+      latency_(),
+      connect_errors_(),
+      disconnects_(),
+      server_requests_(),
+      chat_received_() {}
+
+void LoadgenStats::RecordSuccess(command_t command, uint64_t latency_usec) {
+  succeeded_[command].Inc();
+  latency_[command].Record(latency_usec);
+}
+
+const char* LoadgenStats::CommandToString(command_t command) {
+  static const char* names[COMMANDS_COUNT] = {"handshake",
+                                              CLIENT_GET_SERVER_INFO,
+                                              CLIENT_GET_CHANNELS,
+                                              CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                                              CLIENT_SEND_CHAT_MESSAGE,
+                                              CLIENT_PING};
+  return names[command];
+}
+
+std::string LoadgenStats::ToJson(double elapsed_sec) const {
+  json_object* jcommands = json_object_new_object();
+  uint64_t total_succeeded = 0;
+  uint64_t total_failed = 0;
+  for (size_t i = 0; i < COMMANDS_COUNT; ++i) {
+    const metrics::Histogram& latency = latency_[i];
+    const uint64_t succeeded = succeeded_[i].Get();
+    const uint64_t failed = failed_[i].Get();
+    total_succeeded += succeeded;
+    total_failed += failed;
+
+    json_object* jlatency = json_object_new_object();
+    json_object_object_add(jlatency, "mean", MakeMilliseconds(succeeded ? latency.GetSum() / succeeded : 0));
+    json_object_object_add(jlatency, "p50", MakeMilliseconds(latency.GetValueAtPercentile(50)));
+    json_object_object_add(jlatency, "p90", MakeMilliseconds(latency.GetValueAtPercentile(90)));
+    json_object_object_add(jlatency, "p99", MakeMilliseconds(latency.GetValueAtPercentile(99)));
+    json_object_object_add(jlatency, "p999", MakeMilliseconds(latency.GetValueAtPercentile(99.9)));
+
+    json_object* jcommand = json_object_new_object();
+    json_object_object_add(jcommand, "sent", json_object_new_int64(sent_[i].Get()));
+    json_object_object_add(jcommand, "succeeded", json_object_new_int64(succeeded));
+    json_object_object_add(jcommand, "failed", json_object_new_int64(failed));
+    json_object_object_add(jcommand, "per_sec", json_object_new_double(elapsed_sec > 0 ? succeeded / elapsed_sec : 0));
+    json_object_object_add(jcommand, "latency_msec", jlatency);
+    json_object_object_add(jcommands, CommandToString(static_cast<command_t>(i)), jcommand);
+  }
+
+  json_object* jerrors = json_object_new_object();
+  json_object_object_add(jerrors, "connect", json_object_new_int64(connect_errors_.Get()));
+  json_object_object_add(jerrors, "disconnects", json_object_new_int64(disconnects_.Get()));
+  json_object_object_add(jerrors, "failed_responces", json_object_new_int64(total_failed));
+
+  json_object* jreport = json_object_new_object();
+  json_object_object_add(jreport, "elapsed_sec", json_object_new_double(elapsed_sec));
+  json_object_object_add(jreport, "responces_per_sec",
+                         json_object_new_double(elapsed_sec > 0 ? total_succeeded / elapsed_sec : 0));
+  json_object_object_add(jreport, "server_requests", json_object_new_int64(server_requests_.Get()));
+  json_object_object_add(jreport, "chat_received", json_object_new_int64(chat_received_.Get()));
+  json_object_object_add(jreport, "commands", jcommands);
+  json_object_object_add(jreport, "errors", jerrors);
+  const std::string result = json_object_to_json_string_ext(jreport, JSON_C_TO_STRING_PRETTY);
+  json_object_put(jreport);
+  return result;
+}
+
+}  // namespace loadgen
+}  // namespace server
+}  // namespace fastotv
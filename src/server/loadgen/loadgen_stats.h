@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>  // for string
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "server/metrics/metrics.h"  // for Counter, Histogram
+
+namespace fastotv {
+namespace server {
+namespace loadgen {
+
+// shared by all load generator loops, thread safe
+class LoadgenStats {
+ public:
+  enum command_t {
+    HANDSHAKE = 0,  // connect till who_are_you approve
+    GET_SERVER_INFO,
+    GET_CHANNELS,
+    GET_RUNTIME_CHANNEL_INFO,
+    SEND_CHAT_MESSAGE,
+    PING,
+    COMMANDS_COUNT
+  };
+
+  LoadgenStats();
+
+  void RecordSent(command_t command) { sent_[command].Inc(); }
+  void RecordSuccess(command_t command, uint64_t latency_usec);
+  void RecordFail(command_t command) { failed_[command].Inc(); }
+
+  void RecordConnectError() { connect_errors_.Inc(); }
+  void RecordDisconnect() { disconnects_.Inc(); }
+  void RecordServerRequest() { server_requests_.Inc(); }  // pings, chat messages, client info
+  void RecordChatReceived(size_t count = 1) { chat_received_.Inc(count); }
+
+  std::string ToJson(double elapsed_sec) const;  // throughput, latency percentiles in msec and errors
+
+  static const char* CommandToString(command_t command);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoadgenStats);
+
+  metrics::Counter sent_[COMMANDS_COUNT];
+  metrics::Counter succeeded_[COMMANDS_COUNT];
+  metrics::Counter failed_[COMMANDS_COUNT];
+  metrics::Histogram latency_[COMMANDS_COUNT];  // microseconds, only succeeded
+
+  metrics::Counter connect_errors_;
+  metrics::Counter disconnects_;
+  metrics::Counter server_requests_;
+  metrics::Counter chat_received_;
+};
+
+}  // namespace loadgen
+}  // namespace server
+}  // namespace fastotv
@@ -21,9 +21,11 @@
 #include <unistd.h>  // for getopt, optind
 
 #include <common/log_levels.h>  // for LOG_LEVEL, LOG_LEVEL::L_DEBUG
+#include <common/logger.h>      // for WARNING_LOG, INIT_LOGGER
 
-#include "server/config.h"  // for Config
-#include "server_host.h"    // for ServerHost
+#include "server/async_logger.h"  // for AsyncLogger
+#include "server/config.h"        // for Config
+#include "server_host.h"          // for ServerHost
 
 const char* config_path = SERVER_CONFIG_FILE_PATH;
 
@@ -57,6 +59,16 @@ int main(int argc, char* argv[]) {
   if (err) {
     return EXIT_FAILURE;
   }
-  fastotv::server::ServerHost server(config);
-  return server.Exec();
+  fastotv::server::AsyncLogger* logger = fastotv::server::AsyncLogger::GetInstance();
+  if (!logger->Start()) {
+    WARNING_LOG() << "Don't started async logger thread.";
+  }
+
+  int res = EXIT_SUCCESS;
+  {
+    fastotv::server::ServerHost server(config);
+    res = server.Exec();
+  }
+  logger->Stop();
+  return res;
 }
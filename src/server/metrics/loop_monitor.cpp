@@ -0,0 +1,292 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/metrics/loop_monitor.h"
+
+#include <signal.h>  // for sigaction, pthread_kill
+#include <stdlib.h>  // for free
+#include <string.h>  // for memset
+
+#if defined(__GLIBC__)
+#include <execinfo.h>  // for backtrace
+#endif
+
+#include <thread>
+
+#include <common/logger.h>                  // for WARNING_LOG
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include "server/metrics/metrics.h"  // for Registry
+
+#define BACKTRACE_SIGNAL SIGUSR2
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+namespace {
+
+const char* callbacks_names[LoopMonitor::CALLBACKS_COUNT] = {"data_received", "timer_emited", "accepted", "closed"};
+
+// filled by signal handler in stalled thread, watchdog dumps one thread at a time
+void* stack_frames[LoopWatchdog::max_frames];
+std::atomic<int> stack_frames_count(-1);
+
+void backtrace_signal_handler(int sig) {
+  UNUSED(sig);
+#if defined(__GLIBC__)
+  stack_frames_count.store(backtrace(stack_frames, LoopWatchdog::max_frames), std::memory_order_release);
+#else
+  stack_frames_count.store(0, std::memory_order_release);
+#endif
+}
+
+}  // namespace
+
+LoopMonitor::CallbackScope::CallbackScope(LoopMonitor* monitor, callback_t callback)
+    : monitor_(monitor),
+      callback_(callback),
+      start_(monitor ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {
+  if (monitor_) {
+    monitor_->EnterCallback(start_);
+  }
+}
+
+LoopMonitor::CallbackScope::~CallbackScope() {
+  if (monitor_) {
+    monitor_->LeaveCallback(callback_, std::chrono::steady_clock::now() - start_);
+  }
+}
+
+LoopMonitor::LoopMonitor(const std::string& loop_name)
+    : loop_name_(loop_name),
+      lag_(nullptr),
+      callbacks_duration_(),
+      stalls_(nullptr),
+      probe_interval_(),
+      probe_expected_(),
+      depth_(0),
+      busy_since_(0),
+      iteration_(0),
+      attached_(false),
+      thread_() {
+  Registry* registry = Registry::GetInstance();
+  lag_ = registry->GetHistogram("fastotv_loop_lag_seconds", "Delay of loop timers.", {{"loop", loop_name}});
+  for (size_t i = 0; i < CALLBACKS_COUNT; ++i) {
+    callbacks_duration_[i] = registry->GetHistogram("fastotv_loop_callback_duration_seconds",
+                                                    "Loop callbacks time.",
+                                                    {{"loop", loop_name}, {"callback", callbacks_names[i]}});
+  }
+  stalls_ = registry->GetCounter("fastotv_loop_stalls_total", "Callbacks longer than stall threshold.",
+                                 {{"loop", loop_name}});
+}
+
+const std::string& LoopMonitor::GetLoopName() const {
+  return loop_name_;
+}
+
+void LoopMonitor::Attach(double probe_interval_sec) {
+  probe_interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(probe_interval_sec));
+  probe_expected_ = std::chrono::steady_clock::now() + probe_interval_;
+  thread_ = pthread_self();
+  attached_.store(true, std::memory_order_release);
+}
+
+void LoopMonitor::Detach() {
+  attached_.store(false, std::memory_order_release);
+}
+
+void LoopMonitor::ProbeFired() {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now > probe_expected_) {
+    lag_->Record(std::chrono::duration_cast<std::chrono::microseconds>(now - probe_expected_).count());
+  } else {
+    lag_->Record(0);
+  }
+  probe_expected_ = now + probe_interval_;
+}
+
+bool LoopMonitor::GetBusy(std::chrono::steady_clock::time_point* since, uint64_t* iteration) const {
+  const int64_t busy_since = busy_since_.load(std::memory_order_acquire);
+  if (busy_since == 0) {
+    return false;
+  }
+
+  *since = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(busy_since));
+  *iteration = iteration_.load(std::memory_order_relaxed);
+  return true;
+}
+
+bool LoopMonitor::GetThread(pthread_t* thread) const {
+  if (!attached_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  *thread = thread_;
+  return true;
+}
+
+void LoopMonitor::IncStalls() {
+  stalls_->Inc();
+}
+
+void LoopMonitor::EnterCallback(std::chrono::steady_clock::time_point now) {
+  if (depth_++ != 0) {
+    return;
+  }
+
+  iteration_.fetch_add(1, std::memory_order_relaxed);
+  busy_since_.store(now.time_since_epoch().count(), std::memory_order_release);
+}
+
+void LoopMonitor::LeaveCallback(callback_t callback, std::chrono::steady_clock::duration elapsed) {
+  callbacks_duration_[callback]->Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+  if (--depth_ != 0) {
+    return;
+  }
+
+  busy_since_.store(0, std::memory_order_release);
+}
+
+LoopWatchdog::LoopWatchdog(uint32_t stall_threshold_msec)
+    : stall_threshold_(stall_threshold_msec),
+      thread_(),
+      stop_(false),
+      monitors_mutex_(),
+      monitors_(),
+      reported_iterations_() {}
+
+LoopWatchdog::~LoopWatchdog() {
+  Stop();
+}
+
+void LoopWatchdog::AddMonitor(LoopMonitor* monitor) {
+  std::unique_lock<std::mutex> lock(monitors_mutex_);
+  monitors_.push_back(monitor);
+  reported_iterations_.push_back(0);
+}
+
+bool LoopWatchdog::Start() {
+  if (thread_) {
+    return false;
+  }
+
+#if defined(__GLIBC__)
+  void* warm_up[1];
+  backtrace(warm_up, 1);  // loads unwinder outside of signal handler
+#endif
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = backtrace_signal_handler;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(BACKTRACE_SIGNAL, &action, nullptr) != 0) {
+    WARNING_LOG() << "Can't install backtrace signal handler.";
+  }
+
+  stop_ = false;
+  thread_ = THREAD_MANAGER()->CreateThread(&LoopWatchdog::Run, this);
+  if (!thread_->Start()) {
+    thread_.reset();
+    return false;
+  }
+  return true;
+}
+
+void LoopWatchdog::Stop() {
+  if (!thread_) {
+    return;
+  }
+
+  stop_ = true;
+  thread_->Join();
+  thread_.reset();
+}
+
+void LoopWatchdog::Run() {
+  while (!stop_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(check_interval_msec));
+
+    std::unique_lock<std::mutex> lock(monitors_mutex_);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < monitors_.size(); ++i) {
+      std::chrono::steady_clock::time_point since;
+      uint64_t iteration = 0;
+      if (!monitors_[i]->GetBusy(&since, &iteration) || now - since < stall_threshold_) {
+        continue;
+      }
+
+      if (reported_iterations_[i] == iteration) {  // once per stalled callback
+        continue;
+      }
+
+      reported_iterations_[i] = iteration;
+      ReportStall(monitors_[i], now - since);
+    }
+  }
+}
+
+void LoopWatchdog::ReportStall(LoopMonitor* monitor, std::chrono::steady_clock::duration busy) {
+  monitor->IncStalls();
+  WARNING_LOG() << "Loop[" << monitor->GetLoopName() << "] stalled, callback executed "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(busy).count() << " msec.";
+
+  pthread_t thread;
+  if (!monitor->GetThread(&thread)) {
+    return;
+  }
+
+  stack_frames_count.store(-1, std::memory_order_release);
+  if (pthread_kill(thread, BACKTRACE_SIGNAL) != 0) {
+    return;
+  }
+
+  int frames = -1;
+  for (int waited = 0; waited < backtrace_wait_msec; ++waited) {
+    frames = stack_frames_count.load(std::memory_order_acquire);
+    if (frames != -1) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  if (frames <= 0) {
+    WARNING_LOG() << "Loop[" << monitor->GetLoopName() << "] backtrace unavailable.";
+    return;
+  }
+
+#if defined(__GLIBC__)
+  char** symbols = backtrace_symbols(stack_frames, frames);
+  if (!symbols) {
+    return;
+  }
+
+  std::string trace;
+  for (int i = 0; i < frames; ++i) {
+    trace += "\n  ";
+    trace += symbols[i];
+  }
+  free(symbols);
+  WARNING_LOG() << "Loop[" << monitor->GetLoopName() << "] backtrace:" << trace;
+#endif
+}
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
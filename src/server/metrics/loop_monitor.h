@@ -0,0 +1,128 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <pthread.h>  // for pthread_t
+#include <stdint.h>   // for uint64_t, uint32_t
+
+#include <atomic>
+#include <chrono>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <string>  // for string
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+class Counter;
+class Histogram;
+
+// lag and callbacks time of one loop, all methods except watchdog getters called from loop thread
+class LoopMonitor {
+ public:
+  enum callback_t { DATA_RECEIVED = 0, TIMER_EMITED, ACCEPTED, CLOSED, CALLBACKS_COUNT };
+
+  class CallbackScope {
+   public:
+    CallbackScope(LoopMonitor* monitor, callback_t callback);  // monitor can be nullptr
+    ~CallbackScope();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(CallbackScope);
+
+    LoopMonitor* const monitor_;
+    const callback_t callback_;
+    const std::chrono::steady_clock::time_point start_;
+  };
+
+  explicit LoopMonitor(const std::string& loop_name);
+
+  const std::string& GetLoopName() const;
+
+  void Attach(double probe_interval_sec);  // loop started
+  void Detach();
+  void ProbeFired();  // lag between scheduled and real probe timer time
+
+  // watchdog thread
+  bool GetBusy(std::chrono::steady_clock::time_point* since, uint64_t* iteration) const;
+  bool GetThread(pthread_t* thread) const;
+  void IncStalls();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoopMonitor);
+
+  void EnterCallback(std::chrono::steady_clock::time_point now);
+  void LeaveCallback(callback_t callback, std::chrono::steady_clock::duration elapsed);
+
+  const std::string loop_name_;
+  Histogram* lag_;
+  Histogram* callbacks_duration_[CALLBACKS_COUNT];
+  Counter* stalls_;
+
+  std::chrono::steady_clock::duration probe_interval_;
+  std::chrono::steady_clock::time_point probe_expected_;
+  size_t depth_;  // nested callbacks
+
+  std::atomic<int64_t> busy_since_;  // steady clock ticks, 0 if idle
+  std::atomic<uint64_t> iteration_;
+  std::atomic<bool> attached_;
+  pthread_t thread_;
+};
+
+// logs backtrace of loop thread if one callback executed longer than threshold
+class LoopWatchdog {
+ public:
+  enum { check_interval_msec = 50, backtrace_wait_msec = 100, max_frames = 64 };
+
+  explicit LoopWatchdog(uint32_t stall_threshold_msec);
+  ~LoopWatchdog();
+
+  void AddMonitor(LoopMonitor* monitor);  // thread safe
+  bool Start();
+  void Stop();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoopWatchdog);
+
+  void Run();
+  void ReportStall(LoopMonitor* monitor, std::chrono::steady_clock::duration busy);
+
+  const std::chrono::milliseconds stall_threshold_;
+  std::shared_ptr<common::threads::Thread<void>> thread_;
+  std::atomic<bool> stop_;
+
+  std::mutex monitors_mutex_;
+  std::vector<LoopMonitor*> monitors_;
+  std::vector<uint64_t> reported_iterations_;
+};
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,257 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/metrics/metrics.h"
+
+#include <inttypes.h>  // for PRIu64
+#include <stdio.h>     // for snprintf
+
+#include <common/logger.h>  // for WARNING_LOG
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+namespace {
+
+std::string EscapeLabelValue(const std::string& value) {
+  std::string result;
+  result.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      result += '\\';
+      result += c;
+    } else if (c == '\n') {
+      result += "\\n";
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+std::string RenderLabels(const labels_t& labels) {
+  std::string result;
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i != 0) {
+      result += ',';
+    }
+    result += labels[i].first + "=\"" + EscapeLabelValue(labels[i].second) + "\"";
+  }
+  return result;
+}
+
+std::string JoinLabels(const std::string& labels, const std::string& extra) {
+  if (labels.empty() && extra.empty()) {
+    return std::string();
+  }
+  if (labels.empty()) {
+    return "{" + extra + "}";
+  }
+  if (extra.empty()) {
+    return "{" + labels + "}";
+  }
+  return "{" + labels + "," + extra + "}";
+}
+
+std::string MicrosecondsToSeconds(uint64_t value) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "%" PRIu64 ".%06" PRIu64, value / 1000000, value % 1000000);
+  return buff;
+}
+
+}  // namespace
+
+Counter::Counter() : value_(0) {}
+
+Gauge::Gauge() : value_(0) {}
+
+Histogram::Histogram() : buckets_(), count_(0), sum_(0) {
+  for (size_t i = 0; i < buckets_count; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Histogram::GetValueAtPercentile(double percentile) const {
+  const uint64_t count = GetCount();
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t target = static_cast<uint64_t>(percentile / 100.0 * count);
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_count; ++i) {
+    seen += GetBucketCount(i);
+    if (seen >= target) {
+      return GetBucketUpperBound(i);
+    }
+  }
+  return GetBucketUpperBound(buckets_count - 1);
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t index) {
+  if (index < sub_buckets_count) {
+    return index;
+  }
+
+  const size_t shift = index / sub_buckets_count - 1;
+  const uint64_t mantissa = index % sub_buckets_count + sub_buckets_count;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+ScopedLatency::ScopedLatency(Histogram* histogram)
+    : histogram_(histogram),
+      start_(histogram ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+
+ScopedLatency::~ScopedLatency() {
+  if (!histogram_) {
+    return;
+  }
+
+  const auto elapsed = std::chrono::steady_clock::now() - start_;
+  histogram_->Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+Registry::Family::Family() : type(COUNTER), help(), counters(), gauges(), histograms() {}
+
+Registry* Registry::GetInstance() {
+  static Registry registry;
+  return &registry;
+}
+
+Registry::Registry() : mutex_(), families_() {}
+
+Registry::~Registry() {
+  for (auto& family : families_) {
+    for (auto& metric : family.second.counters) {
+      delete metric.second;
+    }
+    for (auto& metric : family.second.gauges) {
+      delete metric.second;
+    }
+    for (auto& metric : family.second.histograms) {
+      delete metric.second;
+    }
+  }
+}
+
+Registry::Family* Registry::GetFamily(const std::string& name, const std::string& help, metric_type type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    Family family;
+    family.type = type;
+    family.help = help;
+    it = families_.insert(std::make_pair(name, family)).first;
+  }
+
+  if (it->second.type != type) {
+    WARNING_LOG() << "Metric " << name << " already registered with other type.";
+    return nullptr;
+  }
+  return &it->second;
+}
+
+Counter* Registry::GetCounter(const std::string& name, const std::string& help, const labels_t& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, COUNTER);
+  if (!family) {
+    static Counter unregistered;
+    return &unregistered;
+  }
+
+  Counter*& metric = family->counters[RenderLabels(labels)];
+  if (!metric) {
+    metric = new Counter;
+  }
+  return metric;
+}
+
+Gauge* Registry::GetGauge(const std::string& name, const std::string& help, const labels_t& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, GAUGE);
+  if (!family) {
+    static Gauge unregistered;
+    return &unregistered;
+  }
+
+  Gauge*& metric = family->gauges[RenderLabels(labels)];
+  if (!metric) {
+    metric = new Gauge;
+  }
+  return metric;
+}
+
+Histogram* Registry::GetHistogram(const std::string& name, const std::string& help, const labels_t& labels) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Family* family = GetFamily(name, help, HISTOGRAM);
+  if (!family) {
+    static Histogram unregistered;
+    return &unregistered;
+  }
+
+  Histogram*& metric = family->histograms[RenderLabels(labels)];
+  if (!metric) {
+    metric = new Histogram;
+  }
+  return metric;
+}
+
+std::string Registry::Render() const {
+  std::string result;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& it : families_) {
+    const std::string& name = it.first;
+    const Family& family = it.second;
+    result += "# HELP " + name + " " + family.help + "\n";
+    const char* type = family.type == COUNTER ? "counter" : family.type == GAUGE ? "gauge" : "histogram";
+    result += "# TYPE " + name + " " + type + "\n";
+
+    for (const auto& metric : family.counters) {
+      result += name + JoinLabels(metric.first, std::string()) + " " + std::to_string(metric.second->Get()) + "\n";
+    }
+    for (const auto& metric : family.gauges) {
+      result += name + JoinLabels(metric.first, std::string()) + " " + std::to_string(metric.second->Get()) + "\n";
+    }
+    for (const auto& metric : family.histograms) {
+      const Histogram* histogram = metric.second;
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < Histogram::buckets_count; ++i) {
+        cumulative += histogram->GetBucketCount(i);
+        if ((i + 1) % Histogram::sub_buckets_count != 0) {  // exported per power of two
+          continue;
+        }
+
+        const std::string le = "le=\"" + MicrosecondsToSeconds(Histogram::GetBucketUpperBound(i)) + "\"";
+        result += name + "_bucket" + JoinLabels(metric.first, le) + " " + std::to_string(cumulative) + "\n";
+      }
+      result += name + "_bucket" + JoinLabels(metric.first, "le=\"+Inf\"") + " " + std::to_string(cumulative) + "\n";
+      result += name + "_sum" + JoinLabels(metric.first, std::string()) + " " +
+                MicrosecondsToSeconds(histogram->GetSum()) + "\n";
+      result += name + "_count" + JoinLabels(metric.first, std::string()) + " " + std::to_string(cumulative) + "\n";
+    }
+  }
+  return result;
+}
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,157 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t, int64_t
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>   // for string
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+typedef std::vector<std::pair<std::string, std::string>> labels_t;
+
+class Counter {
+ public:
+  Counter();
+
+  void Inc(uint64_t value = 1) { value_.fetch_add(value, std::memory_order_relaxed); }
+  uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Counter);
+
+  std::atomic<uint64_t> value_;
+};
+
+class Gauge {
+ public:
+  Gauge();
+
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t value) { value_.fetch_add(value, std::memory_order_relaxed); }
+  void Inc() { Add(1); }
+  void Dec() { Add(-1); }
+  int64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Gauge);
+
+  std::atomic<int64_t> value_;
+};
+
+// hdr style log-linear buckets for microseconds values, relative error 1 / sub_buckets_count
+class Histogram {
+ public:
+  enum { sub_bucket_bits = 2, sub_buckets_count = 1 << sub_bucket_bits, buckets_count = 32 * sub_buckets_count };
+
+  Histogram();
+
+  void Record(uint64_t value) {
+    buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t GetSum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t GetBucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+  uint64_t GetValueAtPercentile(double percentile) const;  // upper bound of bucket
+
+  static size_t GetBucketIndex(uint64_t value) {
+    if (value < sub_buckets_count) {
+      return value;
+    }
+
+    const size_t msb = 63 - __builtin_clzll(value);
+    const size_t shift = msb - sub_bucket_bits;
+    const size_t index = (shift + 1) * sub_buckets_count + ((value >> shift) - sub_buckets_count);
+    return index < buckets_count ? index : buckets_count - 1;
+  }
+  static uint64_t GetBucketUpperBound(size_t index);  // inclusive
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Histogram);
+
+  std::atomic<uint64_t> buckets_[buckets_count];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+};
+
+// records scope duration in microseconds, histogram can be nullptr
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(Histogram* histogram);
+  ~ScopedLatency();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedLatency);
+
+  Histogram* const histogram_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+// metrics never deleted, returned pointers valid for process lifetime
+class Registry {
+ public:
+  static Registry* GetInstance();
+
+  // thread safe, same metric for same name and labels
+  Counter* GetCounter(const std::string& name, const std::string& help, const labels_t& labels = labels_t());
+  Gauge* GetGauge(const std::string& name, const std::string& help, const labels_t& labels = labels_t());
+  Histogram* GetHistogram(const std::string& name, const std::string& help, const labels_t& labels = labels_t());
+
+  std::string Render() const;  // prometheus text format, histograms in seconds
+
+ private:
+  enum metric_type { COUNTER, GAUGE, HISTOGRAM };
+
+  struct Family {
+    Family();
+
+    metric_type type;
+    std::string help;
+    std::map<std::string, Counter*> counters;  // by rendered labels
+    std::map<std::string, Gauge*> gauges;
+    std::map<std::string, Histogram*> histograms;
+  };
+
+  Registry();
+  ~Registry();
+  DISALLOW_COPY_AND_ASSIGN(Registry);
+
+  Family* GetFamily(const std::string& name, const std::string& help, metric_type type);  // under lock
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,180 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/metrics/metrics_http_server.h"
+
+#include <errno.h>       // for errno
+#include <netdb.h>       // for getaddrinfo
+#include <poll.h>        // for poll
+#include <string.h>      // for strncmp
+#include <sys/socket.h>  // for socket, bind, listen
+#include <sys/time.h>    // for timeval
+#include <unistd.h>      // for close
+
+#include <string>  // for string
+
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/logger.h>          // for WARNING_LOG
+
+#include "server/metrics/metrics.h"         // for Registry
+#include "server/metrics/request_tracer.h"  // for RequestTracer
+
+#define METRICS_PATH "/metrics"
+#define TRACE_PATH "/trace"
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+namespace {
+
+bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t res = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (res <= 0) {
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += res;
+  }
+  return true;
+}
+
+std::string MakeResponse(const std::string& status, const std::string& content_type, const std::string& body) {
+  return "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type +
+         "\r\nContent-Length: " + common::ConvertToString(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+bool IsGetRequest(const std::string& request, const std::string& path) {
+  const std::string get = "GET " + path;
+  return request.compare(0, get.size(), get) == 0 && request.size() > get.size() &&
+         (request[get.size()] == ' ' || request[get.size()] == '?');
+}
+
+}  // namespace
+
+MetricsHttpServer::MetricsHttpServer(const common::net::HostAndPort& host) : host_(host), fd_(-1), stop_(false) {}
+
+MetricsHttpServer::~MetricsHttpServer() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+common::ErrnoError MetricsHttpServer::Bind() {
+  const std::string port = common::ConvertToString(host_.GetPort());
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  struct addrinfo* result = nullptr;
+  int res = getaddrinfo(host_.GetHost().c_str(), port.c_str(), &hints, &result);
+  if (res != 0) {
+    return common::make_errno_error(gai_strerror(res), EINVAL);
+  }
+
+  int err = EINVAL;
+  for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+    int fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (fd == -1) {
+      err = errno;
+      continue;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, rp->ai_addr, rp->ai_addrlen) == 0 && listen(fd, 16) == 0) {
+      fd_ = fd;
+      break;
+    }
+
+    err = errno;
+    close(fd);
+  }
+  freeaddrinfo(result);
+
+  if (fd_ == -1) {
+    return common::make_errno_error("Metrics server bind failed", err);
+  }
+  return common::ErrnoError();
+}
+
+void MetricsHttpServer::Serve() {
+  while (!stop_ && fd_ != -1) {
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int res = poll(&pfd, 1, poll_timeout_msec);
+    if (res <= 0) {
+      continue;
+    }
+
+    int client = accept(fd_, nullptr, nullptr);
+    if (client == -1) {
+      continue;
+    }
+
+    HandleConnection(client);
+    close(client);
+  }
+}
+
+void MetricsHttpServer::Stop() {
+  stop_ = true;
+}
+
+void MetricsHttpServer::HandleConnection(int fd) {
+  struct timeval tv;
+  tv.tv_sec = read_timeout_sec;
+  tv.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  std::string request;
+  char buff[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < max_request_size) {
+    ssize_t res = recv(fd, buff, sizeof(buff), 0);
+    if (res <= 0) {
+      break;
+    }
+    request.append(buff, res);
+  }
+
+  std::string responce;
+  if (IsGetRequest(request, METRICS_PATH)) {
+    responce = MakeResponse("200 OK", "text/plain; version=0.0.4", Registry::GetInstance()->Render());
+  } else if (IsGetRequest(request, TRACE_PATH) && RequestTracer::GetInstance()->IsEnabled()) {
+    responce = MakeResponse("200 OK", "application/json", RequestTracer::GetInstance()->ExportChromeTrace());
+  } else {
+    WriteAll(fd, MakeResponse("404 Not Found", "text/plain", "Not found\n"));
+    return;
+  }
+
+  if (!WriteAll(fd, responce)) {
+    WARNING_LOG() << "Metrics responce write failed.";
+  }
+}
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,56 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <common/error.h>      // for ErrnoError
+#include <common/macros.h>     // for WARN_UNUSED_RESULT
+#include <common/net/types.h>  // for HostAndPort
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+// minimal blocking http server, GET /metrics in prometheus text format and GET /trace in chrome trace format,
+// one request per connection
+class MetricsHttpServer {
+ public:
+  enum { poll_timeout_msec = 500, read_timeout_sec = 1, max_request_size = 4096 };
+
+  explicit MetricsHttpServer(const common::net::HostAndPort& host);
+  ~MetricsHttpServer();
+
+  common::ErrnoError Bind() WARN_UNUSED_RESULT;
+  void Serve();  // blocks until Stop
+  void Stop();   // thread safe
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MetricsHttpServer);
+
+  void HandleConnection(int fd);
+
+  const common::net::HostAndPort host_;
+  int fd_;
+  std::atomic<bool> stop_;
+};
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,240 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/metrics/request_tracer.h"
+
+#include <functional>  // for hash
+#include <thread>
+
+#include <json-c/json_object.h>  // for json_object_new_object
+
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/sprintf.h>         // for MemSPrintf
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+namespace {
+
+thread_local const ScopedSpan* current_span = nullptr;
+
+uint64_t CurrentThreadId() {
+  return std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+int64_t ToMicroseconds(RequestTracer::time_point_t from, RequestTracer::time_point_t to) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+}  // namespace
+
+RequestTracer::Span::Span() : scope(nullptr), id(), stage(""), detail(), start(), end(), thread(0) {}
+
+RequestTracer* RequestTracer::GetInstance() {
+  static RequestTracer tracer;
+  return &tracer;
+}
+
+RequestTracer::RequestTracer()
+    : enabled_(false),
+      created_(std::chrono::steady_clock::now()),
+      mutex_(),
+      capacity_(0),
+      spans_(),
+      next_span_(0),
+      open_spans_() {}
+
+void RequestTracer::Enable(size_t capacity) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  spans_.clear();
+  spans_.reserve(capacity);
+  next_span_ = 0;
+  open_spans_.clear();
+  enabled_ = capacity != 0;
+}
+
+void RequestTracer::AddSpan(const void* scope,
+                            const std::string& id,
+                            const char* stage,
+                            const std::string& detail,
+                            time_point_t start,
+                            time_point_t end) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  Span span;
+  span.scope = scope;
+  span.id = id;
+  span.stage = stage;
+  span.detail = detail;
+  span.start = start;
+  span.end = end;
+  span.thread = CurrentThreadId();
+  std::unique_lock<std::mutex> lock(mutex_);
+  PushSpan(span);
+}
+
+void RequestTracer::Begin(const void* scope, const std::string& id, const char* stage) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  const time_point_t now = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (open_spans_.size() >= capacity_) {  // never ended spans
+    open_spans_.clear();
+  }
+  open_spans_[std::make_pair(std::make_pair(scope, id), stage)] = std::make_pair(now, CurrentThreadId());
+}
+
+void RequestTracer::End(const void* scope, const std::string& id, const char* stage) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  const time_point_t now = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = open_spans_.find(std::make_pair(std::make_pair(scope, id), stage));
+  if (it == open_spans_.end()) {
+    return;
+  }
+
+  Span span;
+  span.scope = scope;
+  span.id = id;
+  span.stage = stage;
+  span.start = it->second.first;
+  span.end = now;
+  span.thread = it->second.second;
+  open_spans_.erase(it);
+  PushSpan(span);
+}
+
+void RequestTracer::PushSpan(const Span& span) {
+  if (capacity_ == 0) {
+    return;
+  }
+
+  if (spans_.size() < capacity_) {
+    spans_.push_back(span);
+  } else {
+    spans_[next_span_] = span;
+  }
+  next_span_ = (next_span_ + 1) % capacity_;
+}
+
+std::string RequestTracer::ExportChromeTrace() const {
+  json_object* events = json_object_new_array();
+  std::map<std::pair<const void*, std::string>, int> rows;  // one row per request
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const Span& span : spans_) {
+      const auto row_key = std::make_pair(span.scope, span.id);
+      auto row = rows.find(row_key);
+      if (row == rows.end()) {
+        row = rows.insert(std::make_pair(row_key, static_cast<int>(rows.size() + 1))).first;
+        const std::string row_name = span.scope ? common::MemSPrintf("client %p request %s", span.scope, span.id)
+                                                : "external request " + span.id;
+        json_object* meta = json_object_new_object();
+        json_object* meta_args = json_object_new_object();
+        json_object_object_add(meta_args, "name", json_object_new_string(row_name.c_str()));
+        json_object_object_add(meta, "name", json_object_new_string("thread_name"));
+        json_object_object_add(meta, "ph", json_object_new_string("M"));
+        json_object_object_add(meta, "pid", json_object_new_int(1));
+        json_object_object_add(meta, "tid", json_object_new_int(row->second));
+        json_object_object_add(meta, "args", meta_args);
+        json_object_array_add(events, meta);
+      }
+
+      json_object* args = json_object_new_object();
+      json_object_object_add(args, "thread", json_object_new_string(common::ConvertToString(span.thread).c_str()));
+      if (!span.detail.empty()) {
+        json_object_object_add(args, "detail", json_object_new_string(span.detail.c_str()));
+      }
+
+      json_object* event = json_object_new_object();
+      json_object_object_add(event, "name", json_object_new_string(span.stage));
+      json_object_object_add(event, "cat", json_object_new_string("request"));
+      json_object_object_add(event, "ph", json_object_new_string("X"));
+      json_object_object_add(event, "ts", json_object_new_int64(ToMicroseconds(created_, span.start)));
+      json_object_object_add(event, "dur", json_object_new_int64(ToMicroseconds(span.start, span.end)));
+      json_object_object_add(event, "pid", json_object_new_int(1));
+      json_object_object_add(event, "tid", json_object_new_int(row->second));
+      json_object_object_add(event, "args", args);
+      json_object_array_add(events, event);
+    }
+  }
+
+  json_object* trace = json_object_new_object();
+  json_object_object_add(trace, "traceEvents", events);
+  json_object_object_add(trace, "displayTimeUnit", json_object_new_string("ms"));
+  const std::string result = json_object_get_string(trace);
+  json_object_put(trace);
+  return result;
+}
+
+ScopedSpan::ScopedSpan(const void* scope, const std::string& id, const char* stage, const char* detail)
+    : active_(RequestTracer::GetInstance()->IsEnabled()),
+      scope_(scope),
+      id_(),
+      stage_(stage),
+      detail_(detail),
+      start_(),
+      parent_(current_span) {
+  if (!active_) {
+    return;
+  }
+
+  id_ = id;
+  start_ = std::chrono::steady_clock::now();
+  current_span = this;
+}
+
+ScopedSpan::ScopedSpan(const char* stage, const char* detail)
+    : active_(current_span != nullptr),
+      scope_(nullptr),
+      id_(),
+      stage_(stage),
+      detail_(detail),
+      start_(),
+      parent_(current_span) {
+  if (!active_) {
+    return;
+  }
+
+  scope_ = parent_->scope_;
+  id_ = parent_->id_;
+  start_ = std::chrono::steady_clock::now();
+  current_span = this;
+}
+
+ScopedSpan::~ScopedSpan() {
+  if (!active_) {
+    return;
+  }
+
+  current_span = parent_;
+  RequestTracer::GetInstance()->AddSpan(scope_, id_, stage_, detail_, start_, std::chrono::steady_clock::now());
+}
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
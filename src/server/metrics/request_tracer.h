@@ -0,0 +1,112 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>   // for string
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+namespace server {
+namespace metrics {
+
+// per request spans keyed by scope (connection, nullptr for external commands) and cmd_seq_t,
+// last spans kept in memory, exported in chrome trace format (chrome://tracing, perfetto)
+class RequestTracer {
+ public:
+  typedef std::chrono::steady_clock::time_point time_point_t;
+
+  static RequestTracer* GetInstance();
+
+  void Enable(size_t capacity);  // 0 disables, before loops started
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // thread safe
+  void AddSpan(const void* scope,
+               const std::string& id,
+               const char* stage,
+               const std::string& detail,
+               time_point_t start,
+               time_point_t end);
+  void Begin(const void* scope, const std::string& id, const char* stage);  // ended in any thread
+  void End(const void* scope, const std::string& id, const char* stage);
+
+  std::string ExportChromeTrace() const;
+
+ private:
+  struct Span {
+    Span();
+
+    const void* scope;
+    std::string id;
+    const char* stage;  // literal
+    std::string detail;
+    time_point_t start;
+    time_point_t end;
+    uint64_t thread;
+  };
+
+  typedef std::pair<std::pair<const void*, std::string>, const char*> open_key_t;
+
+  RequestTracer();
+  DISALLOW_COPY_AND_ASSIGN(RequestTracer);
+
+  void PushSpan(const Span& span);  // under lock
+
+  std::atomic<bool> enabled_;
+  const time_point_t created_;
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::vector<Span> spans_;  // ring
+  size_t next_span_;
+  std::map<open_key_t, std::pair<time_point_t, uint64_t>> open_spans_;
+};
+
+// records span of scope, nested spans without id inherit it in the same thread
+class ScopedSpan {
+ public:
+  ScopedSpan(const void* scope, const std::string& id, const char* stage, const char* detail = "");
+  explicit ScopedSpan(const char* stage, const char* detail = "");
+  ~ScopedSpan();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedSpan);
+
+  bool active_;
+  const void* scope_;
+  std::string id_;
+  const char* stage_;
+  const char* detail_;
+  RequestTracer::time_point_t start_;
+  const ScopedSpan* parent_;
+};
+
+}  // namespace metrics
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,139 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/rate_limiter.h"
+
+#include <stdlib.h>  // for strtod
+
+#include <algorithm>  // for min
+
+namespace fastotv {
+namespace server {
+
+RateLimit::RateLimit() : rate(0), burst(0) {}
+
+RateLimit::RateLimit(double rate, double burst) : rate(rate), burst(burst) {}
+
+bool RateLimit::IsEnabled() const {
+  return rate > 0;
+}
+
+bool ParseRateLimit(const std::string& value, RateLimit* limit) {
+  if (!limit) {
+    return false;
+  }
+
+  const char* str = value.c_str();
+  char* end = nullptr;
+  const double rate = strtod(str, &end);
+  if (end == str || rate < 0) {
+    return false;
+  }
+
+  double burst = rate;
+  if (*end == '/') {
+    str = end + 1;
+    burst = strtod(str, &end);
+    if (end == str) {
+      return false;
+    }
+  }
+
+  if (*end != '\0' || (rate > 0 && burst < 1)) {
+    return false;
+  }
+
+  *limit = RateLimit(rate, burst);
+  return true;
+}
+
+TokenBucket::TokenBucket() : tokens_(0), last_() {}
+
+bool TokenBucket::Consume(const RateLimit& limit, std::chrono::steady_clock::time_point now) {
+  if (!limit.IsEnabled()) {
+    return true;
+  }
+
+  tokens_ = Refill(limit, now);
+  last_ = now;
+  if (tokens_ < 1) {
+    return false;
+  }
+
+  tokens_ -= 1;
+  return true;
+}
+
+bool TokenBucket::IsFull(const RateLimit& limit, std::chrono::steady_clock::time_point now) const {
+  return !limit.IsEnabled() || Refill(limit, now) >= limit.burst;
+}
+
+double TokenBucket::Refill(const RateLimit& limit, std::chrono::steady_clock::time_point now) const {
+  if (last_ == std::chrono::steady_clock::time_point()) {  // never used
+    return limit.burst;
+  }
+
+  const std::chrono::duration<double> elapsed = now - last_;
+  return std::min(limit.burst, tokens_ + elapsed.count() * limit.rate);
+}
+
+LoginRateLimiter::LoginRateLimiter() : shards_() {}
+
+bool LoginRateLimiter::Consume(Symbol login,
+                               RateLimitClass cls,
+                               const RateLimit& limit,
+                               std::chrono::steady_clock::time_point now) {
+  if (!limit.IsEnabled() || login.IsEmpty()) {
+    return true;
+  }
+
+  Shard& shard = shards_[std::hash<Symbol>()(login) % shards_count];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  return shard.logins[login].buckets[cls].Consume(limit, now);
+}
+
+void LoginRateLimiter::Prune(const RateLimit (&limits)[RATE_LIMIT_CLASSES_COUNT],
+                             std::chrono::steady_clock::time_point now) {
+  for (size_t i = 0; i < shards_count; ++i) {
+    Shard& shard = shards_[i];
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    for (auto it = shard.logins.begin(); it != shard.logins.end();) {
+      bool full = true;
+      for (size_t cls = 0; cls < RATE_LIMIT_CLASSES_COUNT && full; ++cls) {
+        full = it->second.buckets[cls].IsFull(limits[cls], now);
+      }
+      if (full) {
+        it = shard.logins.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+size_t LoginRateLimiter::GetSize() const {
+  size_t size = 0;
+  for (size_t i = 0; i < shards_count; ++i) {
+    std::unique_lock<std::mutex> lock(shards_[i].mutex);
+    size += shards_[i].logins.size();
+  }
+  return size;
+}
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,93 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "symbol.h"  // for Symbol
+
+namespace fastotv {
+namespace server {
+
+enum RateLimitClass { CHAT_RATE_LIMIT = 0, CHANNELS_RATE_LIMIT, RATE_LIMIT_CLASSES_COUNT };
+
+// requests per second and bucket size, disabled if rate is 0
+struct RateLimit {
+  RateLimit();
+  RateLimit(double rate, double burst);
+
+  bool IsEnabled() const;
+
+  double rate;
+  double burst;
+};
+
+bool ParseRateLimit(const std::string& value, RateLimit* limit);  // "rate/burst" or "rate", burst same as rate
+
+// limit not stored, bucket is small enough to live in every connection
+class TokenBucket {
+ public:
+  TokenBucket();  // full
+
+  bool Consume(const RateLimit& limit, std::chrono::steady_clock::time_point now);
+  bool IsFull(const RateLimit& limit, std::chrono::steady_clock::time_point now) const;
+
+ private:
+  double Refill(const RateLimit& limit, std::chrono::steady_clock::time_point now) const;
+
+  double tokens_;
+  std::chrono::steady_clock::time_point last_;
+};
+
+// buckets shared by all connections of login, thread safe
+class LoginRateLimiter {
+ public:
+  enum { shards_count = 16 };
+
+  LoginRateLimiter();
+
+  bool Consume(Symbol login, RateLimitClass cls, const RateLimit& limit, std::chrono::steady_clock::time_point now);
+  void Prune(const RateLimit (&limits)[RATE_LIMIT_CLASSES_COUNT],
+             std::chrono::steady_clock::time_point now);  // drops full buckets
+  size_t GetSize() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoginRateLimiter);
+
+  struct Buckets {
+    TokenBucket buckets[RATE_LIMIT_CLASSES_COUNT];
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<Symbol, Buckets> logins;
+  };
+
+  mutable Shard shards_[shards_count];
+};
+
+}  // namespace server
+}  // namespace fastotv
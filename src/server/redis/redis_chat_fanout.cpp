@@ -0,0 +1,279 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_chat_fanout.h"
+
+#include <errno.h>
+#include <poll.h>
+
+#include <string>
+#include <utility>  // for make_pair
+
+#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
+
+#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+
+#include "server/redis/redis_connect.h"
+
+#define FRAME_SEPARATOR '\n'
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+RedisChatFanoutHandler::~RedisChatFanoutHandler() {}
+
+RedisChatFanout::RedisChatFanout(RedisChatFanoutHandler* handler)
+    : handler_(handler),
+      config_(),
+      node_id_(),
+      stop_(false),
+      subscriptions_(),
+      mutex_(),
+      subscriptions_changes_(),
+      pending_frames_() {}
+
+void RedisChatFanout::SetConfig(const RedisSubConfig& config, const std::string& node_id) {
+  config_ = config;
+  node_id_ = node_id;
+}
+
+void RedisChatFanout::Listen() {
+  ReconnectBackoff backoff;
+  while (!stop_) {
+    common::Error err = Serve(&backoff);
+    if (stop_) {
+      break;
+    }
+
+    WARNING_LOG() << "REDIS CHAT FANOUT ERROR: " << err->GetDescription() << ", reconnect in " << backoff.GetDelay()
+                  << " msec";
+    backoff.Wait(stop_);
+  }
+}
+
+common::Error RedisChatFanout::Serve(ReconnectBackoff* backoff) {
+  redisContext* redis_sub = nullptr;
+  common::Error err = redis_connect(config_, &redis_sub);
+  if (err) {
+    return err;
+  }
+
+  redisContext* redis_pub = nullptr;
+  err = redis_connect(config_, &redis_pub);
+  if (err) {
+    redisFree(redis_sub);
+    return err;
+  }
+
+  err = FlushSubscriptions(redis_sub, true);
+  if (!err) {
+    backoff->Reset();
+  }
+
+  while (!err && !stop_) {
+    err = FlushSubscriptions(redis_sub, false);
+    if (err) {
+      break;
+    }
+
+    err = FlushFrames(redis_pub);
+    if (err) {
+      break;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = redis_sub->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int res = poll(&pfd, 1, flush_interval_msec);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      err = common::make_error("Poll error");
+      break;
+    }
+
+    if (res != 0) {
+      err = ReadFrames(redis_sub);
+    }
+  }
+
+  redisFree(redis_pub);
+  redisFree(redis_sub);
+  return err;
+}
+
+common::Error RedisChatFanout::ReadFrames(redisContext* redis_sub) {
+  if (redisBufferRead(redis_sub) != REDIS_OK) {
+    return common::make_error(redis_sub->errstr);
+  }
+
+  while (true) {
+    redisReply* lreply = nullptr;
+    if (redisGetReplyFromReader(redis_sub, reinterpret_cast<void**>(&lreply)) != REDIS_OK) {
+      return common::make_error(redis_sub->errstr);
+    }
+
+    if (!lreply) {
+      return common::Error();
+    }
+
+    bool is_message = lreply->type == REDIS_REPLY_ARRAY && lreply->elements == 3 &&
+                      lreply->element[1]->type == REDIS_REPLY_STRING && lreply->element[2]->type == REDIS_REPLY_STRING;
+    if (is_message) {  // skip subscribe/unsubscribe confirmations
+      HandleFrame(std::string(lreply->element[1]->str, lreply->element[1]->len),
+                  std::string(lreply->element[2]->str, lreply->element[2]->len));
+    }
+    freeReplyObject(lreply);
+  }
+}
+
+void RedisChatFanout::Stop() {
+  stop_ = true;
+}
+
+void RedisChatFanout::Subscribe(const std::string& sid) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  subscriptions_changes_[config_.channel_chat_prefix + sid] = true;
+}
+
+void RedisChatFanout::UnSubscribe(const std::string& sid) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  subscriptions_changes_[config_.channel_chat_prefix + sid] = false;
+}
+
+void RedisChatFanout::Publish(const std::string& sid, const std::string& msg) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::deque<std::string>& messages = pending_frames_[config_.channel_chat_prefix + sid];
+  if (messages.size() >= max_pending_messages) {  // redis not responding, drop oldest
+    messages.pop_front();
+  }
+  messages.push_back(msg);
+}
+
+common::Error RedisChatFanout::FlushSubscriptions(redisContext* redis_sub, bool resubscribe) {
+  std::map<std::string, bool> changes;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changes.swap(subscriptions_changes_);
+  }
+
+  for (auto it = changes.begin(); it != changes.end(); ++it) {
+    if (it->second) {
+      subscriptions_.insert(it->first);
+    } else if (subscriptions_.erase(it->first) == 0) {
+      continue;
+    }
+
+    if (!resubscribe) {
+      const char* command = it->second ? "SUBSCRIBE %s" : "UNSUBSCRIBE %s";
+      redisAppendCommand(redis_sub, command, it->first.c_str());
+    }
+  }
+
+  if (resubscribe) {  // new connection
+    for (const std::string& channel : subscriptions_) {
+      redisAppendCommand(redis_sub, "SUBSCRIBE %s", channel.c_str());
+    }
+  }
+
+  if (changes.empty() && !resubscribe) {
+    return common::Error();
+  }
+
+  int done = 0;
+  while (!done) {  // confirmations readed with messages
+    if (redisBufferWrite(redis_sub, &done) != REDIS_OK) {
+      return common::make_error(redis_sub->errstr);
+    }
+  }
+  return common::Error();
+}
+
+RedisChatFanout::frames_t RedisChatFanout::PrepareFrames() {
+  std::map<std::string, std::deque<std::string>> pending;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending.swap(pending_frames_);
+  }
+
+  frames_t frames;
+  for (auto it = pending.begin(); it != pending.end(); ++it) {
+    const std::deque<std::string>& messages = it->second;
+    for (size_t i = 0; i < messages.size(); i += max_frame_messages) {
+      std::string frame = node_id_;
+      for (size_t j = i; j < messages.size() && j < i + max_frame_messages; ++j) {
+        frame += FRAME_SEPARATOR;
+        frame += messages[j];
+      }
+      frames.push_back(std::make_pair(it->first, frame));
+    }
+  }
+  return frames;
+}
+
+common::Error RedisChatFanout::FlushFrames(redisContext* redis_pub) {
+  const frames_t frames = PrepareFrames();
+  for (const auto& frame : frames) {  // pipelined
+    const char* argv[] = {"PUBLISH", frame.first.c_str(), frame.second.c_str()};
+    const size_t argvlen[] = {7, frame.first.size(), frame.second.size()};
+    redisAppendCommandArgv(redis_pub, 3, argv, argvlen);
+  }
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    void* reply = nullptr;
+    if (redisGetReply(redis_pub, &reply) != REDIS_OK) {
+      return common::make_error(redis_pub->errstr);
+    }
+    freeReplyObject(reply);
+  }
+  return common::Error();
+}
+
+void RedisChatFanout::HandleFrame(const std::string& channel, const std::string& frame) {
+  const std::string& prefix = config_.channel_chat_prefix;
+  if (channel.compare(0, prefix.size(), prefix) != 0) {
+    return;
+  }
+
+  size_t start = frame.find(FRAME_SEPARATOR);
+  if (start == std::string::npos) {
+    return;
+  }
+
+  if (frame.compare(0, start, node_id_) == 0) {  // own frame, already delivered to local clients
+    return;
+  }
+
+  std::vector<std::string> messages;
+  while (start != std::string::npos) {
+    size_t end = frame.find(FRAME_SEPARATOR, start + 1);
+    messages.push_back(frame.substr(start + 1, end == std::string::npos ? std::string::npos : end - start - 1));
+    start = end;
+  }
+
+  if (handler_) {
+    handler_->HandleChatFrame(channel.substr(prefix.size()), messages);
+  }
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,91 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/error.h>
+
+#include "server/redis/redis_connect.h"  // for ReconnectBackoff
+#include "server/redis/redis_sub_config.h"
+
+struct redisContext;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+class RedisChatFanoutHandler {
+ public:
+  // messages from other nodes, serialized ChatMessage's
+  virtual void HandleChatFrame(const std::string& sid, const std::vector<std::string>& messages) = 0;
+  virtual ~RedisChatFanoutHandler();
+};
+
+// per stream channels (prefix + sid), node subscribed only to streams watched by local clients
+// messages collected and published once per flush interval as one frame: node\nmsg\nmsg...
+// reconnects with backoff and subscribes again, messages published while disconnected are lost
+class RedisChatFanout {
+ public:
+  enum { flush_interval_msec = 20, max_frame_messages = 256, max_pending_messages = max_frame_messages * 4 };
+  typedef std::vector<std::pair<std::string, std::string>> frames_t;  // channel, frame
+
+  explicit RedisChatFanout(RedisChatFanoutHandler* handler);
+
+  void SetConfig(const RedisSubConfig& config, const std::string& node_id);
+
+  void Listen();  // blocks until Stop
+  void Stop();
+
+  // thread safe
+  void Subscribe(const std::string& sid);
+  void UnSubscribe(const std::string& sid);
+  void Publish(const std::string& sid, const std::string& msg);
+
+  // listen thread only
+  void HandleFrame(const std::string& channel, const std::string& frame);
+  frames_t PrepareFrames();  // pending messages packed into frames
+
+ private:
+  common::Error Serve(ReconnectBackoff* backoff) WARN_UNUSED_RESULT;  // one connection, until error or stop
+  common::Error ReadFrames(redisContext* redis_sub) WARN_UNUSED_RESULT;
+  common::Error FlushSubscriptions(redisContext* redis_sub, bool resubscribe) WARN_UNUSED_RESULT;
+  common::Error FlushFrames(redisContext* redis_pub) WARN_UNUSED_RESULT;
+
+  RedisChatFanoutHandler* const handler_;
+  RedisSubConfig config_;
+  std::string node_id_;
+  std::atomic<bool> stop_;
+  std::set<std::string> subscriptions_;  // listen thread only, restored after reconnect
+
+  std::mutex mutex_;
+  std::map<std::string, bool> subscriptions_changes_;            // channel -> subscribe
+  std::map<std::string, std::deque<std::string>> pending_frames_;  // channel -> messages
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
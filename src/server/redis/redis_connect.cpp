@@ -18,7 +18,10 @@
 
 #include "server/redis/redis_connect.h"
 
-#include <string>  // for string
+#include <algorithm>  // for min
+#include <chrono>     // for milliseconds
+#include <string>     // for string
+#include <thread>     // for sleep_for
 #include <vector>
 
 #include <hiredis/hiredis.h>  // for redisFree, redisContext
@@ -115,6 +118,27 @@ common::Error redis_connect(const RedisConfig& config, redisContext** conn) {
   return common::Error();
 }
 
+ReconnectBackoff::ReconnectBackoff() : delay_msec_(min_delay_msec) {}
+
+unsigned ReconnectBackoff::GetDelay() const {
+  return delay_msec_;
+}
+
+void ReconnectBackoff::Reset() {
+  delay_msec_ = min_delay_msec;
+}
+
+void ReconnectBackoff::Wait(const std::atomic<bool>& stop) {
+  for (unsigned slept = 0; slept < delay_msec_ && !stop; slept += sleep_step_msec) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_step_msec));
+  }
+  Failed();
+}
+
+void ReconnectBackoff::Failed() {
+  delay_msec_ = std::min(delay_msec_ * 2, static_cast<unsigned>(max_delay_msec));
+}
+
 }  // namespace redis
 }  // namespace server
 }  // namespace fastotv
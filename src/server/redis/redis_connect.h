@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <common/error.h>
 
 #include "server/redis/redis_config.h"
@@ -33,6 +35,22 @@ common::Error redis_unix_connect(const std::string& unix_path, redisContext** co
 
 common::Error redis_connect(const RedisConfig& config, redisContext** conn);
 
+// delay between reconnects of long lived listeners, doubles after every failed attempt
+class ReconnectBackoff {
+ public:
+  enum { min_delay_msec = 100, max_delay_msec = 30000, sleep_step_msec = 100 };
+
+  ReconnectBackoff();
+
+  unsigned GetDelay() const;
+  void Reset();                              // after successful connect
+  void Wait(const std::atomic<bool>& stop);  // sleeps current delay, wakes up earlier on stop
+  void Failed();                             // without sleep
+
+ private:
+  unsigned delay_msec_;
+};
+
 }  // namespace redis
 }  // namespace server
 }  // namespace fastotv
@@ -0,0 +1,581 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_devices_registry.h"
+
+#include <stdlib.h>  // for strtoll
+
+#include <algorithm>  // for max
+#include <chrono>     // for seconds
+#include <string>
+#include <vector>
+
+#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
+
+#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/time.h>            // for current_utc_mstime
+
+#include "server/redis/redis_connect.h"
+
+#define DEVICE_FIELD_SEPARATOR ':'
+#define LEASE_SEPARATOR '|'
+#define CHANGE_CONNECTED '+'
+#define CHANGE_DISCONNECTED '-'
+#define CHANGE_HEARTBEAT '~'
+
+// KEYS[1] registry, ARGV[1] field, ARGV[2] node, ARGV[3] now, ARGV[4] lease expire
+// returns current owner if it is alive and not we
+#define CLAIM_SCRIPT                                                                   \
+  "local v = redis.call('HGET', KEYS[1], ARGV[1]) "                                    \
+  "if v then "                                                                         \
+  "  local node, exp = string.match(v, '^(.*)|(%d+)$') "                              \
+  "  if node and node ~= ARGV[2] and tonumber(exp) > tonumber(ARGV[3]) then return node end " \
+  "end "                                                                               \
+  "redis.call('HSET', KEYS[1], ARGV[1], ARGV[2] .. '|' .. ARGV[4]) "                   \
+  "return false"
+
+// KEYS[1] registry, ARGV[1] field, ARGV[2] node
+#define RELEASE_SCRIPT                                                     \
+  "local v = redis.call('HGET', KEYS[1], ARGV[1]) "                        \
+  "if v and string.sub(v, 1, string.len(ARGV[2]) + 1) == ARGV[2] .. '|' then " \
+  "  return redis.call('HDEL', KEYS[1], ARGV[1]) "                         \
+  "end "                                                                   \
+  "return 0"
+
+// KEYS[1] registry, ARGV[1] node, ARGV[2] lease expire, ARGV[3] now, ARGV[4..] fields
+// extends only own leases, returns {field index, owner} for fields claimed by other alive node
+#define REFRESH_SCRIPT                                                                      \
+  "local lost = {} "                                                                        \
+  "for i = 4, #ARGV do "                                                                    \
+  "  local v = redis.call('HGET', KEYS[1], ARGV[i]) "                                       \
+  "  local node, exp = nil, nil "                                                           \
+  "  if v then node, exp = string.match(v, '^(.*)|(%d+)$') end "                            \
+  "  if node and node ~= ARGV[1] and tonumber(exp) > tonumber(ARGV[3]) then "               \
+  "    table.insert(lost, i - 4) "                                                          \
+  "    table.insert(lost, node) "                                                           \
+  "  else "                                                                                 \
+  "    redis.call('HSET', KEYS[1], ARGV[i], ARGV[1] .. '|' .. ARGV[2]) "                    \
+  "  end "                                                                                  \
+  "end "                                                                                    \
+  "return lost"
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+namespace {
+
+std::string make_device_field(const user_id_t& uid, const device_id_t& dev) {
+  return uid + DEVICE_FIELD_SEPARATOR + dev;
+}
+
+common::time64_t current_sec() {
+  return common::time::current_utc_mstime() / 1000;
+}
+
+}  // namespace
+
+RedisDevicesRegistryObserver::~RedisDevicesRegistryObserver() {}
+
+RedisDevicesRegistry::RedisDevicesRegistry(RedisDevicesRegistryObserver* observer)
+    : observer_(observer),
+      config_(),
+      node_id_(),
+      updates_mutex_(),
+      updates_cond_(),
+      updates_(),
+      stop_(false),
+      local_devices_(),
+      cache_mutex_(),
+      cache_(),
+      nodes_heartbeats_() {}
+
+void RedisDevicesRegistry::SetConfig(const RedisSubConfig& config, const std::string& node_id) {
+  config_ = config;
+  node_id_ = node_id;
+}
+
+std::string RedisDevicesRegistry::GetNodeId() const {
+  return node_id_;
+}
+
+void RedisDevicesRegistry::Listen() {
+  ReconnectBackoff backoff;
+  while (!stop_) {
+    common::Error err = Serve(&backoff);
+    if (stop_) {
+      break;
+    }
+
+    WARNING_LOG() << "REDIS DEVICES REGISTRY ERROR: " << err->GetDescription() << ", reconnect in "
+                  << backoff.GetDelay() << " msec";
+    backoff.Wait(stop_);
+  }
+
+  std::unique_lock<std::mutex> lock(updates_mutex_);
+  updates_.clear();
+}
+
+common::Error RedisDevicesRegistry::Serve(ReconnectBackoff* backoff) {
+  redisContext* redis = nullptr;
+  common::Error err = redis_connect(config_, &redis);
+  if (err) {
+    return err;
+  }
+
+  err = LoadAll(redis);
+  if (err) {
+    redisFree(redis);
+    return err;
+  }
+
+  backoff->Reset();
+  common::time64_t next_refresh = 0;  // own leases could lapse while we were disconnected
+  while (!stop_) {
+    const common::time64_t now = current_sec();
+    if (now >= next_refresh) {
+      err = RefreshLeases(redis);
+      if (err) {
+        break;
+      }
+      PruneCache(now);
+      next_refresh = now + refresh_interval_sec;
+    }
+
+    updates_t updates;
+    {
+      std::unique_lock<std::mutex> lock(updates_mutex_);
+      updates_cond_.wait_for(lock, std::chrono::seconds(std::max<common::time64_t>(next_refresh - now, 1)),
+                             [this]() { return stop_ || !updates_.empty(); });
+      if (stop_) {
+        break;
+      }
+      updates.swap(updates_);
+    }
+
+    for (auto it = updates.begin(); it != updates.end(); ++it) {
+      err = ApplyUpdate(redis, {it->second, it->first});
+      if (err) {  // retry not applied after reconnect, unless device changed state since
+        std::unique_lock<std::mutex> lock(updates_mutex_);
+        updates_.insert(it, updates.end());
+        break;
+      }
+    }
+
+    if (err) {
+      break;
+    }
+  }
+
+  if (!err) {
+    for (const device_key_t& key : local_devices_) {  // graceful shutdown, others should not wait lease
+      ignore_result(Release(redis, key));
+      PublishChange(redis, false, key);
+    }
+    local_devices_.clear();
+  }
+  redisFree(redis);
+  return err;
+}
+
+common::Error RedisDevicesRegistry::ApplyUpdate(redisContext* redis, const Update& update) {
+  if (update.connected) {
+    std::string owner;
+    common::Error err = Claim(redis, update.key, &owner);
+    if (err) {
+      if (redis->err) {  // connection lost
+        return err;
+      }
+      WARNING_LOG() << "REDIS DEVICES REGISTRY CLAIM ERROR: " << err->GetDescription();
+      return common::Error();
+    }
+
+    if (!owner.empty()) {
+      if (observer_) {
+        observer_->HandleDeviceOwnedByOtherNode(update.key.first, update.key.second, owner);
+      }
+      return common::Error();
+    }
+
+    local_devices_.insert(update.key);
+    SetCachedNode(update.key, node_id_, current_sec() + lease_ttl_sec);
+    PublishChange(redis, true, update.key);
+    return common::Error();
+  }
+
+  if (local_devices_.count(update.key) == 0) {  // was rejected
+    return common::Error();
+  }
+
+  common::Error err = Release(redis, update.key);
+  if (err) {
+    if (redis->err) {
+      return err;
+    }
+    WARNING_LOG() << "REDIS DEVICES REGISTRY RELEASE ERROR: " << err->GetDescription();
+  }
+  local_devices_.erase(update.key);
+  RemoveCachedNode(update.key, node_id_);
+  PublishChange(redis, false, update.key);
+  return common::Error();
+}
+
+void RedisDevicesRegistry::Stop() {
+  std::unique_lock<std::mutex> lock(updates_mutex_);
+  stop_ = true;
+  updates_cond_.notify_one();
+}
+
+void RedisDevicesRegistry::Register(const user_id_t& uid, const device_id_t& dev) {
+  PushUpdate({true, device_key_t(uid, dev)});
+}
+
+void RedisDevicesRegistry::UnRegister(const user_id_t& uid, const device_id_t& dev) {
+  PushUpdate({false, device_key_t(uid, dev)});
+}
+
+void RedisDevicesRegistry::PushUpdate(const Update& update) {
+  std::unique_lock<std::mutex> lock(updates_mutex_);
+  if (stop_) {  // writer thread exited
+    return;
+  }
+
+  updates_[update.key] = update.connected;  // reconnect after disconnect or vice versa, last one wins
+  updates_cond_.notify_one();
+}
+
+size_t RedisDevicesRegistry::GetPendingUpdatesCount() const {
+  std::unique_lock<std::mutex> lock(updates_mutex_);
+  return updates_.size();
+}
+
+bool RedisDevicesRegistry::FindNode(const user_id_t& uid, const device_id_t& dev, std::string* node) const {
+  return FindNode(uid, dev, current_sec(), node);
+}
+
+bool RedisDevicesRegistry::FindNode(const user_id_t& uid,
+                                    const device_id_t& dev,
+                                    common::time64_t now,
+                                    std::string* node) const {
+  if (!node) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  auto it = cache_.find(make_device_field(uid, dev));
+  if (it == cache_.end()) {
+    return false;
+  }
+
+  common::time64_t lease_expire = it->second.lease_expire;
+  auto heartbeat = nodes_heartbeats_.find(it->second.node);
+  if (heartbeat != nodes_heartbeats_.end()) {
+    lease_expire = std::max(lease_expire, heartbeat->second);
+  }
+
+  if (lease_expire <= now) {  // owner crashed without release
+    return false;
+  }
+
+  *node = it->second.node;
+  return true;
+}
+
+void RedisDevicesRegistry::ApplyChange(const std::string& change) {
+  // [+|-] node uid dev
+  // ~ node lease_expire
+  if (!change.empty() && change[0] == CHANGE_HEARTBEAT) {
+    size_t pos = change.find(' ', 2);
+    if (change.size() < 3 || change[1] != ' ' || pos == std::string::npos) {
+      WARNING_LOG() << "Invalid devices registry change: " << change;
+      return;
+    }
+
+    const std::string node = change.substr(2, pos - 2);
+    if (node != node_id_) {
+      ExtendNodeLease(node, strtoll(change.c_str() + pos + 1, nullptr, 10));
+    }
+    return;
+  }
+
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (parts.size() < 3) {
+    size_t pos = change.find(' ', start);
+    if (pos == std::string::npos) {
+      break;
+    }
+    parts.push_back(change.substr(start, pos - start));
+    start = pos + 1;
+  }
+
+  if (parts.size() != 3 || parts[0].size() != 1) {
+    WARNING_LOG() << "Invalid devices registry change: " << change;
+    return;
+  }
+
+  const std::string& node = parts[1];
+  if (node == node_id_) {  // our own change, already in cache
+    return;
+  }
+
+  const device_key_t key(parts[2], change.substr(start));
+  if (parts[0][0] == CHANGE_CONNECTED) {
+    SetCachedNode(key, node, current_sec() + lease_ttl_sec);
+  } else if (parts[0][0] == CHANGE_DISCONNECTED) {
+    RemoveCachedNode(key, node);
+  }
+}
+
+common::Error RedisDevicesRegistry::LoadAll(redisContext* redis) {
+  redisReply* reply =
+      reinterpret_cast<redisReply*>(redisCommand(redis, "HGETALL %s", config_.devices_registry.c_str()));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type != REDIS_REPLY_ARRAY) {
+    freeReplyObject(reply);
+    return common::make_error("Invalid devices registry reply");
+  }
+
+  const common::time64_t now = current_sec();
+  std::unordered_map<std::string, CachedNode> cache;
+  for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+    const std::string field(reply->element[i]->str, reply->element[i]->len);
+    const std::string value(reply->element[i + 1]->str, reply->element[i + 1]->len);
+    size_t sep = value.find_last_of(LEASE_SEPARATOR);
+    if (sep == std::string::npos) {
+      continue;
+    }
+
+    const common::time64_t expire = strtoll(value.c_str() + sep + 1, nullptr, 10);
+    if (expire <= now) {  // dead node
+      continue;
+    }
+
+    cache[field] = {value.substr(0, sep), expire};
+  }
+  freeReplyObject(reply);
+
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  cache_.swap(cache);
+  return common::Error();
+}
+
+common::Error RedisDevicesRegistry::Claim(redisContext* redis, const device_key_t& key, std::string* owner) {
+  const std::string field = make_device_field(key.first, key.second);
+  const common::time64_t now = current_sec();
+  redisReply* reply = reinterpret_cast<redisReply*>(
+      redisCommand(redis, "EVAL %s 1 %s %s %s %lld %lld", CLAIM_SCRIPT, config_.devices_registry.c_str(),
+                   field.c_str(), node_id_.c_str(), static_cast<long long>(now),
+                   static_cast<long long>(now + lease_ttl_sec)));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {
+    common::Error err = common::make_error(reply->str);
+    freeReplyObject(reply);
+    return err;
+  }
+
+  if (reply->type == REDIS_REPLY_STRING) {
+    *owner = std::string(reply->str, reply->len);
+  }
+  freeReplyObject(reply);
+  return common::Error();
+}
+
+common::Error RedisDevicesRegistry::Release(redisContext* redis, const device_key_t& key) {
+  const std::string field = make_device_field(key.first, key.second);
+  redisReply* reply = reinterpret_cast<redisReply*>(redisCommand(
+      redis, "EVAL %s 1 %s %s %s", RELEASE_SCRIPT, config_.devices_registry.c_str(), field.c_str(), node_id_.c_str()));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  freeReplyObject(reply);
+  return common::Error();
+}
+
+common::Error RedisDevicesRegistry::RefreshLeases(redisContext* redis) {
+  if (local_devices_.empty()) {
+    return common::Error();
+  }
+
+  const common::time64_t lease_expire = current_sec() + lease_ttl_sec;
+  const std::string lease_expire_str = common::ConvertToString(static_cast<long long>(lease_expire));
+  std::vector<device_key_t> lost;
+  std::vector<device_key_t> batch;
+  for (const device_key_t& key : local_devices_) {
+    batch.push_back(key);
+    if (batch.size() == refresh_batch_size) {
+      common::Error err = RefreshLeasesBatch(redis, batch, lease_expire_str, &lost);
+      if (err) {
+        return err;
+      }
+      batch.clear();
+    }
+  }
+
+  if (!batch.empty()) {
+    common::Error err = RefreshLeasesBatch(redis, batch, lease_expire_str, &lost);
+    if (err) {
+      return err;
+    }
+  }
+
+  for (const device_key_t& key : lost) {  // observer closes connection, UnRegister skipped as rejected
+    local_devices_.erase(key);
+  }
+
+  ExtendNodeLease(node_id_, lease_expire);
+  PublishHeartbeat(redis, lease_expire);
+  return common::Error();
+}
+
+common::Error RedisDevicesRegistry::RefreshLeasesBatch(redisContext* redis,
+                                                       const std::vector<device_key_t>& keys,
+                                                       const std::string& lease_expire,
+                                                       std::vector<device_key_t>* lost) {
+  const std::string now = common::ConvertToString(static_cast<long long>(current_sec()));
+  std::vector<std::string> fields;
+  fields.reserve(keys.size());
+  for (const device_key_t& key : keys) {
+    fields.push_back(make_device_field(key.first, key.second));
+  }
+
+  std::vector<const char*> argv = {"EVAL", REFRESH_SCRIPT, "1", config_.devices_registry.c_str(), node_id_.c_str(),
+                                   lease_expire.c_str(), now.c_str()};
+  std::vector<size_t> argvlen = {4,
+                                 sizeof(REFRESH_SCRIPT) - 1,
+                                 1,
+                                 config_.devices_registry.size(),
+                                 node_id_.size(),
+                                 lease_expire.size(),
+                                 now.size()};
+  for (const std::string& field : fields) {
+    argv.push_back(field.c_str());
+    argvlen.push_back(field.size());
+  }
+
+  redisReply* reply = reinterpret_cast<redisReply*>(
+      redisCommandArgv(redis, static_cast<int>(argv.size()), argv.data(), argvlen.data()));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type != REDIS_REPLY_ARRAY) {
+    common::Error err = common::make_error(reply->type == REDIS_REPLY_ERROR ? reply->str : "Invalid refresh reply");
+    freeReplyObject(reply);
+    return err;
+  }
+
+  for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+    redisReply* index = reply->element[i];
+    redisReply* owner = reply->element[i + 1];
+    if (index->type != REDIS_REPLY_INTEGER || index->integer < 0 ||
+        static_cast<size_t>(index->integer) >= keys.size() || owner->type != REDIS_REPLY_STRING) {
+      continue;
+    }
+
+    const device_key_t& key = keys[index->integer];
+    WARNING_LOG() << "Devices registry lease lost, device: " << key.second << " claimed by node: "
+                  << std::string(owner->str, owner->len);
+    lost->push_back(key);
+    RemoveCachedNode(key, node_id_);
+    if (observer_) {
+      observer_->HandleDeviceOwnedByOtherNode(key.first, key.second, std::string(owner->str, owner->len));
+    }
+  }
+
+  freeReplyObject(reply);
+  return common::Error();
+}
+
+void RedisDevicesRegistry::PublishChange(redisContext* redis, bool connected, const device_key_t& key) {
+  const char change = connected ? CHANGE_CONNECTED : CHANGE_DISCONNECTED;
+  const std::string msg = std::string(1, change) + ' ' + node_id_ + ' ' + key.first + ' ' + key.second;
+  void* reply = redisCommand(redis, "PUBLISH %s %s", config_.channel_devices_registry.c_str(), msg.c_str());
+  if (!reply) {
+    WARNING_LOG() << "Publish message: " << msg << " to devices registry channel failed.";
+    return;
+  }
+  freeReplyObject(reply);
+}
+
+void RedisDevicesRegistry::PublishHeartbeat(redisContext* redis, common::time64_t lease_expire) {
+  const std::string msg = std::string(1, CHANGE_HEARTBEAT) + ' ' + node_id_ + ' ' +
+                          common::ConvertToString(static_cast<long long>(lease_expire));
+  void* reply = redisCommand(redis, "PUBLISH %s %s", config_.channel_devices_registry.c_str(), msg.c_str());
+  if (!reply) {
+    WARNING_LOG() << "Publish message: " << msg << " to devices registry channel failed.";
+    return;
+  }
+  freeReplyObject(reply);
+}
+
+void RedisDevicesRegistry::SetCachedNode(const device_key_t& key,
+                                         const std::string& node,
+                                         common::time64_t lease_expire) {
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  cache_[make_device_field(key.first, key.second)] = {node, lease_expire};
+}
+
+void RedisDevicesRegistry::RemoveCachedNode(const device_key_t& key, const std::string& node) {
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  auto it = cache_.find(make_device_field(key.first, key.second));
+  if (it != cache_.end() && it->second.node == node) {
+    cache_.erase(it);
+  }
+}
+
+void RedisDevicesRegistry::ExtendNodeLease(const std::string& node, common::time64_t lease_expire) {
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  common::time64_t& heartbeat = nodes_heartbeats_[node];
+  heartbeat = std::max(heartbeat, lease_expire);
+}
+
+void RedisDevicesRegistry::PruneCache(common::time64_t now) {
+  std::unique_lock<std::mutex> lock(cache_mutex_);
+  for (auto it = cache_.begin(); it != cache_.end();) {
+    auto heartbeat = nodes_heartbeats_.find(it->second.node);
+    const common::time64_t lease_expire = heartbeat == nodes_heartbeats_.end()
+                                              ? it->second.lease_expire
+                                              : std::max(it->second.lease_expire, heartbeat->second);
+    if (lease_expire <= now) {
+      it = cache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (auto it = nodes_heartbeats_.begin(); it != nodes_heartbeats_.end();) {
+    if (it->second <= now) {
+      it = nodes_heartbeats_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,124 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/error.h>
+#include <common/types.h>  // for time64_t
+
+#include "server/redis/redis_connect.h"  // for ReconnectBackoff
+#include "server/redis/redis_sub_config.h"
+#include "server/user_info.h"  // for user_id_t
+
+struct redisContext;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+class RedisDevicesRegistryObserver {
+ public:
+  virtual void HandleDeviceOwnedByOtherNode(const user_id_t& uid, const device_id_t& dev, const std::string& node) = 0;
+  virtual ~RedisDevicesRegistryObserver();
+};
+
+// (uid, device) -> node hash with leases, writes done in own thread
+// lookups served from local cache updated by changes channel, entries of silent nodes expire with their leases
+class RedisDevicesRegistry {
+ public:
+  enum { lease_ttl_sec = 60, refresh_interval_sec = 20, refresh_batch_size = 512 };
+  typedef std::pair<user_id_t, device_id_t> device_key_t;
+
+  explicit RedisDevicesRegistry(RedisDevicesRegistryObserver* observer);
+
+  void SetConfig(const RedisSubConfig& config, const std::string& node_id);
+  std::string GetNodeId() const;
+
+  void Listen();  // writer thread, reconnects with backoff until Stop
+  void Stop();
+
+  // thread safe, async
+  void Register(const user_id_t& uid, const device_id_t& dev);
+  void UnRegister(const user_id_t& uid, const device_id_t& dev);
+  size_t GetPendingUpdatesCount() const;  // one per device, only latest state applied
+
+  // thread safe, without redis requests
+  bool FindNode(const user_id_t& uid, const device_id_t& dev, std::string* node) const;
+  bool FindNode(const user_id_t& uid, const device_id_t& dev, common::time64_t now, std::string* node) const;
+  void ApplyChange(const std::string& change);  // from changes channel
+
+ private:
+  struct Update {
+    bool connected;
+    device_key_t key;
+  };
+  typedef std::map<device_key_t, bool> updates_t;  // device -> latest connected state
+
+  struct CachedNode {
+    std::string node;
+    common::time64_t lease_expire;  // sec
+  };
+
+  common::Error Serve(ReconnectBackoff* backoff) WARN_UNUSED_RESULT;  // one connection, until error or stop
+  common::Error ApplyUpdate(redisContext* redis, const Update& update) WARN_UNUSED_RESULT;  // error if disconnected
+  void PushUpdate(const Update& update);
+  common::Error LoadAll(redisContext* redis) WARN_UNUSED_RESULT;
+  common::Error Claim(redisContext* redis, const device_key_t& key, std::string* owner) WARN_UNUSED_RESULT;
+  common::Error Release(redisContext* redis, const device_key_t& key) WARN_UNUSED_RESULT;
+  common::Error RefreshLeases(redisContext* redis) WARN_UNUSED_RESULT;
+  common::Error RefreshLeasesBatch(redisContext* redis,
+                                   const std::vector<device_key_t>& keys,
+                                   const std::string& lease_expire,
+                                   std::vector<device_key_t>* lost) WARN_UNUSED_RESULT;
+  void PublishChange(redisContext* redis, bool connected, const device_key_t& key);
+  void PublishHeartbeat(redisContext* redis, common::time64_t lease_expire);
+
+  void SetCachedNode(const device_key_t& key, const std::string& node, common::time64_t lease_expire);
+  void RemoveCachedNode(const device_key_t& key, const std::string& node);
+  void ExtendNodeLease(const std::string& node, common::time64_t lease_expire);
+  void PruneCache(common::time64_t now);
+
+  RedisDevicesRegistryObserver* const observer_;
+  RedisSubConfig config_;
+  std::string node_id_;
+
+  mutable std::mutex updates_mutex_;
+  std::condition_variable updates_cond_;
+  updates_t updates_;  // coalesced, bounded by devices count even during long redis outage
+  std::atomic<bool> stop_;
+
+  std::set<device_key_t> local_devices_;  // writer thread only
+
+  mutable std::mutex cache_mutex_;
+  std::unordered_map<std::string, CachedNode> cache_;                  // field -> node
+  std::unordered_map<std::string, common::time64_t> nodes_heartbeats_;  // node -> lease expire of all its devices
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
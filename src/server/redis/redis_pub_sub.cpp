@@ -19,22 +19,34 @@
 #include "server/redis/redis_pub_sub.h"
 
 #include <string>
+#include <vector>
 
 #include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
 
 #include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
 #include <common/utils.h>
 
+#include "probes.h"  // for FASTOTV_PROBE2
+
+#include "server/metrics/metrics.h"         // for ScopedLatency
+#include "server/metrics/request_tracer.h"  // for ScopedSpan
 #include "server/redis/redis_connect.h"
 
+#define REDIS_CALL_DURATION_METRIC "fastotv_redis_call_duration_seconds"
+
 namespace fastotv {
 namespace server {
 namespace redis {
 
-RedisPubSub::RedisPubSub(RedisSubHandler* handler) : handler_(handler), stop_(false) {}
+RedisPubSub::RedisPubSub(RedisSubHandler* handler) : handler_(handler), config_(), channels_(), stop_(false) {}
 
 void RedisPubSub::SetConfig(const RedisSubConfig& config) {
   config_ = config;
+  channels_ = {config.channel_in};
+}
+
+void RedisPubSub::SetChannels(const std::vector<std::string>& channels) {
+  channels_ = channels;
 }
 
 void RedisPubSub::Listen() {
@@ -45,9 +57,19 @@ void RedisPubSub::Listen() {
     return;
   }
 
-  const char* channel_str = config_.channel_in.c_str();
+  if (channels_.empty()) {
+    redisFree(redis_sub);
+    return;
+  }
+
+  std::vector<const char*> argv = {"SUBSCRIBE"};
+  std::vector<size_t> argvlen = {9};
+  for (const std::string& channel : channels_) {
+    argv.push_back(channel.c_str());
+    argvlen.push_back(channel.size());
+  }
 
-  void* reply = redisCommand(redis_sub, "SUBSCRIBE %s", channel_str);
+  void* reply = redisCommandArgv(redis_sub, static_cast<int>(argv.size()), argv.data(), argvlen.data());
   if (!reply) {
     redisFree(redis_sub);
     return;
@@ -68,7 +90,8 @@ void RedisPubSub::Listen() {
     bool is_error_reply = lreply->type != REDIS_REPLY_ARRAY || lreply->elements != 3 ||
                           lreply->element[1]->type != REDIS_REPLY_STRING ||
                           lreply->element[2]->type != REDIS_REPLY_STRING;
-    if (is_error_reply) {
+    if (is_error_reply) {  // subscribe confirmations
+      freeReplyObject(lreply);
       continue;
     }
 
@@ -100,11 +123,16 @@ common::Error RedisPubSub::PublishToChannelOut(const std::string& msg) {
   return Publish(config_.channel_out, msg);
 }
 
-common::Error RedisPubSub::Publish(const std::string& channel, const std::string& msg) {
+common::Error RedisPubSub::Publish(const std::string& channel, const std::string& msg, size_t* receivers) {
   if (channel.empty() || msg.empty()) {
     return common::make_error_inval();
   }
 
+  static metrics::Histogram* duration = metrics::Registry::GetInstance()->GetHistogram(
+      REDIS_CALL_DURATION_METRIC, "Redis call time, with connect.", {{"call", "publish"}});
+  metrics::ScopedLatency latency(duration);
+  metrics::ScopedSpan span("redis", "publish");
+
   redisContext* redis_sub = nullptr;
   common::Error err = redis_connect(config_, &redis_sub);
   if (err) {
@@ -117,13 +145,19 @@ common::Error RedisPubSub::Publish(const std::string& channel, const std::string
 
   const char* chn = channel.c_str();
   const char* m = msg.c_str();
-  void* rreply = redisCommand(redis_sub, "PUBLISH %s %s", chn, m);
+  FASTOTV_PROBE2(redis_request_start, "publish", chn);
+  redisReply* rreply = reinterpret_cast<redisReply*>(redisCommand(redis_sub, "PUBLISH %s %s", chn, m));
+  FASTOTV_PROBE2(redis_request_done, "publish", rreply ? rreply->type : -1);
   if (!rreply) {
     err = common::make_error(redis_sub->errstr);
     redisFree(redis_sub);
     return err;
   }
 
+  if (receivers) {
+    *receivers = rreply->type == REDIS_REPLY_INTEGER ? static_cast<size_t>(rreply->integer) : 0;
+  }
+
   freeReplyObject(rreply);
   redisFree(redis_sub);
   return common::Error();
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <common/error.h>
 
 #include "server/redis/redis_pub_sub_handler.h"
@@ -32,16 +35,20 @@ class RedisPubSub {
   explicit RedisPubSub(RedisSubHandler* handler);
 
   void SetConfig(const RedisSubConfig& config);
+  void SetChannels(const std::vector<std::string>& channels);  // by default only channel in
   void Listen();
   void Stop();
 
   common::Error PublishStateToChannel(const std::string& msg) WARN_UNUSED_RESULT;
   common::Error PublishToChannelOut(const std::string& msg) WARN_UNUSED_RESULT;
-  common::Error Publish(const std::string& channel, const std::string& msg) WARN_UNUSED_RESULT;
+  common::Error Publish(const std::string& channel,
+                        const std::string& msg,
+                        size_t* receivers = nullptr) WARN_UNUSED_RESULT;
 
  private:
   RedisSubHandler* const handler_;
   RedisSubConfig config_;
+  std::vector<std::string> channels_;
   bool stop_;
 };
 
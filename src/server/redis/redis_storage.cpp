@@ -27,15 +27,19 @@
 #include <common/utils.h>
 
 #include "commands_info/auth_info.h"  // for AuthInfo
+#include "probes.h"                   // for FASTOTV_PROBE2
 
 #include <json-c/json_object.h>   // for json_object_put
 #include <json-c/json_tokener.h>  // for json_tokener_parse
 
+#include "server/metrics/metrics.h"         // for ScopedLatency
+#include "server/metrics/request_tracer.h"  // for ScopedSpan
 #include "server/redis/redis_connect.h"
 
 #define GET_USER_1E "GET %s"
 #define GET_CHAT_CHANNELS "GET chat_channels"
 #define ID_FIELD "id"
+#define REDIS_CALL_DURATION_METRIC "fastotv_redis_call_duration_seconds"
 
 namespace fastotv {
 namespace server {
@@ -114,6 +118,11 @@ common::Error RedisStorage::FindUser(const AuthInfo& user, user_id_t* uid, UserI
     return common::make_error_inval();
   }
 
+  static metrics::Histogram* duration = metrics::Registry::GetInstance()->GetHistogram(
+      REDIS_CALL_DURATION_METRIC, "Redis call time, with connect.", {{"call", "find_user"}});
+  metrics::ScopedLatency latency(duration);
+  metrics::ScopedSpan span("redis", "find_user");
+
   redisContext* redis = nullptr;
   common::Error err = redis_connect(config_, &redis);
   if (err) {
@@ -122,7 +131,9 @@ common::Error RedisStorage::FindUser(const AuthInfo& user, user_id_t* uid, UserI
 
   std::string login = user.GetLogin();
   const char* login_str = login.c_str();
+  FASTOTV_PROBE2(redis_request_start, "find_user", login_str);
   redisReply* reply = reinterpret_cast<redisReply*>(redisCommand(redis, GET_USER_1E, login_str));
+  FASTOTV_PROBE2(redis_request_done, "find_user", reply ? reply->type : -1);
   if (!reply) {
     redisFree(redis);
     return common::make_error("User not found");
@@ -157,13 +168,20 @@ common::Error RedisStorage::GetChatChannels(std::vector<stream_id>* channels) co
     return common::make_error_inval();
   }
 
+  static metrics::Histogram* duration = metrics::Registry::GetInstance()->GetHistogram(
+      REDIS_CALL_DURATION_METRIC, "Redis call time, with connect.", {{"call", "get_chat_channels"}});
+  metrics::ScopedLatency latency(duration);
+  metrics::ScopedSpan span("redis", "get_chat_channels");
+
   redisContext* redis = nullptr;
   common::Error err = redis_connect(config_, &redis);
   if (err) {
     return err;
   }
 
+  FASTOTV_PROBE2(redis_request_start, "get_chat_channels", "chat_channels");
   redisReply* reply = reinterpret_cast<redisReply*>(redisCommand(redis, GET_CHAT_CHANNELS));
+  FASTOTV_PROBE2(redis_request_done, "get_chat_channels", reply ? reply->type : -1);
   if (!reply) {
     redisFree(redis);
     return common::make_error("User not found");
@@ -0,0 +1,297 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_stream_consumer.h"
+
+#include <string.h>  // for strcmp, strncmp
+
+#include <chrono>  // for milliseconds
+#include <string>
+#include <thread>  // for sleep_for
+#include <vector>
+
+#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
+
+#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+
+#include "server/redis/redis_connect.h"
+
+#define STREAM_MESSAGE_FIELD "msg"
+#define STREAM_NEW_ENTRIES_ID ">"
+#define STREAM_PENDING_ENTRIES_ID "0"
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+namespace {
+
+const char* find_message_field(redisReply* fields, size_t* len) {
+  if (!fields || fields->type != REDIS_REPLY_ARRAY) {  // nil for deleted pending entries
+    return nullptr;
+  }
+
+  for (size_t i = 0; i + 1 < fields->elements; i += 2) {
+    redisReply* name = fields->element[i];
+    redisReply* value = fields->element[i + 1];
+    if (name->type == REDIS_REPLY_STRING && value->type == REDIS_REPLY_STRING &&
+        strcmp(name->str, STREAM_MESSAGE_FIELD) == 0) {
+      *len = value->len;
+      return value->str;
+    }
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
+RedisStreamHandler::~RedisStreamHandler() {}
+
+RedisStreamConsumer::RedisStreamConsumer(RedisStreamHandler* handler)
+    : handler_(handler),
+      config_(),
+      acks_(acks_queue_size),
+      acks_batch_(),
+      delivered_id_(),
+      handler_busy_(false),
+      stop_(false) {}
+
+void RedisStreamConsumer::SetConfig(const RedisSubConfig& config) {
+  config_ = config;
+}
+
+void RedisStreamConsumer::Listen() {
+  ReconnectBackoff backoff;
+  while (!stop_) {
+    common::Error err = Consume(&backoff);
+    if (stop_) {
+      break;
+    }
+
+    WARNING_LOG() << "REDIS STREAM ERROR: " << (err ? err->GetDescription() : "disconnected") << ", reconnect in "
+                  << backoff.GetDelay() << " msec";
+    backoff.Wait(stop_);
+  }
+}
+
+common::Error RedisStreamConsumer::Consume(ReconnectBackoff* backoff) {
+  redisContext* redis = nullptr;
+  common::Error err = redis_connect(config_, &redis);
+  if (err) {
+    return err;
+  }
+
+  err = CreateGroup(redis);  // stream could be deleted while we were away
+  if (err) {
+    redisFree(redis);
+    return err;
+  }
+
+  backoff->Reset();
+  // at first handle entries delivered to us before (re)connect, after that only new
+  std::string last_id = STREAM_PENDING_ENTRIES_ID;
+  delivered_id_.clear();
+  while (!stop_) {
+    err = FlushAcks(redis);
+    if (err) {
+      break;
+    }
+
+    err = ReadEntries(redis, &last_id);
+    if (err) {
+      break;
+    }
+
+    if (IsHandlerBusy()) {  // don't read more than handler can take, acks still flushed
+      std::this_thread::sleep_for(std::chrono::milliseconds(busy_pause_msec));
+    }
+  }
+
+  if (!err) {
+    err = FlushAcks(redis);
+  }
+  redisFree(redis);
+  return err;
+}
+
+void RedisStreamConsumer::Stop() {
+  stop_ = true;
+}
+
+bool RedisStreamConsumer::Ack(const std::string& entry_id) {
+  return acks_.Push(entry_id);
+}
+
+common::Error RedisStreamConsumer::AppendToStreamOut(const std::string& msg) {
+  if (config_.stream_out.empty() || msg.empty()) {
+    return common::make_error_inval();
+  }
+
+  redisContext* redis = nullptr;
+  common::Error err = redis_connect(config_, &redis);
+  if (err) {
+    return err;
+  }
+
+  const char* stream = config_.stream_out.c_str();
+  const char* m = msg.c_str();
+  void* rreply = redisCommand(redis, "XADD %s MAXLEN ~ %d * " STREAM_MESSAGE_FIELD " %s", stream,
+                              static_cast<int>(stream_out_max_len), m);
+  if (!rreply) {
+    err = common::make_error(redis->errstr);
+    redisFree(redis);
+    return err;
+  }
+
+  freeReplyObject(rreply);
+  redisFree(redis);
+  return common::Error();
+}
+
+common::Error RedisStreamConsumer::CreateGroup(redisContext* redis) const {
+  const char* stream = config_.stream_in.c_str();
+  const char* group = config_.stream_group.c_str();
+  redisReply* reply =
+      reinterpret_cast<redisReply*>(redisCommand(redis, "XGROUP CREATE %s %s $ MKSTREAM", stream, group));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR && strncmp(reply->str, "BUSYGROUP", 9) != 0) {  // group exists is ok
+    common::Error err = common::make_error(reply->str);
+    freeReplyObject(reply);
+    return err;
+  }
+
+  freeReplyObject(reply);
+  return common::Error();
+}
+
+common::Error RedisStreamConsumer::ReadEntries(redisContext* redis, std::string* last_id) {
+  const char* group = config_.stream_group.c_str();
+  const char* consumer = config_.stream_consumer.c_str();
+  const char* stream = config_.stream_in.c_str();
+  const char* id = last_id->c_str();
+  redisReply* reply = reinterpret_cast<redisReply*>(
+      redisCommand(redis, "XREADGROUP GROUP %s %s COUNT %d BLOCK %d STREAMS %s %s", group, consumer,
+                   static_cast<int>(read_batch_size), static_cast<int>(read_block_msec), stream, id));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {  // NOGROUP if stream was deleted
+    common::Error err = common::make_error(reply->str);
+    freeReplyObject(reply);
+    return err;
+  }
+
+  HandleReply(reply, last_id);
+  freeReplyObject(reply);
+  return common::Error();
+}
+
+size_t RedisStreamConsumer::HandleReply(redisReply* reply, std::string* last_id) {
+  size_t count = 0;
+  handler_busy_ = false;
+  // [[stream, [[id, [field, value, ...]], ...]]], nil when block timeout
+  if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 1) {
+    redisReply* lstream = reply->element[0];
+    if (lstream->type == REDIS_REPLY_ARRAY && lstream->elements == 2) {
+      const std::string stream_name(lstream->element[0]->str, lstream->element[0]->len);
+      redisReply* entries = lstream->element[1];
+      for (size_t i = 0; i < entries->elements; ++i) {
+        redisReply* entry = entries->element[i];
+        if (entry->type != REDIS_REPLY_ARRAY || entry->elements != 2) {
+          continue;
+        }
+
+        const std::string entry_id(entry->element[0]->str, entry->element[0]->len);
+        size_t msg_len = 0;
+        const char* msg = find_message_field(entry->element[1], &msg_len);
+        if (!msg) {  // nothing to handle
+          Ack(entry_id);
+        } else if (handler_ && !handler_->HandleStreamEntry(stream_name, entry_id, std::string(msg, msg_len))) {
+          // this and next entries already delivered to us, read them again from pending list
+          if (*last_id == STREAM_NEW_ENTRIES_ID) {
+            *last_id = delivered_id_.empty() ? STREAM_PENDING_ENTRIES_ID : delivered_id_;
+          }
+          handler_busy_ = true;
+          return count;
+        }
+
+        delivered_id_ = entry_id;
+        if (*last_id != STREAM_NEW_ENTRIES_ID) {
+          *last_id = entry_id;
+        }
+        count++;
+      }
+    }
+  }
+
+  if (count == 0 && *last_id != STREAM_NEW_ENTRIES_ID) {  // own pending entries handled
+    *last_id = STREAM_NEW_ENTRIES_ID;
+  }
+  return count;
+}
+
+bool RedisStreamConsumer::IsHandlerBusy() const {
+  return handler_busy_;
+}
+
+const std::vector<std::string>& RedisStreamConsumer::PrepareAcks() {
+  std::string id;
+  while (acks_batch_.size() < ack_batch_size && acks_.Pop(&id)) {
+    acks_batch_.push_back(id);
+  }
+  return acks_batch_;
+}
+
+common::Error RedisStreamConsumer::FlushAcks(redisContext* redis) {
+  const std::vector<std::string>& ids = PrepareAcks();
+  if (ids.empty()) {
+    return common::Error();
+  }
+
+  std::vector<const char*> argv = {"XACK", config_.stream_in.c_str(), config_.stream_group.c_str()};
+  std::vector<size_t> argvlen = {4, config_.stream_in.size(), config_.stream_group.size()};
+  for (size_t i = 0; i < ids.size(); ++i) {
+    argv.push_back(ids[i].c_str());
+    argvlen.push_back(ids[i].size());
+  }
+
+  redisReply* reply = reinterpret_cast<redisReply*>(
+      redisCommandArgv(redis, static_cast<int>(argv.size()), argv.data(), argvlen.data()));
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {
+    common::Error err = common::make_error(reply->str);
+    freeReplyObject(reply);
+    return err;
+  }
+
+  freeReplyObject(reply);
+  acks_batch_.clear();
+  return common::Error();
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
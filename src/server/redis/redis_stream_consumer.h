@@ -0,0 +1,90 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <common/error.h>
+
+#include "server/bounded_mpsc_queue.h"
+#include "server/redis/redis_connect.h"  // for ReconnectBackoff
+#include "server/redis/redis_sub_config.h"
+
+struct redisContext;
+struct redisReply;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+class RedisStreamHandler {
+ public:
+  // false if entry can't be taken now, it stays pending and will be read again
+  virtual bool HandleStreamEntry(const std::string& stream, const std::string& entry_id, const std::string& msg) = 0;
+  virtual ~RedisStreamHandler();
+};
+
+// XREADGROUP based reader, entries stay pending until Ack
+// reconnects with backoff, after every connect replays own pending entries first
+// pauses reading while handler is busy, refused entries replayed from pending list
+class RedisStreamConsumer {
+ public:
+  enum {
+    read_batch_size = 128,
+    read_block_msec = 1000,
+    busy_pause_msec = 100,
+    acks_queue_size = 8192,
+    ack_batch_size = 512,
+    stream_out_max_len = 100000
+  };
+
+  explicit RedisStreamConsumer(RedisStreamHandler* handler);
+
+  void SetConfig(const RedisSubConfig& config);
+  void Listen();  // blocks until Stop
+  void Stop();
+
+  bool Ack(const std::string& entry_id);  // thread safe, acks sent in batch before next read
+  common::Error AppendToStreamOut(const std::string& msg) WARN_UNUSED_RESULT;
+
+  // listen thread only
+  size_t HandleReply(redisReply* reply, std::string* last_id);  // XREADGROUP reply, switches to new entries
+  bool IsHandlerBusy() const;                                   // last reply stopped at refused entry
+  const std::vector<std::string>& PrepareAcks();                // next XACK batch, kept until sent
+
+ private:
+  common::Error Consume(ReconnectBackoff* backoff) WARN_UNUSED_RESULT;  // one connection, until error or stop
+  common::Error CreateGroup(redisContext* redis) const WARN_UNUSED_RESULT;
+  common::Error ReadEntries(redisContext* redis, std::string* last_id) WARN_UNUSED_RESULT;
+  common::Error FlushAcks(redisContext* redis) WARN_UNUSED_RESULT;
+
+  RedisStreamHandler* const handler_;
+  RedisSubConfig config_;
+  BoundedMPSCQueue<std::string> acks_;
+  std::vector<std::string> acks_batch_;
+  std::string delivered_id_;  // last entry taken by handler
+  bool handler_busy_;
+  std::atomic<bool> stop_;
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -30,6 +30,18 @@ struct RedisSubConfig : public RedisConfig {
   std::string channel_in;
   std::string channel_out;
   std::string channel_clients_state;
+
+  bool use_streams;  // external commands via consumer group instead of pub/sub
+  std::string stream_in;
+  std::string stream_out;
+  std::string stream_group;
+  std::string stream_consumer;  // should be stable between restarts
+
+  std::string devices_registry;          // hash (uid:device) -> node|lease_expire
+  std::string channel_devices_registry;  // registry changes
+  std::string channel_node_prefix;       // commands forwarded to node, prefix + node_id
+  std::string channel_chat_prefix;       // chat and presence fan-out, prefix + stream_id
+  std::string watchers_prefix;           // cluster watchers counters keys
 };
 }  // namespace redis
 }  // namespace server
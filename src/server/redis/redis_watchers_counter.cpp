@@ -0,0 +1,309 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_watchers_counter.h"
+
+#include <stdlib.h>  // for strtoull
+
+#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
+
+#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+#include <common/time.h>    // for current_utc_mstime
+
+#include "server/redis/redis_connect.h"
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+namespace {
+
+long long current_sec() {
+  return common::time::current_utc_mstime() / 1000;
+}
+
+}  // namespace
+
+RedisWatchersCounter::StreamStat::StreamStat() : watchers(0), unique_viewers(0) {}
+
+RedisWatchersCounter::RedisWatchersCounter()
+    : config_(),
+      node_id_(),
+      mutex_(),
+      stop_cond_(),
+      stop_(false),
+      local_(),
+      pending_uniques_(),
+      snapshot_mutex_(),
+      snapshot_() {}
+
+void RedisWatchersCounter::SetConfig(const RedisSubConfig& config, const std::string& node_id) {
+  config_ = config;
+  node_id_ = node_id;
+}
+
+void RedisWatchersCounter::Listen() {
+  ReconnectBackoff backoff;
+  while (!stop_) {
+    common::Error err = Serve(&backoff);
+    if (stop_) {
+      break;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(snapshot_mutex_);  // other nodes counters unknown
+      snapshot_.clear();
+    }
+
+    WARNING_LOG() << "REDIS WATCHERS COUNTER ERROR: " << err->GetDescription() << ", reconnect in "
+                  << backoff.GetDelay() << " msec";
+    WaitStop(backoff.GetDelay());
+    backoff.Failed();
+  }
+}
+
+common::Error RedisWatchersCounter::Serve(ReconnectBackoff* backoff) {
+  redisContext* redis = nullptr;
+  common::Error err = redis_connect(config_, &redis);
+  if (err) {
+    return err;
+  }
+
+  backoff->Reset();
+  while (!WaitStop(publish_interval_sec * 1000)) {
+    err = Publish(redis);
+    if (err) {
+      break;
+    }
+
+    err = Merge(redis);
+    if (err) {
+      break;
+    }
+  }
+
+  if (!err) {  // node leaves cluster, counters should not wait ttl
+    void* reply = redisCommand(redis, "ZREM %s %s", GetNodesKey().c_str(), node_id_.c_str());
+    if (reply) {
+      freeReplyObject(reply);
+    }
+    reply = redisCommand(redis, "DEL %s", GetNodeKey(node_id_).c_str());
+    if (reply) {
+      freeReplyObject(reply);
+    }
+  }
+  redisFree(redis);
+  return err;
+}
+
+bool RedisWatchersCounter::WaitStop(unsigned msec) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stop_cond_.wait_for(lock, std::chrono::milliseconds(msec), [this]() { return stop_.load(); });
+}
+
+void RedisWatchersCounter::Stop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stop_ = true;
+  stop_cond_.notify_one();
+}
+
+void RedisWatchersCounter::UpdateLocal(size_t loop, const counters_t& watchers) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  local_[loop] = watchers;
+}
+
+void RedisWatchersCounter::AddUniqueViewer(const std::string& sid, const std::string& viewer) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<std::string>& viewers = pending_uniques_[sid];
+  if (viewers.size() < max_pending_uniques) {  // redis not responding, approximate anyway
+    viewers.push_back(viewer);
+  }
+}
+
+RedisWatchersCounter::StreamStat RedisWatchersCounter::GetStreamStat(const std::string& sid) const {
+  std::unique_lock<std::mutex> lock(snapshot_mutex_);
+  auto it = snapshot_.find(sid);
+  if (it == snapshot_.end()) {
+    return StreamStat();
+  }
+  return it->second;
+}
+
+common::Error RedisWatchersCounter::Publish(redisContext* redis) {
+  counters_t local;
+  std::map<std::string, std::vector<std::string>> uniques;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto lit = local_.begin(); lit != local_.end(); ++lit) {
+      for (auto it = lit->second.begin(); it != lit->second.end(); ++it) {
+        local[it->first] += it->second;
+      }
+    }
+    uniques.swap(pending_uniques_);
+  }
+
+  // pipelined: MULTI DEL HSET... EXPIRE EXEC, ZADD, PFADD...
+  const std::string node_key = GetNodeKey(node_id_);
+  size_t requests = 0;
+  redisAppendCommand(redis, "MULTI");
+  redisAppendCommand(redis, "DEL %s", node_key.c_str());
+  requests += 2;
+  for (auto it = local.begin(); it != local.end(); ++it) {
+    redisAppendCommand(redis, "HSET %s %s %llu", node_key.c_str(), it->first.c_str(),
+                       static_cast<unsigned long long>(it->second));
+    requests++;
+  }
+  redisAppendCommand(redis, "EXPIRE %s %d", node_key.c_str(), static_cast<int>(node_ttl_sec));
+  redisAppendCommand(redis, "EXEC");
+  redisAppendCommand(redis, "ZADD %s %lld %s", GetNodesKey().c_str(), current_sec() + node_ttl_sec, node_id_.c_str());
+  requests += 3;
+
+  for (auto it = uniques.begin(); it != uniques.end(); ++it) {
+    const std::string unique_key = GetUniqueKey(it->first);
+    std::vector<const char*> argv = {"PFADD", unique_key.c_str()};
+    std::vector<size_t> argvlen = {5, unique_key.size()};
+    for (const std::string& viewer : it->second) {
+      argv.push_back(viewer.c_str());
+      argvlen.push_back(viewer.size());
+    }
+    redisAppendCommandArgv(redis, static_cast<int>(argv.size()), argv.data(), argvlen.data());
+    redisAppendCommand(redis, "EXPIRE %s %d", unique_key.c_str(), static_cast<int>(unique_ttl_sec));
+    requests += 2;
+  }
+
+  for (size_t i = 0; i < requests; ++i) {
+    void* reply = nullptr;
+    if (redisGetReply(redis, &reply) != REDIS_OK) {
+      return common::make_error(redis->errstr);
+    }
+    freeReplyObject(reply);
+  }
+  return common::Error();
+}
+
+common::Error RedisWatchersCounter::Merge(redisContext* redis) {
+  const long long now = current_sec();
+  void* reply = redisCommand(redis, "ZREMRANGEBYSCORE %s -inf %lld", GetNodesKey().c_str(), now);  // dead nodes
+  if (!reply) {
+    return common::make_error(redis->errstr);
+  }
+  freeReplyObject(reply);
+
+  redisReply* nodes_reply = reinterpret_cast<redisReply*>(redisCommand(redis, "ZRANGE %s 0 -1", GetNodesKey().c_str()));
+  if (!nodes_reply) {
+    return common::make_error(redis->errstr);
+  }
+
+  std::vector<std::string> nodes;
+  if (nodes_reply->type == REDIS_REPLY_ARRAY) {
+    for (size_t i = 0; i < nodes_reply->elements; ++i) {
+      nodes.push_back(std::string(nodes_reply->element[i]->str, nodes_reply->element[i]->len));
+    }
+  }
+  freeReplyObject(nodes_reply);
+
+  for (const std::string& node : nodes) {  // pipelined
+    redisAppendCommand(redis, "HGETALL %s", GetNodeKey(node).c_str());
+  }
+
+  std::map<std::string, counters_t> nodes_watchers;
+  for (const std::string& node : nodes) {
+    redisReply* node_reply = nullptr;
+    if (redisGetReply(redis, reinterpret_cast<void**>(&node_reply)) != REDIS_OK) {
+      return common::make_error(redis->errstr);
+    }
+
+    counters_t& watchers = nodes_watchers[node];
+    if (node_reply->type == REDIS_REPLY_ARRAY) {
+      for (size_t j = 0; j + 1 < node_reply->elements; j += 2) {
+        const std::string sid(node_reply->element[j]->str, node_reply->element[j]->len);
+        watchers[sid] = strtoull(node_reply->element[j + 1]->str, nullptr, 10);
+      }
+    }
+    freeReplyObject(node_reply);
+  }
+
+  std::vector<std::string> streams;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto lit = local_.begin(); lit != local_.end(); ++lit) {
+      for (auto it = lit->second.begin(); it != lit->second.end(); ++it) {
+        streams.push_back(it->first);
+      }
+    }
+  }
+
+  for (const std::string& sid : streams) {  // uniques only for locally watched streams
+    redisAppendCommand(redis, "PFCOUNT %s", GetUniqueKey(sid).c_str());
+  }
+
+  counters_t unique_viewers;
+  for (const std::string& sid : streams) {
+    redisReply* count_reply = nullptr;
+    if (redisGetReply(redis, reinterpret_cast<void**>(&count_reply)) != REDIS_OK) {
+      return common::make_error(redis->errstr);
+    }
+
+    if (count_reply->type == REDIS_REPLY_INTEGER) {
+      unique_viewers[sid] = count_reply->integer;
+    }
+    freeReplyObject(count_reply);
+  }
+
+  snapshot_t snapshot = MakeSnapshot(node_id_, nodes_watchers, unique_viewers);
+  std::unique_lock<std::mutex> lock(snapshot_mutex_);
+  snapshot_.swap(snapshot);
+  return common::Error();
+}
+
+RedisWatchersCounter::snapshot_t RedisWatchersCounter::MakeSnapshot(
+    const std::string& own_node,
+    const std::map<std::string, counters_t>& nodes_watchers,
+    const counters_t& unique_viewers) {
+  snapshot_t snapshot;
+  for (auto nit = nodes_watchers.begin(); nit != nodes_watchers.end(); ++nit) {
+    if (nit->first == own_node) {  // local watchers counted by loops
+      continue;
+    }
+
+    for (auto it = nit->second.begin(); it != nit->second.end(); ++it) {
+      snapshot[it->first].watchers += it->second;
+    }
+  }
+
+  for (auto it = unique_viewers.begin(); it != unique_viewers.end(); ++it) {
+    snapshot[it->first].unique_viewers = it->second;
+  }
+  return snapshot;
+}
+
+std::string RedisWatchersCounter::GetNodesKey() const {
+  return config_.watchers_prefix + "NODES";
+}
+
+std::string RedisWatchersCounter::GetNodeKey(const std::string& node) const {
+  return config_.watchers_prefix + "NODE_" + node;
+}
+
+std::string RedisWatchersCounter::GetUniqueKey(const std::string& sid) const {
+  return config_.watchers_prefix + "UNIQUE_" + sid;
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,98 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/error.h>
+
+#include "server/redis/redis_connect.h"  // for ReconnectBackoff
+#include "server/redis/redis_sub_config.h"
+
+struct redisContext;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+// each node publishes own per stream watchers into prefix + node hash and uniques into prefix + UNIQUE_ + sid
+// hyperloglog, other nodes values merged into local snapshot
+// reconnects with backoff, snapshot is cleared while disconnected
+class RedisWatchersCounter {
+ public:
+  enum { publish_interval_sec = 2, node_ttl_sec = 10, unique_ttl_sec = 24 * 3600, max_pending_uniques = 4096 };
+  typedef std::unordered_map<std::string, size_t> counters_t;
+
+  struct StreamStat {
+    StreamStat();
+
+    size_t watchers;        // other nodes
+    size_t unique_viewers;  // all nodes, approximate
+  };
+  typedef std::unordered_map<std::string, StreamStat> snapshot_t;
+
+  // live nodes hashes summed without own node, unique viewers as counted
+  static snapshot_t MakeSnapshot(const std::string& own_node,
+                                 const std::map<std::string, counters_t>& nodes_watchers,
+                                 const counters_t& unique_viewers);
+
+  RedisWatchersCounter();
+
+  void SetConfig(const RedisSubConfig& config, const std::string& node_id);
+
+  void Listen();  // blocks until Stop
+  void Stop();
+
+  // thread safe
+  void UpdateLocal(size_t loop, const counters_t& watchers);  // per I/O loop
+  void AddUniqueViewer(const std::string& sid, const std::string& viewer);
+  StreamStat GetStreamStat(const std::string& sid) const;
+
+ private:
+  common::Error Serve(ReconnectBackoff* backoff) WARN_UNUSED_RESULT;  // one connection, until error or stop
+  bool WaitStop(unsigned msec);                                      // true if stopped
+  common::Error Publish(redisContext* redis) WARN_UNUSED_RESULT;
+  common::Error Merge(redisContext* redis) WARN_UNUSED_RESULT;
+
+  std::string GetNodesKey() const;
+  std::string GetNodeKey(const std::string& node) const;
+  std::string GetUniqueKey(const std::string& sid) const;
+
+  RedisSubConfig config_;
+  std::string node_id_;
+
+  std::mutex mutex_;
+  std::condition_variable stop_cond_;
+  std::atomic<bool> stop_;
+  std::map<size_t, counters_t> local_;
+  std::map<std::string, std::vector<std::string>> pending_uniques_;
+
+  mutable std::mutex snapshot_mutex_;
+  snapshot_t snapshot_;
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,185 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/resp/resp_protocol.h"
+
+#include <stdlib.h>  // for strtoll
+
+#include <common/convert2string.h>  // for ConvertToString
+
+namespace fastotv {
+namespace server {
+namespace resp {
+
+namespace {
+
+const char crlf[] = "\r\n";
+
+// line without crlf from pos, next is position after crlf
+parse_result_t ReadLine(const std::string& buffer, size_t pos, std::string* line, size_t* next) {
+  const size_t end = buffer.find(crlf, pos);
+  if (end == std::string::npos) {
+    return PARSE_NEED_MORE;
+  }
+
+  *line = buffer.substr(pos, end - pos);
+  *next = end + 2;
+  return PARSE_OK;
+}
+
+bool ParseLength(const std::string& str, int64_t* out) {
+  if (str.empty()) {
+    return false;
+  }
+
+  char* end = nullptr;
+  const long long value = strtoll(str.c_str(), &end, 10);
+  if (*end != '\0') {
+    return false;
+  }
+
+  *out = value;
+  return true;
+}
+
+parse_result_t ParseInline(const std::string& buffer, size_t* consumed, std::vector<std::string>* args) {
+  std::string line;
+  size_t next = 0;
+  const parse_result_t res = ReadLine(buffer, 0, &line, &next);
+  if (res != PARSE_OK) {
+    return res;
+  }
+
+  std::vector<std::string> largs;
+  size_t pos = 0;
+  while (pos < line.size()) {
+    const size_t start = line.find_first_not_of(' ', pos);
+    if (start == std::string::npos) {
+      break;
+    }
+
+    size_t end = line.find(' ', start);
+    if (end == std::string::npos) {
+      end = line.size();
+    }
+    largs.push_back(line.substr(start, end - start));
+    pos = end;
+  }
+
+  *consumed = next;
+  *args = largs;
+  return PARSE_OK;
+}
+
+}  // namespace
+
+parse_result_t ParseRequest(const std::string& buffer, size_t* consumed, std::vector<std::string>* args) {
+  if (!consumed || !args) {
+    return PARSE_ERROR;
+  }
+
+  if (buffer.empty()) {
+    return PARSE_NEED_MORE;
+  }
+
+  if (buffer[0] != '*') {
+    return ParseInline(buffer, consumed, args);
+  }
+
+  std::string line;
+  size_t pos = 0;
+  parse_result_t res = ReadLine(buffer, 1, &line, &pos);
+  if (res != PARSE_OK) {
+    return res;
+  }
+
+  int64_t count = 0;
+  if (!ParseLength(line, &count) || count < 0) {
+    return PARSE_ERROR;
+  }
+
+  std::vector<std::string> largs;
+  largs.reserve(count);
+  for (int64_t i = 0; i < count; ++i) {
+    if (pos >= buffer.size()) {
+      return PARSE_NEED_MORE;
+    }
+
+    if (buffer[pos] != '$') {
+      return PARSE_ERROR;
+    }
+
+    res = ReadLine(buffer, pos + 1, &line, &pos);
+    if (res != PARSE_OK) {
+      return res;
+    }
+
+    int64_t len = 0;
+    if (!ParseLength(line, &len) || len < 0) {
+      return PARSE_ERROR;
+    }
+
+    const size_t size = static_cast<size_t>(len);
+    if (buffer.size() < pos + size + 2) {
+      return PARSE_NEED_MORE;
+    }
+
+    if (buffer.compare(pos + size, 2, crlf) != 0) {
+      return PARSE_ERROR;
+    }
+
+    largs.push_back(buffer.substr(pos, size));
+    pos += size + 2;
+  }
+
+  *consumed = pos;
+  *args = largs;
+  return PARSE_OK;
+}
+
+std::string EncodeSimpleString(const std::string& str) {
+  return "+" + str + crlf;
+}
+
+std::string EncodeError(const std::string& error) {
+  return "-" + error + crlf;
+}
+
+std::string EncodeInteger(int64_t value) {
+  return ":" + common::ConvertToString(value) + crlf;
+}
+
+std::string EncodeBulkString(const std::string& str) {
+  return "$" + common::ConvertToString(str.size()) + crlf + str + crlf;
+}
+
+std::string EncodeNullBulkString() {
+  return std::string("$-1") + crlf;
+}
+
+std::string EncodeArray(const std::vector<std::string>& encoded_items) {
+  std::string result = "*" + common::ConvertToString(encoded_items.size()) + crlf;
+  for (const std::string& item : encoded_items) {
+    result += item;
+  }
+  return result;
+}
+
+}  // namespace resp
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,46 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for int64_t
+
+#include <string>  // for string
+#include <vector>
+
+namespace fastotv {
+namespace server {
+namespace resp {
+
+enum parse_result_t { PARSE_NEED_MORE = 0, PARSE_OK, PARSE_ERROR };
+
+// request from start of buffer, RESP array of bulk strings or inline command,
+// consumed is size of parsed request if PARSE_OK
+parse_result_t ParseRequest(const std::string& buffer, size_t* consumed, std::vector<std::string>* args);
+
+std::string EncodeSimpleString(const std::string& str);
+std::string EncodeError(const std::string& error);
+std::string EncodeInteger(int64_t value);
+std::string EncodeBulkString(const std::string& str);
+std::string EncodeNullBulkString();
+std::string EncodeArray(const std::vector<std::string>& encoded_items);
+
+}  // namespace resp
+}  // namespace server
+}  // namespace fastotv
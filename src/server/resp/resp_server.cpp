@@ -0,0 +1,526 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/resp/resp_server.h"
+
+#include <errno.h>       // for errno, EAGAIN
+#include <fcntl.h>       // for fcntl, O_NONBLOCK
+#include <netdb.h>       // for getaddrinfo
+#include <netinet/in.h>  // for sockaddr_in, ntohs
+#include <poll.h>        // for poll
+#include <string.h>      // for memset
+#include <sys/socket.h>  // for socket, bind, listen
+#include <unistd.h>      // for close
+
+#include <algorithm>  // for transform, min
+
+#include <common/convert2string.h>  // for ConvertToString
+
+#include "server/resp/resp_protocol.h"  // for ParseRequest
+
+#define INJECTED_FAULT_ERROR "ERR injected fault"
+
+namespace fastotv {
+namespace server {
+namespace resp {
+
+namespace {
+
+bool SetNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+std::string ToUpper(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+  return str;
+}
+
+std::string WrongArgumentsError(const std::string& command) {
+  return EncodeError("ERR wrong number of arguments for '" + command + "' command");
+}
+
+std::string EncodeMessage(const std::string& channel, const std::string& message) {
+  return EncodeArray({EncodeBulkString("message"), EncodeBulkString(channel), EncodeBulkString(message)});
+}
+
+std::string EncodeSubscription(const char* kind, const std::string& channel, size_t count) {
+  return EncodeArray({EncodeBulkString(kind), EncodeBulkString(channel), EncodeInteger(count)});
+}
+
+}  // namespace
+
+RespFaults::RespFaults() : latency_msec(0), error_every(0), drop_every(0) {}
+
+RespServer::Connection::Connection() : input(), output(), delayed(), channels(), close_after_write(false) {}
+
+void RespServer::Connection::Append(const std::string& data) {
+  if (delayed.empty()) {
+    output += data;
+    return;
+  }
+
+  delayed.back().second += data;
+}
+
+void RespServer::Connection::ReleaseDelayed(time_point_t now) {
+  while (!delayed.empty() && delayed.front().first <= now) {
+    output += delayed.front().second;
+    delayed.pop_front();
+  }
+}
+
+RespServer::RespServer(const common::net::HostAndPort& host)
+    : host_(host),
+      fd_(-1),
+      stop_(false),
+      commands_count_(0),
+      mutex_(),
+      faults_(),
+      strings_(),
+      hashes_(),
+      connections_(),
+      subscribers_() {}
+
+RespServer::~RespServer() {
+  for (auto& connection : connections_) {
+    close(connection.first);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+common::ErrnoError RespServer::Bind() {
+  const std::string port = common::ConvertToString(host_.GetPort());
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  struct addrinfo* result = nullptr;
+  int res = getaddrinfo(host_.GetHost().c_str(), port.c_str(), &hints, &result);
+  if (res != 0) {
+    return common::make_errno_error(gai_strerror(res), EINVAL);
+  }
+
+  int err = EINVAL;
+  for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+    int fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (fd == -1) {
+      err = errno;
+      continue;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, rp->ai_addr, rp->ai_addrlen) == 0 && listen(fd, 128) == 0 && SetNonBlocking(fd)) {
+      fd_ = fd;
+      break;
+    }
+
+    err = errno;
+    close(fd);
+  }
+  freeaddrinfo(result);
+
+  if (fd_ == -1) {
+    return common::make_errno_error("Resp server bind failed", err);
+  }
+
+  struct sockaddr_storage addr;
+  socklen_t addr_len = sizeof(addr);
+  if (getsockname(fd_, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) == 0) {
+    const uint16_t bound_port = addr.ss_family == AF_INET6
+                                    ? ntohs(reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port)
+                                    : ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+    host_.SetPort(bound_port);
+  }
+  return common::ErrnoError();
+}
+
+common::net::HostAndPort RespServer::GetHost() const {
+  return host_;
+}
+
+void RespServer::Serve() {
+  std::vector<struct pollfd> pfds;
+  while (!stop_ && fd_ != -1) {
+    pfds.clear();
+    struct pollfd listen_pfd;
+    listen_pfd.fd = fd_;
+    listen_pfd.events = POLLIN;
+    listen_pfd.revents = 0;
+    pfds.push_back(listen_pfd);
+    for (const auto& connection : connections_) {
+      struct pollfd pfd;
+      pfd.fd = connection.first;
+      pfd.events = connection.second.output.empty() ? POLLIN : POLLIN | POLLOUT;
+      pfd.revents = 0;
+      pfds.push_back(pfd);
+    }
+
+    int res = poll(pfds.data(), pfds.size(), GetPollTimeout(std::chrono::steady_clock::now()));
+    if (res < 0) {
+      continue;
+    }
+
+    if (pfds[0].revents & POLLIN) {
+      Accept();
+    }
+
+    for (size_t i = 1; i < pfds.size(); ++i) {
+      const int fd = pfds[i].fd;
+      auto it = connections_.find(fd);
+      if (it == connections_.end()) {  // closed in this round
+        continue;
+      }
+
+      if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!ReadConnection(fd, &it->second)) {
+          CloseConnection(fd);
+          continue;
+        }
+      }
+    }
+
+    const Connection::time_point_t now = std::chrono::steady_clock::now();
+    for (auto it = connections_.begin(); it != connections_.end();) {  // replies and published messages
+      const int fd = it->first;
+      Connection& connection = it->second;
+      ++it;
+      connection.ReleaseDelayed(now);
+      if (!WriteConnection(fd, &connection) ||
+          (connection.close_after_write && connection.output.empty() && connection.delayed.empty())) {
+        CloseConnection(fd);
+      }
+    }
+  }
+
+  for (auto& connection : connections_) {
+    close(connection.first);
+  }
+  connections_.clear();
+  subscribers_.clear();
+}
+
+void RespServer::Stop() {
+  stop_ = true;
+}
+
+void RespServer::SetFaults(const RespFaults& faults) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  faults_ = faults;
+}
+
+void RespServer::SetValue(const std::string& key, const std::string& value) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  strings_[key] = value;
+}
+
+size_t RespServer::GetCommandsCount() const {
+  return commands_count_.load();
+}
+
+void RespServer::Accept() {
+  while (true) {
+    int fd = accept(fd_, nullptr, nullptr);
+    if (fd == -1) {
+      return;
+    }
+
+    if (!SetNonBlocking(fd)) {
+      close(fd);
+      continue;
+    }
+    connections_[fd] = Connection();
+  }
+}
+
+bool RespServer::ReadConnection(int fd, Connection* connection) {
+  char buff[read_buffer_size];
+  while (true) {
+    ssize_t res = recv(fd, buff, sizeof(buff), 0);
+    if (res == 0) {
+      return false;
+    }
+
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    connection->input.append(buff, res);
+  }
+
+  size_t offset = 0;
+  while (!connection->close_after_write && offset < connection->input.size()) {
+    size_t consumed = 0;
+    std::vector<std::string> args;
+    const parse_result_t parsed = ParseRequest(connection->input.substr(offset), &consumed, &args);
+    if (parsed == PARSE_NEED_MORE) {
+      break;
+    }
+
+    if (parsed == PARSE_ERROR) {
+      connection->Append(EncodeError("ERR Protocol error"));
+      connection->close_after_write = true;
+      break;
+    }
+
+    offset += consumed;
+    if (!args.empty()) {
+      HandleCommand(fd, connection, args);
+    }
+  }
+
+  connection->input.erase(0, offset);
+  return connection->input.size() <= max_request_size;
+}
+
+bool RespServer::WriteConnection(int fd, Connection* connection) {
+  size_t written = 0;
+  while (written < connection->output.size()) {
+    ssize_t res = send(fd, connection->output.data() + written, connection->output.size() - written, MSG_NOSIGNAL);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return false;
+    }
+    written += res;
+  }
+
+  connection->output.erase(0, written);
+  return true;
+}
+
+void RespServer::CloseConnection(int fd) {
+  auto it = connections_.find(fd);
+  if (it == connections_.end()) {
+    return;
+  }
+
+  for (const std::string& channel : it->second.channels) {
+    auto sub = subscribers_.find(channel);
+    if (sub == subscribers_.end()) {
+      continue;
+    }
+
+    sub->second.erase(fd);
+    if (sub->second.empty()) {
+      subscribers_.erase(sub);
+    }
+  }
+  connections_.erase(it);
+  close(fd);
+}
+
+void RespServer::HandleCommand(int fd, Connection* connection, const std::vector<std::string>& args) {
+  const size_t number = ++commands_count_;
+  RespFaults faults;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    faults = faults_;
+  }
+
+  if (faults.drop_every && number % faults.drop_every == 0) {
+    connection->close_after_write = true;
+    return;
+  }
+
+  std::string answer;
+  if (faults.error_every && number % faults.error_every == 0) {
+    answer = EncodeError(INJECTED_FAULT_ERROR);
+  } else {
+    ExecuteCommand(fd, connection, args, &answer);
+  }
+
+  if (!faults.latency_msec) {
+    connection->Append(answer);
+    return;
+  }
+
+  // busy redis, answers of one connection one after another
+  Connection::time_point_t ready = std::chrono::steady_clock::now();
+  if (!connection->delayed.empty()) {
+    ready = std::max(ready, connection->delayed.back().first);
+  }
+  ready += std::chrono::milliseconds(faults.latency_msec);
+  connection->delayed.push_back(std::make_pair(ready, answer));
+}
+
+void RespServer::ExecuteCommand(int fd,
+                                Connection* connection,
+                                const std::vector<std::string>& args,
+                                std::string* answer) {
+  const std::string command = ToUpper(args[0]);
+  std::string& out = *answer;
+  if (command == "PING") {
+    out += args.size() > 1 ? EncodeBulkString(args[1]) : EncodeSimpleString("PONG");
+  } else if (command == "GET") {
+    if (args.size() != 2) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = strings_.find(args[1]);
+    out += it == strings_.end() ? EncodeNullBulkString() : EncodeBulkString(it->second);
+  } else if (command == "SET") {
+    if (args.size() < 3) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    strings_[args[1]] = args[2];
+    out += EncodeSimpleString("OK");
+  } else if (command == "DEL") {
+    if (args.size() < 2) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    int64_t removed = 0;
+    for (size_t i = 1; i < args.size(); ++i) {
+      removed += strings_.erase(args[i]) + hashes_.erase(args[i]);
+    }
+    out += EncodeInteger(removed);
+  } else if (command == "HGET") {
+    if (args.size() != 3) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto hash = hashes_.find(args[1]);
+    if (hash == hashes_.end() || hash->second.find(args[2]) == hash->second.end()) {
+      out += EncodeNullBulkString();
+      return;
+    }
+    out += EncodeBulkString(hash->second[args[2]]);
+  } else if (command == "HSET") {
+    if (args.size() < 4 || args.size() % 2 != 0) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::map<std::string, std::string>& hash = hashes_[args[1]];
+    int64_t added = 0;
+    for (size_t i = 2; i + 1 < args.size(); i += 2) {
+      added += hash.find(args[i]) == hash.end() ? 1 : 0;
+      hash[args[i]] = args[i + 1];
+    }
+    out += EncodeInteger(added);
+  } else if (command == "HGETALL") {
+    if (args.size() != 2) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<std::string> items;
+    auto hash = hashes_.find(args[1]);
+    if (hash != hashes_.end()) {
+      for (const auto& field : hash->second) {
+        items.push_back(EncodeBulkString(field.first));
+        items.push_back(EncodeBulkString(field.second));
+      }
+    }
+    out += EncodeArray(items);
+  } else if (command == "PUBLISH") {
+    if (args.size() != 3) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    out += EncodeInteger(Publish(args[1], args[2]));
+  } else if (command == "SUBSCRIBE") {
+    if (args.size() < 2) {
+      out += WrongArgumentsError(args[0]);
+      return;
+    }
+
+    for (size_t i = 1; i < args.size(); ++i) {
+      connection->channels.insert(args[i]);
+      subscribers_[args[i]].insert(fd);
+      out += EncodeSubscription("subscribe", args[i], connection->channels.size());
+    }
+  } else if (command == "UNSUBSCRIBE") {
+    std::vector<std::string> channels(args.begin() + 1, args.end());
+    if (channels.empty()) {
+      channels.assign(connection->channels.begin(), connection->channels.end());
+    }
+
+    for (const std::string& channel : channels) {
+      connection->channels.erase(channel);
+      auto sub = subscribers_.find(channel);
+      if (sub != subscribers_.end()) {
+        sub->second.erase(fd);
+        if (sub->second.empty()) {
+          subscribers_.erase(sub);
+        }
+      }
+      out += EncodeSubscription("unsubscribe", channel, connection->channels.size());
+    }
+  } else {
+    out += EncodeError("ERR unknown command '" + args[0] + "'");
+  }
+}
+
+int RespServer::GetPollTimeout(Connection::time_point_t now) const {
+  int timeout = poll_timeout_msec;
+  for (const auto& connection : connections_) {
+    if (connection.second.delayed.empty()) {
+      continue;
+    }
+
+    const auto wait = connection.second.delayed.front().first - now;
+    const int64_t wait_msec = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count() + 1;
+    timeout = std::min<int64_t>(timeout, std::max<int64_t>(wait_msec, 0));
+  }
+  return timeout;
+}
+
+size_t RespServer::Publish(const std::string& channel, const std::string& message) {
+  auto sub = subscribers_.find(channel);
+  if (sub == subscribers_.end()) {
+    return 0;
+  }
+
+  const std::string encoded = EncodeMessage(channel, message);
+  for (int fd : sub->second) {
+    connections_[fd].Append(encoded);
+  }
+  return sub->second.size();
+}
+
+}  // namespace resp
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,112 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint16_t, uint32_t
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>   // for string
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/error.h>      // for ErrnoError
+#include <common/macros.h>     // for WARN_UNUSED_RESULT
+#include <common/net/types.h>  // for HostAndPort
+
+namespace fastotv {
+namespace server {
+namespace resp {
+
+struct RespFaults {
+  RespFaults();
+
+  uint32_t latency_msec;  // before every answer, per connection, other connections not blocked
+  uint32_t error_every;   // every Nth command answered with error, 0 disables
+  uint32_t drop_every;    // connection closed instead of every Nth command answer, 0 disables
+};
+
+// in-process redis stand-in for tests and benchmarks, one thread poll loop
+// PING, GET, SET, DEL, HGET, HSET, HGETALL, PUBLISH, SUBSCRIBE, UNSUBSCRIBE
+class RespServer {
+ public:
+  enum { poll_timeout_msec = 100, read_buffer_size = 16 * 1024, max_request_size = 64 * 1024 * 1024 };
+
+  explicit RespServer(const common::net::HostAndPort& host);  // port 0 for any free
+  ~RespServer();
+
+  common::ErrnoError Bind() WARN_UNUSED_RESULT;
+  common::net::HostAndPort GetHost() const;  // with bound port after Bind
+  void Serve();  // blocks until Stop
+  void Stop();   // thread safe
+
+  // thread safe
+  void SetFaults(const RespFaults& faults);
+  void SetValue(const std::string& key, const std::string& value);
+  size_t GetCommandsCount() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RespServer);
+
+  struct Connection {
+    typedef std::chrono::steady_clock::time_point time_point_t;
+
+    Connection();
+
+    void Append(const std::string& data);  // after delayed answers, keeps order
+    void ReleaseDelayed(time_point_t now);
+
+    std::string input;
+    std::string output;
+    std::deque<std::pair<time_point_t, std::string>> delayed;  // answers held by injected latency
+    std::set<std::string> channels;
+    bool close_after_write;
+  };
+
+  void Accept();
+  bool ReadConnection(int fd, Connection* connection);   // false if closed
+  bool WriteConnection(int fd, Connection* connection);  // false if closed
+  void CloseConnection(int fd);
+  void HandleCommand(int fd, Connection* connection, const std::vector<std::string>& args);
+  void ExecuteCommand(int fd, Connection* connection, const std::vector<std::string>& args, std::string* answer);
+  int GetPollTimeout(Connection::time_point_t now) const;  // msec, earliest delayed answer
+  size_t Publish(const std::string& channel, const std::string& message);
+
+  common::net::HostAndPort host_;
+  int fd_;
+  std::atomic<bool> stop_;
+  std::atomic<size_t> commands_count_;
+
+  mutable std::mutex mutex_;  // faults and data, connections only in serve thread
+  RespFaults faults_;
+  std::map<std::string, std::string> strings_;
+  std::map<std::string, std::map<std::string, std::string>> hashes_;
+
+  std::map<int, Connection> connections_;
+  std::map<std::string, std::set<int>> subscribers_;
+};
+
+}  // namespace resp
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,98 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>  // for signal, SIGINT
+#include <stdio.h>   // for fprintf, stderr
+#include <stdlib.h>  // for exit, EXIT_FAILURE
+#include <unistd.h>  // for getopt, optarg
+
+#include <string>  // for string
+
+#include <common/convert2string.h>  // for ConvertFromString
+
+#include "server/resp/resp_server.h"  // for RespServer
+
+namespace {
+
+fastotv::server::resp::RespServer* server = nullptr;
+
+void HandleStopSignal(int sig) {
+  UNUSED(sig);
+  if (server) {
+    server->Stop();
+  }
+}
+
+void PrintUsage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [-s host:port] [-l latency msec per command] [-e error every Nth command]\n"
+          "          [-k drop connection every Nth command]\n",
+          name);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  common::net::HostAndPort host("localhost", 6379);
+  fastotv::server::resp::RespFaults faults;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:l:e:k:")) != -1) {
+    bool res = true;
+    switch (opt) {
+      case 's':
+        res = common::ConvertFromString(optarg, &host);
+        break;
+      case 'l':
+        res = common::ConvertFromString(optarg, &faults.latency_msec);
+        break;
+      case 'e':
+        res = common::ConvertFromString(optarg, &faults.error_every);
+        break;
+      case 'k':
+        res = common::ConvertFromString(optarg, &faults.drop_every);
+        break;
+      default: /* '?' */
+        res = false;
+        break;
+    }
+    if (!res) {
+      PrintUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  fastotv::server::resp::RespServer resp(host);
+  common::ErrnoError err = resp.Bind();
+  if (err) {
+    fprintf(stderr, "%s\n", err->GetDescription().c_str());
+    return EXIT_FAILURE;
+  }
+
+  resp.SetFaults(faults);
+  server = &resp;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  const common::net::HostAndPort bound = resp.GetHost();
+  fprintf(stderr, "Listening on %s:%u\n", bound.GetHost().c_str(), static_cast<unsigned>(bound.GetPort()));
+  resp.Serve();
+  server = nullptr;
+  return EXIT_SUCCESS;
+}
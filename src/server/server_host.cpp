@@ -22,6 +22,7 @@
 
 #include <string>  // for string
 
+#include <common/convert2string.h>          // for ConvertToString
 #include <common/libev/tcp/tcp_server.h>    // for TcpServer
 #include <common/logger.h>                  // for COMPACT_LOG_FILE_CRIT
 #include <common/threads/thread_manager.h>  // for THREAD_MANAGER
@@ -29,28 +30,63 @@
 #include "inner/inner_tcp_client.h"  // for InnerTcpClient
 
 #include "server/inner/inner_tcp_handler.h"  // for InnerTcpHandlerHost
+#include "server/inner/inner_tcp_loop.h"
 #include "server/inner/inner_tcp_server.h"
 
+#include "server/metrics/metrics_http_server.h"  // for MetricsHttpServer
+#include "server/metrics/request_tracer.h"       // for RequestTracer
+
 #define BUF_SIZE 4096
 #define UNKNOWN_CLIENT_NAME "Unknown"
 
 namespace fastotv {
 namespace server {
 
-ServerHost::ServerHost(const Config& config) : handler_(nullptr), server_(nullptr), rstorage_(), config_(config) {
+ServerHost::ServerHost(const Config& config)
+    : handler_(nullptr),
+      server_(nullptr),
+      loops_(),
+      loops_threads_(),
+      metrics_server_(nullptr),
+      metrics_thread_(),
+      connections_(),
+      rstorage_(),
+      config_(config) {
   handler_ = new inner::InnerTcpHandlerHost(this, config);
   server_ = new inner::InnerTcpServer(config.server.host, true, handler_);
   server_->SetName("inner_server");
 
+  std::vector<common::libev::IoLoop*> io_loops = {server_};
+  for (size_t i = 1; i < config.server.io_loops; ++i) {
+    inner::InnerTcpLoop* loop = new inner::InnerTcpLoop(handler_);
+    loop->SetName("inner_loop_" + common::ConvertToString(i));
+    loops_.push_back(loop);
+    io_loops.push_back(loop);
+  }
+  handler_->SetIoLoops(io_loops);
+
+  if (config.server.metrics_host.IsValid()) {
+    metrics_server_ = new metrics::MetricsHttpServer(config.server.metrics_host);
+  }
+  metrics::RequestTracer::GetInstance()->Enable(config.server.trace_buffer_size);
+
   rstorage_.SetConfig(config.server.redis);
 }
 
 ServerHost::~ServerHost() {
+  for (inner::InnerTcpLoop* loop : loops_) {
+    delete loop;
+  }
+  loops_.clear();
+  destroy(&metrics_server_);
   destroy(&server_);
   destroy(&handler_);
 }
 
 void ServerHost::Stop() {
+  for (inner::InnerTcpLoop* loop : loops_) {
+    loop->Stop();
+  }
   server_->Stop();
 }
 
@@ -61,13 +97,48 @@ int ServerHost::Exec() {
     return EXIT_FAILURE;
   }
 
-  err = server_->Listen(5);
+  err = server_->Listen(config_.server.accept_backlog);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     return EXIT_FAILURE;
   }
 
-  return server_->Exec();
+  for (inner::InnerTcpLoop* loop : loops_) {
+    auto loop_thread = THREAD_MANAGER()->CreateThread(&inner::InnerTcpLoop::Exec, loop);
+    bool result = loop_thread->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started thread for loop: " << loop->GetName();
+    }
+    loops_threads_.push_back(loop_thread);
+  }
+
+  if (metrics_server_) {
+    common::ErrnoError merr = metrics_server_->Bind();
+    if (merr) {
+      DEBUG_MSG_ERROR(merr, common::logging::LOG_LEVEL_WARNING);
+    } else {
+      metrics_thread_ = THREAD_MANAGER()->CreateThread(&metrics::MetricsHttpServer::Serve, metrics_server_);
+      bool result = metrics_thread_->Start();
+      if (!result) {
+        WARNING_LOG() << "Don't started metrics server thread.";
+      }
+    }
+  }
+
+  int res = server_->Exec();
+  for (inner::InnerTcpLoop* loop : loops_) {
+    loop->Stop();
+  }
+  for (auto loop_thread : loops_threads_) {
+    loop_thread->Join();
+  }
+  loops_threads_.clear();
+  if (metrics_thread_) {
+    metrics_server_->Stop();
+    metrics_thread_->Join();
+    metrics_thread_.reset();
+  }
+  return res;
 }
 
 common::Error ServerHost::UnRegisterInnerConnectionByHost(common::libev::IoClient* connection) {
@@ -77,12 +148,14 @@ common::Error ServerHost::UnRegisterInnerConnectionByHost(common::libev::IoClien
     return common::make_error_inval();
   }
 
-  user_id_t uid = iconnection->GetUid();
-  if (uid.empty()) {
+  const Symbol uid = iconnection->GetUidSymbol();
+  if (uid.IsEmpty()) {
     return common::make_error_inval();
   }
 
-  connections_.erase(uid);
+  if (!connections_.Remove(uid, iconnection->GetDeviceIDSymbol(), iconnection)) {
+    return common::make_error_inval();
+  }
   return common::Error();
 }
 
@@ -96,12 +169,13 @@ common::Error ServerHost::RegisterInnerConnectionByUser(user_id_t user_id,
     return common::make_error_inval();
   }
 
+  if (!connections_.Insert(Symbol(user_id), Symbol(user.GetDeviceID()), iconnection)) {
+    return common::make_error("Device already connected");
+  }
+
   iconnection->SetServerHostInfo(user);
   iconnection->SetUid(user_id);
-
-  login_t login = user.GetLogin();
-  connections_[user_id].push_back(iconnection);
-  connection->SetName(login);
+  connection->SetName(user.GetLogin());
   return common::Error();
 }
 
@@ -117,20 +191,13 @@ common::Error ServerHost::GetChatChannels(std::vector<stream_id>* channels) cons
   return rstorage_.GetChatChannels(channels);
 }
 
-inner::InnerTcpClient* ServerHost::FindInnerConnectionByUserIDAndDeviceID(user_id_t user_id, device_id_t dev) const {
-  inner_connections_type::const_iterator hs = connections_.find(user_id);
-  if (hs == connections_.end()) {
-    return nullptr;
-  }
+inner::InnerTcpClient* ServerHost::FindInnerConnectionByUserIDAndDeviceID(const user_id_t& user_id,
+                                                                         const device_id_t& dev) const {
+  return connections_.Find(user_id, dev);
+}
 
-  auto devices = (*hs).second;
-  for (inner::InnerTcpClient* connected_device : devices) {
-    AuthInfo uinf = connected_device->GetServerHostInfo();
-    if (uinf.GetDeviceID() == dev) {
-      return connected_device;
-    }
-  }
-  return nullptr;
+common::libev::IoLoop* ServerHost::FindInnerConnectionLoop(const user_id_t& user_id, const device_id_t& dev) const {
+  return connections_.FindOwnerLoop(user_id, dev);
 }
 
 }  // namespace server
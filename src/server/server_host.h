@@ -18,19 +18,26 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <memory>  // for shared_ptr
+#include <vector>
 
 #include <common/error.h>   // for Error
 #include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_...
 
 #include "redis/redis_storage.h"
 
-#include "server/config.h"     // for Config
-#include "server/user_info.h"  // for user_id_t, UserInfo (ptr only)
+#include "server/config.h"                       // for Config
+#include "server/inner/inner_connections_index.h"  // for InnerConnectionsIndex
+#include "server/user_info.h"                    // for user_id_t, UserInfo (ptr only)
 
 namespace common {
 namespace libev {
 class IoClient;
+class IoLoop;
+}  // namespace libev
+namespace threads {
+template <typename RT>
+class Thread;
 }
 }  // namespace common
 
@@ -41,12 +48,15 @@ namespace inner {
 class InnerTcpClient;
 class InnerTcpHandlerHost;
 class InnerTcpServer;
+class InnerTcpLoop;
 }  // namespace inner
+namespace metrics {
+class MetricsHttpServer;
+}
 
 class ServerHost {
  public:
   enum { timeout_seconds = 1 };
-  typedef std::unordered_map<user_id_t, std::vector<inner::InnerTcpClient*>> inner_connections_type;
 
   explicit ServerHost(const Config& config);
   ~ServerHost();
@@ -63,15 +73,21 @@ class ServerHost {
 
   common::Error GetChatChannels(std::vector<stream_id>* channels) const WARN_UNUSED_RESULT;
 
-  inner::InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(user_id_t user_id, device_id_t dev) const;
+  // pointer valid only in owner loop thread
+  inner::InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(const user_id_t& user_id, const device_id_t& dev) const;
+  common::libev::IoLoop* FindInnerConnectionLoop(const user_id_t& user_id, const device_id_t& dev) const;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ServerHost);
 
   inner::InnerTcpHandlerHost* handler_;
   inner::InnerTcpServer* server_;
+  std::vector<inner::InnerTcpLoop*> loops_;  // stream affinity loops, without listening socket
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> loops_threads_;
+  metrics::MetricsHttpServer* metrics_server_;  // nullptr if disabled
+  std::shared_ptr<common::threads::Thread<void>> metrics_thread_;
 
-  inner_connections_type connections_;
+  inner::InnerConnectionsIndex connections_;
   redis::RedisStorage rstorage_;
   const Config config_;
 };
@@ -0,0 +1,118 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdlib.h>  // for malloc, free
+
+#include <mutex>
+#include <new>  // for bad_alloc
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+namespace server {
+
+// fixed size blocks carved from slabs, freed blocks reused, slabs returned only in dtor
+// thread safe, objects can be created in one loop and deleted in other
+template <size_t BlockSize, size_t BlocksPerSlab = 512>
+class SlabAllocator {
+ public:
+  SlabAllocator() : mutex_(), slabs_(), free_list_(nullptr), allocated_(0) {}
+
+  ~SlabAllocator() {
+    for (char* slab : slabs_) {
+      free(slab);
+    }
+  }
+
+  void* Allocate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!free_list_) {
+      AddSlab();
+    }
+
+    FreeBlock* block = free_list_;
+    free_list_ = block->next;
+    allocated_++;
+    return block;
+  }
+
+  void Deallocate(void* ptr) {
+    if (!ptr) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_list_;
+    free_list_ = block;
+    allocated_--;
+  }
+
+  size_t GetAllocatedCount() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return allocated_;
+  }
+
+  size_t GetSlabsCount() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return slabs_.size();
+  }
+
+  size_t GetReservedBytes() const {  // all slabs, used and free blocks
+    return GetSlabsCount() * block_size * BlocksPerSlab;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SlabAllocator);
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  enum {
+    alignment = alignof(max_align_t),
+    min_block_size = BlockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : BlockSize,
+    block_size = (min_block_size + alignment - 1) / alignment * alignment
+  };
+
+  void AddSlab() {
+    char* slab = static_cast<char*>(malloc(block_size * BlocksPerSlab));
+    if (!slab) {
+      throw std::bad_alloc();
+    }
+
+    slabs_.push_back(slab);
+    for (size_t i = BlocksPerSlab; i > 0; --i) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * block_size);
+      block->next = free_list_;
+      free_list_ = block;
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<char*> slabs_;
+  FreeBlock* free_list_;
+  size_t allocated_;
+};
+
+}  // namespace server
+}  // namespace fastotv
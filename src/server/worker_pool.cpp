@@ -0,0 +1,104 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/worker_pool.h"
+
+#include <common/logger.h>                  // for COMPACT_LOG_WARNING, WARNING_LOG
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+namespace fastotv {
+namespace server {
+
+WorkerPool::WorkerPool(size_t threads_count, size_t queue_size)
+    : threads_count_(threads_count),
+      queue_size_(queue_size),
+      threads_(),
+      mutex_(),
+      cond_(),
+      tasks_(),
+      running_(false) {}
+
+WorkerPool::~WorkerPool() {
+  Stop();
+}
+
+void WorkerPool::Start() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (running_) {
+      return;
+    }
+    running_ = true;
+  }
+
+  for (size_t i = 0; i < threads_count_; ++i) {
+    auto thread = THREAD_MANAGER()->CreateThread(&WorkerPool::Work, this);
+    bool result = thread->Start();
+    if (!result) {
+      WARNING_LOG() << "Don't started worker thread.";
+      continue;
+    }
+    threads_.push_back(thread);
+  }
+}
+
+void WorkerPool::Stop() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    running_ = false;
+    tasks_.clear();
+    cond_.notify_all();
+  }
+
+  for (auto thread : threads_) {
+    thread->Join();
+  }
+  threads_.clear();
+}
+
+bool WorkerPool::Post(task_t task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_ || threads_count_ == 0 || tasks_.size() >= queue_size_) {
+    return false;
+  }
+
+  tasks_.push_back(task);
+  cond_.notify_one();
+  return true;
+}
+
+void WorkerPool::Work() {
+  while (true) {
+    task_t task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+      if (!running_) {
+        return;
+      }
+
+      task = tasks_.front();
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
+
+}  // namespace server
+}  // namespace fastotv
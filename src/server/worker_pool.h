@@ -0,0 +1,69 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+
+// bounded pool for cpu heavy tasks, results should be posted back into loop by task itself
+class WorkerPool {
+ public:
+  typedef std::function<void()> task_t;
+
+  WorkerPool(size_t threads_count, size_t queue_size);
+  ~WorkerPool();
+
+  void Start();
+  void Stop();  // pending tasks dropped
+
+  bool Post(task_t task);  // thread safe, false if queue is full or pool not started
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+
+  void Work();
+
+  const size_t threads_count_;
+  const size_t queue_size_;
+  std::vector<std::shared_ptr<common::threads::Thread<void>>> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<task_t> tasks_;
+  bool running_;
+};
+
+}  // namespace server
+}  // namespace fastotv
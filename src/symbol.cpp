@@ -0,0 +1,150 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "symbol.h"
+
+#include <algorithm>  // for min
+
+namespace fastotv {
+
+Symbol::Symbol() : id_(0) {}
+
+Symbol::Symbol(const std::string& str) : id_(0) {
+  if (!SymbolTable::GetInstance()->Intern(str, &id_)) {
+    id_ = 0;
+  }
+}
+
+bool Symbol::Intern(const std::string& str, Symbol* symbol) {
+  if (!symbol) {
+    return false;
+  }
+
+  return SymbolTable::GetInstance()->Intern(str, &symbol->id_);
+}
+
+bool Symbol::Find(const std::string& str, Symbol* symbol) {
+  if (!symbol) {
+    return false;
+  }
+
+  return SymbolTable::GetInstance()->Find(str, &symbol->id_);
+}
+
+const std::string& Symbol::ToString() const {
+  return SymbolTable::GetInstance()->Lookup(id_);
+}
+
+SymbolTable* SymbolTable::GetInstance() {
+  static SymbolTable* table = new SymbolTable;  // never destroyed, symbols can be used by static objects
+  return table;
+}
+
+SymbolTable::SymbolTable()
+    : shards_(), chunks_mutex_(), chunks_(), size_(1), max_size_(static_cast<size_t>(chunk_size) * max_chunks) {
+  for (size_t i = 0; i < max_chunks; ++i) {
+    chunks_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  chunks_[0].store(new std::string[chunk_size], std::memory_order_release);  // 0 is empty string
+}
+
+SymbolTable::~SymbolTable() {
+  for (size_t i = 0; i < max_chunks; ++i) {
+    delete[] chunks_[i].load();
+  }
+}
+
+bool SymbolTable::Intern(const std::string& str, Symbol::id_t* id) {
+  if (!id) {
+    return false;
+  }
+
+  if (str.empty()) {
+    *id = 0;
+    return true;
+  }
+
+  Shard& shard = shards_[std::hash<std::string>()(str) % shards_count];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.ids.find(str);
+  if (it != shard.ids.end()) {
+    *id = it->second;
+    return true;
+  }
+
+  Symbol::id_t nid;
+  {
+    std::unique_lock<std::mutex> chunks_lock(chunks_mutex_);
+    nid = size_.load(std::memory_order_relaxed);
+    if (nid >= max_size_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+
+    const size_t chunk = nid / chunk_size;
+    std::string* strings = chunks_[chunk].load(std::memory_order_relaxed);
+    if (!strings) {
+      strings = new std::string[chunk_size];
+      chunks_[chunk].store(strings, std::memory_order_release);
+    }
+    strings[nid % chunk_size] = str;
+    size_.store(nid + 1, std::memory_order_release);
+  }
+  shard.ids[str] = nid;
+  *id = nid;
+  return true;
+}
+
+bool SymbolTable::Find(const std::string& str, Symbol::id_t* id) const {
+  if (!id) {
+    return false;
+  }
+
+  if (str.empty()) {
+    *id = 0;
+    return true;
+  }
+
+  Shard& shard = shards_[std::hash<std::string>()(str) % shards_count];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto it = shard.ids.find(str);
+  if (it == shard.ids.end()) {
+    return false;
+  }
+
+  *id = it->second;
+  return true;
+}
+
+const std::string& SymbolTable::Lookup(Symbol::id_t id) const {
+  const std::string* strings = chunks_[id / chunk_size].load(std::memory_order_acquire);
+  return strings[id % chunk_size];
+}
+
+size_t SymbolTable::GetSize() const {
+  return size_.load(std::memory_order_acquire);
+}
+
+size_t SymbolTable::GetMaxSize() const {
+  return max_size_.load(std::memory_order_relaxed);
+}
+
+void SymbolTable::SetMaxSize(size_t max_size) {
+  max_size_.store(std::min(max_size, static_cast<size_t>(chunk_size) * max_chunks), std::memory_order_relaxed);
+}
+
+}  // namespace fastotv
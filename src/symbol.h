@@ -0,0 +1,105 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t
+
+#include <atomic>
+#include <functional>  // for hash
+#include <mutex>
+#include <string>  // for string
+#include <unordered_map>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+
+// interned string, compared and hashed as 32-bit id, string only at serialization boundaries
+// strings are never released, intern only bounded sets (ids, logins, devices)
+class Symbol {
+ public:
+  typedef uint32_t id_t;
+
+  Symbol();                                  // empty string
+  explicit Symbol(const std::string& str);  // thread safe, empty if table is full
+
+  static bool Intern(const std::string& str, Symbol* symbol);  // false if table is full
+  static bool Find(const std::string& str, Symbol* symbol);    // without interning, false if unknown
+
+  id_t GetId() const { return id_; }
+  bool IsEmpty() const { return id_ == 0; }
+  const std::string& ToString() const;  // thread safe, lock free
+
+ private:
+  id_t id_;
+};
+
+inline bool operator==(const Symbol& left, const Symbol& right) {
+  return left.GetId() == right.GetId();
+}
+
+inline bool operator!=(const Symbol& left, const Symbol& right) {
+  return !(left == right);
+}
+
+inline bool operator<(const Symbol& left, const Symbol& right) {
+  return left.GetId() < right.GetId();
+}
+
+// sharded string to id maps, ids to strings in fixed chunks never moved
+// interning fails after max size, known strings still found
+class SymbolTable {
+ public:
+  enum { shards_count = 16, chunk_size = 4096, max_chunks = 16384 };
+
+  static SymbolTable* GetInstance();
+
+  bool Intern(const std::string& str, Symbol::id_t* id);      // false if table is full
+  bool Find(const std::string& str, Symbol::id_t* id) const;  // without interning, false if unknown
+  const std::string& Lookup(Symbol::id_t id) const;
+  size_t GetSize() const;
+  size_t GetMaxSize() const;
+  void SetMaxSize(size_t max_size);  // at most chunk_size * max_chunks
+
+ private:
+  SymbolTable();
+  ~SymbolTable();
+  DISALLOW_COPY_AND_ASSIGN(SymbolTable);
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, Symbol::id_t> ids;
+  };
+
+  mutable Shard shards_[shards_count];
+  std::mutex chunks_mutex_;  // ids assignment
+  std::atomic<std::string*> chunks_[max_chunks];
+  std::atomic<Symbol::id_t> size_;
+  std::atomic<size_t> max_size_;
+};
+
+}  // namespace fastotv
+
+namespace std {
+template <>
+struct hash<fastotv::Symbol> {
+  size_t operator()(const fastotv::Symbol& symbol) const { return symbol.GetId(); }
+};
+}  // namespace std
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench_allocs.h"
+
+#include <malloc.h>  // for mallinfo2
+#include <stdlib.h>  // for malloc, free
+
+#include <atomic>
+#include <new>  // for bad_alloc
+
+namespace {
+std::atomic<size_t> allocations_count(0);
+}
+
+void* operator new(size_t size) {
+  allocations_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace fastotv {
+namespace bench {
+
+size_t GetAllocationsCount() {
+  return allocations_count.load(std::memory_order_relaxed);
+}
+
+size_t GetLiveHeapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+void SetPerOpCounters(benchmark::State& state, size_t allocations, size_t bytes) {
+  state.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+  state.counters["bytes/op"] = benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+  state.SetBytesProcessed(bytes);
+}
+
+}  // namespace bench
+}  // namespace fastotv
@@ -0,0 +1,35 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include <benchmark/benchmark.h>
+
+namespace fastotv {
+namespace bench {
+
+size_t GetAllocationsCount();  // operator new calls since start, all threads
+size_t GetLiveHeapBytes();     // malloc in use bytes, 0 if not supported
+
+// allocs/op and bytes/op columns, totals divided by iterations
+void SetPerOpCounters(benchmark::State& state, size_t allocations, size_t bytes);
+
+}  // namespace bench
+}  // namespace fastotv
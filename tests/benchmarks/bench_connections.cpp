@@ -0,0 +1,88 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/socket.h>  // for socketpair
+#include <unistd.h>      // for close
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <common/net/types.h>  // for socket_info
+
+#include "bench_allocs.h"
+
+#include "server/inner/inner_tcp_client.h"
+
+namespace {
+
+// idle viewers soak: authorized connections parked on few channels, nothing in flight
+// all clients share one descriptor, only server side memory measured
+// footprint taken from first pass with names not interned before, later passes reuse slabs and symbols
+void BM_IdleConnections(benchmark::State& state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  static size_t runs = 0;
+  const std::string run = std::to_string(runs++) + "_";
+  const size_t count = state.range(0);
+  const size_t channels_count = 100;
+  const size_t devices_per_user = 2;
+  size_t heap_bytes = 0;
+  bool measured = false;
+  for (auto _ : state) {
+    std::vector<fastotv::server::inner::InnerTcpClient*> clients;
+    clients.reserve(count);
+    const size_t heap_before = fastotv::bench::GetLiveHeapBytes();
+    const size_t slabs_before = fastotv::server::inner::InnerTcpClient::GetReservedBytes();
+    for (size_t i = 0; i < count; ++i) {
+      const std::string user = run + std::to_string(i / devices_per_user);
+      fastotv::server::inner::InnerTcpClient* client =
+          new fastotv::server::inner::InnerTcpClient(nullptr, common::net::socket_info(fds[0]));
+      client->SetServerHostInfo(fastotv::AuthInfo("user" + user + "@example.com", "password",
+                                                  "device" + std::to_string(i % devices_per_user)));
+      client->SetUid("59106ed9457cd9f4c3c0" + user);
+      client->SetCurrentStream(fastotv::Symbol("59106ed9457cd9f4c3c1" + run + std::to_string(i % channels_count)));
+      clients.push_back(client);
+    }
+
+    if (!measured) {  // whole slabs count, only these clients alive
+      const size_t slabs_after = fastotv::server::inner::InnerTcpClient::GetReservedBytes();
+      heap_bytes = fastotv::bench::GetLiveHeapBytes() - heap_before - (slabs_after - slabs_before) + slabs_after;
+      measured = true;
+    }
+
+    state.PauseTiming();
+    for (fastotv::server::inner::InnerTcpClient* client : clients) {
+      delete client;
+    }
+    state.ResumeTiming();
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+  state.counters["connections"] = count;
+  state.counters["heap_bytes/connection"] = static_cast<double>(heap_bytes) / count;
+}
+BENCHMARK(BM_IdleConnections)->Arg(1000)->Arg(10000)->Arg(100000)->ArgNames({"connections"});
+
+}  // namespace
@@ -0,0 +1,404 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>      // for memcpy
+#include <sys/socket.h>  // for socketpair
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <json-c/json_tokener.h>  // for json_tokener_parse
+
+#include <common/sys_byteorder.h>                           // for HostToNet32
+#include <common/text_decoders/compress_snappy_edcoder.h>  // for CompressSnappyEDcoder
+
+#include "bench_allocs.h"
+
+#include "commands_info/channels_info.h"
+#include "commands_info/chat_message.h"
+#include "inner/inner_client.h"
+#include "inner/inner_server_command_seq_parser.h"
+#include "server/chat_message_scanner.h"
+#include "server/commands.h"
+
+extern "C" {
+#include "sds_fasto.h"  // for sdssplitargslong, sdsfreesplitres
+}
+
+namespace {
+
+typedef fastotv::inner::InnerClient::protocoled_size_t protocoled_size_t;
+
+// json like text, compresses like real commands payloads
+std::string MakePayload(size_t size) {
+  static const char pattern[] =
+      "{\"epg\":{\"id\":\"59106ed9457cd9f4c3c0b78f\",\"url\":\"http://example.com:6969/127.ts\","
+      "\"display_name\":\"Alex TV\",\"programs\":[]},\"video\":true,\"audio\":true},";
+  std::string payload;
+  payload.reserve(size);
+  while (payload.size() < size) {
+    payload.append(pattern, std::min(sizeof(pattern) - 1, size - payload.size()));
+  }
+  return payload;
+}
+
+std::string MakeChannelsJson(size_t count) {
+  fastotv::ChannelsInfo channels;
+  for (size_t i = 0; i < count; ++i) {
+    const std::string sid = std::to_string(100000 + i);
+    fastotv::EpgInfo epg(sid, common::uri::Url("http://example.com:6969/" + sid + ".ts"), "Channel " + sid);
+    channels.AddChannel(fastotv::ChannelInfo(epg, true, true));
+  }
+  std::string json;
+  common::Error err = channels.SerializeToString(&json);
+  return err ? std::string() : json;
+}
+
+std::string MakeChatJson() {
+  fastotv::ChatMessage msg("59106ed9457cd9f4c3c0b78f", "atopilski@gmail.com", "Hello, \"how\" is it going?",
+                           fastotv::ChatMessage::MESSAGE);
+  std::string json;
+  common::Error err = msg.SerializeToString(&json);
+  return err ? std::string() : json;
+}
+
+// same layout as InnerClient::WriteMessage, without socket
+void EncodeFrame(const char* data, size_t size, std::string* frame) {
+  const protocoled_size_t message_size = common::HostToNet32(size);
+  frame->resize(sizeof(protocoled_size_t) + size);
+  memcpy(&(*frame)[0], &message_size, sizeof(protocoled_size_t));
+  memcpy(&(*frame)[sizeof(protocoled_size_t)], data, size);
+}
+
+class SeqParser : public fastotv::inner::InnerServerCommandSeqParser {
+ public:
+  using fastotv::inner::InnerServerCommandSeqParser::NextRequestID;
+
+ private:
+  void HandleInnerRequestCommand(fastotv::inner::InnerClient*,
+                                 common::protocols::three_way_handshake::cmd_seq_t,
+                                 int,
+                                 char**) override {}
+  void HandleInnerResponceCommand(fastotv::inner::InnerClient*,
+                                  common::protocols::three_way_handshake::cmd_seq_t,
+                                  int,
+                                  char**) override {}
+  void HandleInnerApproveCommand(fastotv::inner::InnerClient*,
+                                 common::protocols::three_way_handshake::cmd_seq_t,
+                                 int,
+                                 char**) override {}
+};
+
+void PayloadSizes(benchmark::internal::Benchmark* bench) {
+  for (int size : {64, 512, 4096, 32768, 262144}) {
+    bench->Arg(size);
+  }
+  bench->ArgNames({"bytes"});
+}
+
+void FramePayloadSizes(benchmark::internal::Benchmark* bench) {  // compressed should fit MAX_COMMAND_SIZE
+  for (int size : {64, 512, 2048, 8192}) {
+    bench->Arg(size);
+  }
+  bench->ArgNames({"bytes"});
+}
+
+void BM_FrameEncodeRaw(benchmark::State& state) {
+  const std::string payload = MakePayload(state.range(0));
+  std::string frame;
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    EncodeFrame(payload.data(), payload.size(), &frame);
+    bytes += frame.size();
+    benchmark::DoNotOptimize(frame.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_FrameEncodeRaw)->Apply(PayloadSizes);
+
+void BM_FrameEncodeSnappy(benchmark::State& state) {
+  const std::string payload = MakePayload(state.range(0));
+  common::CompressSnappyEDcoder compressor;
+  std::string frame;
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    common::char_buffer_t compressed;
+    common::Error err = compressor.Encode(payload, &compressed);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    EncodeFrame(compressed.data(), compressed.size(), &frame);
+    bytes += frame.size();
+    benchmark::DoNotOptimize(frame.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_FrameEncodeSnappy)->Apply(PayloadSizes);
+
+void BM_FrameDecodeRaw(benchmark::State& state) {
+  const std::string payload = MakePayload(state.range(0));
+  std::string frame;
+  EncodeFrame(payload.data(), payload.size(), &frame);
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    protocoled_size_t message_size;
+    memcpy(&message_size, frame.data(), sizeof(protocoled_size_t));
+    const std::string out(frame.data() + sizeof(protocoled_size_t), common::NetToHost32(message_size));
+    bytes += frame.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_FrameDecodeRaw)->Apply(PayloadSizes);
+
+void BM_FrameDecodeSnappy(benchmark::State& state) {
+  const std::string payload = MakePayload(state.range(0));
+  common::CompressSnappyEDcoder compressor;
+  common::char_buffer_t compressed;
+  common::Error err = compressor.Encode(payload, &compressed);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  std::string frame;
+  EncodeFrame(compressed.data(), compressed.size(), &frame);
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    protocoled_size_t message_size;
+    memcpy(&message_size, frame.data(), sizeof(protocoled_size_t));
+    const common::char_buffer_t in =
+        MAKE_CHAR_BUFFER_SIZE(frame.data() + sizeof(protocoled_size_t), common::NetToHost32(message_size));
+    common::char_buffer_t un_compressed;
+    err = compressor.Decode(in, &un_compressed);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    const std::string out = un_compressed.as_string();
+    bytes += frame.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_FrameDecodeSnappy)->Apply(PayloadSizes);
+
+// InnerClient::Write + ReadCommand through kernel
+void BM_InnerClientRoundTrip(benchmark::State& state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  fastotv::inner::InnerClient writer(nullptr, common::net::socket_info(fds[0]));
+  fastotv::inner::InnerClient reader(nullptr, common::net::socket_info(fds[1]));
+  const common::protocols::three_way_handshake::cmd_response_t resp =
+      fastotv::server::GetChannelsResponceSuccsess("0000000000000001", MakePayload(state.range(0)));
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    common::ErrnoError err = writer.Write(resp);
+    std::string out;
+    if (!err) {
+      err = reader.ReadCommand(&out);
+    }
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      break;
+    }
+    bytes += out.size();
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+  common::ErrnoError errn = writer.Close();
+  DCHECK(!errn) << errn->GetDescription();
+  errn = reader.Close();
+  DCHECK(!errn) << errn->GetDescription();
+}
+BENCHMARK(BM_InnerClientRoundTrip)->Apply(FramePayloadSizes);
+
+void BenchParseCommand(benchmark::State& state, const std::string& command) {
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    common::protocols::three_way_handshake::cmd_id_t seq;
+    common::protocols::three_way_handshake::cmd_seq_t id;
+    std::string cmd_str;
+    common::Error err = common::protocols::three_way_handshake::ParseCommand(command, &seq, &id, &cmd_str);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(cmd_str.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations,
+                                   command.size() * state.iterations());
+}
+
+void BM_ParseCommandPing(benchmark::State& state) {
+  BenchParseCommand(state, fastotv::server::PingRequest("0000000000000001").GetCmd());
+}
+BENCHMARK(BM_ParseCommandPing);
+
+void BM_ParseCommandChat(benchmark::State& state) {
+  BenchParseCommand(state, fastotv::server::ServerSendChatMessageRequest("0000000000000001", MakeChatJson()).GetCmd());
+}
+BENCHMARK(BM_ParseCommandChat);
+
+void BM_ParseCommandChannels(benchmark::State& state) {
+  BenchParseCommand(state,
+                    fastotv::server::GetChannelsResponceSuccsess("0000000000000001", MakeChannelsJson(100)).GetCmd());
+}
+BENCHMARK(BM_ParseCommandChannels);
+
+// tokenizing command tail with quoted json, like HandleInnerDataReceived
+void BenchSplitArgs(benchmark::State& state, const std::string& command) {
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t id;
+  std::string cmd_str;
+  common::Error err = common::protocols::three_way_handshake::ParseCommand(command, &seq, &id, &cmd_str);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    int argc;
+    sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
+    if (!argv) {
+      state.SkipWithError("sdssplitargslong failed");
+      return;
+    }
+    benchmark::DoNotOptimize(argv);
+    sdsfreesplitres(argv, argc);
+  }
+  // sds allocates with malloc, only std allocations counted
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations,
+                                   cmd_str.size() * state.iterations());
+}
+
+void BM_SplitArgsPing(benchmark::State& state) {
+  BenchSplitArgs(state, fastotv::server::PingRequest("0000000000000001").GetCmd());
+}
+BENCHMARK(BM_SplitArgsPing);
+
+void BM_SplitArgsChat(benchmark::State& state) {
+  BenchSplitArgs(state, fastotv::server::ServerSendChatMessageRequest("0000000000000001", MakeChatJson()).GetCmd());
+}
+BENCHMARK(BM_SplitArgsChat);
+
+void BM_SplitArgsChannels(benchmark::State& state) {
+  BenchSplitArgs(state,
+                 fastotv::server::GetChannelsResponceSuccsess("0000000000000001", MakeChannelsJson(100)).GetCmd());
+}
+BENCHMARK(BM_SplitArgsChannels);
+
+void BM_NextRequestID(benchmark::State& state) {
+  SeqParser parser;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    const common::protocols::three_way_handshake::cmd_seq_t id = parser.NextRequestID();
+    benchmark::DoNotOptimize(id.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, 0);
+}
+BENCHMARK(BM_NextRequestID);
+
+void BM_BuildPingRequest(benchmark::State& state) {
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    const common::protocols::three_way_handshake::cmd_request_t req =
+        fastotv::server::PingRequest("0000000000000001");
+    bytes += req.GetCmd().size();
+    benchmark::DoNotOptimize(req.GetCmd().data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_BuildPingRequest);
+
+void BM_BuildChatRequest(benchmark::State& state) {
+  const std::string chat = MakeChatJson();
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    const common::protocols::three_way_handshake::cmd_request_t req =
+        fastotv::server::ServerSendChatMessageRequest("0000000000000001", chat);
+    bytes += req.GetCmd().size();
+    benchmark::DoNotOptimize(req.GetCmd().data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_BuildChatRequest);
+
+void BM_BuildChannelsResponce(benchmark::State& state) {
+  const std::string channels = MakeChannelsJson(state.range(0));
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    const common::protocols::three_way_handshake::cmd_response_t resp =
+        fastotv::server::GetChannelsResponceSuccsess("0000000000000001", channels);
+    bytes += resp.GetCmd().size();
+    benchmark::DoNotOptimize(resp.GetCmd().data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_BuildChannelsResponce)->Arg(10)->Arg(100)->Arg(1000)->ArgNames({"channels"});
+
+// send_chat_message before relay fast path: parse, validate, serialize again
+void BM_ChatRelayParse(benchmark::State& state) {
+  const std::string chat = MakeChatJson();
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    json_object* jmsg = json_tokener_parse(chat.c_str());
+    fastotv::ChatMessage msg;
+    common::Error err = msg.DeSerialize(jmsg);
+    json_object_put(jmsg);
+    std::string ser;
+    if (!err) {
+      err = msg.SerializeToString(&ser);
+    }
+    bytes += ser.size();
+    benchmark::DoNotOptimize(ser.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_ChatRelayParse);
+
+void BM_ChatRelayScan(benchmark::State& state) {
+  const std::string chat = MakeChatJson();
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    fastotv::server::ChatMessageHeader header;
+    const bool res = fastotv::server::ScanChatMessage(chat.data(), chat.size(), &header);
+    bytes += res ? chat.size() : 0;
+    benchmark::DoNotOptimize(header.channel.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+BENCHMARK(BM_ChatRelayScan);
+
+}  // namespace
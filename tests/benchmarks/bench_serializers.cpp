@@ -0,0 +1,189 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>  // for snprintf
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_allocs.h"
+
+#include "commands_info/auth_info.h"
+#include "commands_info/channels_info.h"
+#include "commands_info/chat_message.h"
+#include "commands_info/runtime_channel_info.h"
+#include "server/user_info.h"
+
+namespace {
+
+enum { programs_per_channel = 24, chat_messages_count = 50, programme_duration_msec = 3600 * 1000 };
+
+fastotv::stream_id MakeStreamId(size_t index) {
+  char buff[32];
+  snprintf(buff, sizeof(buff), "%024zx", index);
+  return buff;
+}
+
+fastotv::ChannelsInfo MakeChannels(size_t count, bool with_epg) {
+  fastotv::ChannelsInfo channels;
+  for (size_t i = 0; i < count; ++i) {
+    const fastotv::stream_id sid = MakeStreamId(i);
+    fastotv::EpgInfo epg(sid, common::uri::Url("http://example.com:6969/" + sid + ".ts"),
+                         "Channel " + std::to_string(i));
+    if (with_epg) {
+      fastotv::EpgInfo::programs_t programs;
+      for (size_t j = 0; j < programs_per_channel; ++j) {
+        const fastotv::timestamp_t start = j * programme_duration_msec;
+        programs.push_back(
+            fastotv::ProgrammeInfo(sid, start, start + programme_duration_msec, "Programme " + std::to_string(j)));
+      }
+      epg.SetPrograms(programs);
+    }
+    channels.AddChannel(fastotv::ChannelInfo(epg, true, true));
+  }
+  return channels;
+}
+
+fastotv::ChatMessage MakeChatMessage() {
+  return fastotv::ChatMessage(MakeStreamId(1), "atopilski@gmail.com", "Hello, how is it going?",
+                              fastotv::ChatMessage::MESSAGE);
+}
+
+fastotv::RuntimeChannelInfo MakeRuntimeChannelInfo() {
+  fastotv::RuntimeChannelInfo::messages_t messages(chat_messages_count, MakeChatMessage());
+  return fastotv::RuntimeChannelInfo(MakeStreamId(1), 100, fastotv::OFFICAL_CHANNEL, true, false, messages);
+}
+
+fastotv::server::UserInfo MakeUserInfo() {
+  fastotv::server::UserInfo::devices_t devices = {MakeStreamId(100), MakeStreamId(101)};
+  return fastotv::server::UserInfo("atopilski@gmail.com", "2ae66f90b7788ab8950e8f81b829c947", MakeChannels(100, false),
+                                   devices);
+}
+
+fastotv::AuthInfo MakeAuthInfo() {
+  return fastotv::AuthInfo("atopilski@gmail.com", "2ae66f90b7788ab8950e8f81b829c947", MakeStreamId(100));
+}
+
+template <typename T>
+void BenchSerialize(benchmark::State& state, const T& info) {
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    std::string serialized;
+    common::Error err = info.SerializeToString(&serialized);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    bytes += serialized.size();
+    benchmark::DoNotOptimize(serialized.data());
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+
+// parsing included, like requests read from socket
+template <typename T>
+void BenchDeSerialize(benchmark::State& state, const T& info) {
+  std::string serialized;
+  common::Error err = info.SerializeToString(&serialized);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  size_t bytes = 0;
+  const size_t allocations = fastotv::bench::GetAllocationsCount();
+  for (auto _ : state) {
+    json_object* jobj = nullptr;
+    T result;
+    err = result.SerializeFromString(serialized, &jobj);
+    if (!err) {
+      err = result.DeSerialize(jobj);
+      json_object_put(jobj);
+    }
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    bytes += serialized.size();
+    benchmark::DoNotOptimize(&result);
+  }
+  fastotv::bench::SetPerOpCounters(state, fastotv::bench::GetAllocationsCount() - allocations, bytes);
+}
+
+void ChannelsInfoArgs(benchmark::internal::Benchmark* bench) {
+  for (int epg = 0; epg <= 1; ++epg) {
+    for (int count : {10, 100, 1000, 10000, 50000}) {
+      bench->Args({count, epg});
+    }
+  }
+  bench->ArgNames({"channels", "epg"});
+}
+
+void BM_ChannelsInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeChannels(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_ChannelsInfoSerialize)->Apply(ChannelsInfoArgs)->Unit(benchmark::kMicrosecond);
+
+void BM_ChannelsInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeChannels(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_ChannelsInfoDeSerialize)->Apply(ChannelsInfoArgs)->Unit(benchmark::kMicrosecond);
+
+void BM_UserInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeUserInfo());
+}
+BENCHMARK(BM_UserInfoSerialize);
+
+void BM_UserInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeUserInfo());
+}
+BENCHMARK(BM_UserInfoDeSerialize);
+
+void BM_ChatMessageSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeChatMessage());
+}
+BENCHMARK(BM_ChatMessageSerialize);
+
+void BM_ChatMessageDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeChatMessage());
+}
+BENCHMARK(BM_ChatMessageDeSerialize);
+
+void BM_RuntimeChannelInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeRuntimeChannelInfo());
+}
+BENCHMARK(BM_RuntimeChannelInfoSerialize);
+
+void BM_RuntimeChannelInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeRuntimeChannelInfo());
+}
+BENCHMARK(BM_RuntimeChannelInfoDeSerialize);
+
+void BM_AuthInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeAuthInfo());
+}
+BENCHMARK(BM_AuthInfoSerialize);
+
+void BM_AuthInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeAuthInfo());
+}
+BENCHMARK(BM_AuthInfoDeSerialize);
+
+}  // namespace
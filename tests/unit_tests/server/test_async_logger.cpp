@@ -0,0 +1,42 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include "server/async_logger.h"
+
+TEST(LogSiteLimiter, limit_per_window) {
+  fastotv::server::LogSiteLimiter limiter(2);
+  uint64_t suppressed = 0;
+  size_t allowed = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    if (limiter.Allow(&suppressed)) {
+      allowed++;
+    }
+  }
+
+  // window can roll over during loop
+  ASSERT_GE(allowed, 2u);
+  ASSERT_LE(allowed, 4u);
+}
+
+TEST(LogSiteLimiter, zero_limit) {
+  fastotv::server::LogSiteLimiter limiter(0);
+  uint64_t suppressed = 0;
+  ASSERT_FALSE(limiter.Allow(&suppressed));
+}
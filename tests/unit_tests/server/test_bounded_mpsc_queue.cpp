@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/bounded_mpsc_queue.h"
+
+TEST(BoundedMPSCQueue, push_pop) {
+  fastotv::server::BoundedMPSCQueue<std::string> queue(3);
+  ASSERT_EQ(queue.GetCapacity(), 4);
+
+  std::string value;
+  ASSERT_FALSE(queue.Pop(&value));
+  for (size_t i = 0; i < queue.GetCapacity(); ++i) {
+    ASSERT_TRUE(queue.Push(std::to_string(i)));
+  }
+  ASSERT_FALSE(queue.Push("full"));
+
+  for (size_t i = 0; i < queue.GetCapacity(); ++i) {
+    ASSERT_TRUE(queue.Pop(&value));
+    ASSERT_EQ(value, std::to_string(i));
+  }
+  ASSERT_FALSE(queue.Pop(&value));
+  ASSERT_TRUE(queue.Push("after"));
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(value, "after");
+}
+
+TEST(BoundedMPSCQueue, many_producers) {
+  const size_t producers_count = 4;
+  const size_t items_per_producer = 10000;
+  fastotv::server::BoundedMPSCQueue<size_t> queue(128);
+
+  std::vector<std::thread> producers;
+  for (size_t i = 0; i < producers_count; ++i) {
+    producers.push_back(std::thread([&queue, items_per_producer]() {
+      for (size_t j = 1; j <= items_per_producer; ++j) {
+        while (!queue.Push(j)) {
+          std::this_thread::yield();
+        }
+      }
+    }));
+  }
+
+  size_t sum = 0;
+  size_t received = 0;
+  while (received < producers_count * items_per_producer) {
+    size_t value = 0;
+    if (queue.Pop(&value)) {
+      sum += value;
+      received++;
+    }
+  }
+
+  for (size_t i = 0; i < producers.size(); ++i) {
+    producers[i].join();
+  }
+
+  ASSERT_EQ(sum, producers_count * items_per_producer * (items_per_producer + 1) / 2);
+  size_t value = 0;
+  ASSERT_FALSE(queue.Pop(&value));
+}
@@ -0,0 +1,101 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "server/chat_message_scanner.h"
+
+namespace {
+
+bool Scan(const std::string& json, fastotv::server::ChatMessageHeader* header) {
+  return fastotv::server::ScanChatMessage(json.data(), json.size(), header);
+}
+
+}  // namespace
+
+TEST(ChatMessageScanner, plain) {
+  fastotv::server::ChatMessageHeader header;
+  ASSERT_TRUE(
+      Scan("{\"channel_id\":\"1234\",\"login\":\"atopilski@gmail.com\",\"message\":\"Hello\",\"type\":1}", &header));
+  ASSERT_EQ("1234", header.channel);
+  ASSERT_EQ("atopilski@gmail.com", header.login);
+  ASSERT_EQ(fastotv::ChatMessage::MESSAGE, header.type);
+  ASSERT_EQ(5, header.message_size);
+  ASSERT_FALSE(header.message_escaped);
+
+  const std::string spaced =
+      " { \"type\" : 0 ,\n\"message\" : \"a\\\"b\\u0041\" , \"login\":\"l\", \"channel_id\":\"c\", \"x\":null } ";
+  ASSERT_TRUE(Scan(spaced, &header));
+  ASSERT_EQ("c", header.channel);
+  ASSERT_EQ(fastotv::ChatMessage::CONTROL, header.type);
+  ASSERT_EQ(10, header.message_size);
+  ASSERT_TRUE(header.message_escaped);  // 4 bytes decoded
+
+  ASSERT_TRUE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\"}", &header));  // type optional
+  ASSERT_EQ(fastotv::ChatMessage::CONTROL, header.type);
+}
+
+TEST(ChatMessageScanner, invalid) {
+  fastotv::server::ChatMessageHeader header;
+  ASSERT_FALSE(fastotv::server::ScanChatMessage(nullptr, 0, &header));
+  ASSERT_FALSE(Scan("", &header));
+  ASSERT_FALSE(Scan("{}", &header));
+  ASSERT_FALSE(Scan("{\"login\":\"l\",\"message\":\"m\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"\",\"login\":\"l\",\"message\":\"m\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"message\":\"m\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\",\"type\":7}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\"", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\"} x", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\\q\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\n\"}", &header));
+}
+
+TEST(ChatMessageScanner, fallback) {
+  fastotv::server::ChatMessageHeader header;
+  // valid json, left for full parse
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\\u0031\",\"login\":\"l\",\"message\":\"m\"}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\",\"meta\":{\"a\":1}}", &header));
+  ASSERT_FALSE(Scan("{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\",\"type\":\"1\"}", &header));
+  ASSERT_FALSE(Scan("[\"c\"]", &header));
+}
+
+TEST(ChatMessageScanner, strict_values) {
+  fastotv::server::ChatMessageHeader header;
+  const std::string prefix = "{\"channel_id\":\"c\",\"login\":\"l\",\"message\":\"m\",";
+  ASSERT_TRUE(Scan(prefix + "\"x\":true,\"y\":false,\"z\":null}", &header));
+  ASSERT_TRUE(Scan(prefix + "\"x\":-0,\"y\":12.5e-3,\"z\":0.25E+2}", &header));
+  ASSERT_TRUE(Scan(prefix + "\"type\":0}", &header));
+
+  // barewords and malformed numbers, full parser decides
+  ASSERT_FALSE(Scan(prefix + "\"x\":abc}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":True}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":nullx}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":01}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":1.}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":1e}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":-}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"x\":+1}", &header));
+
+  // leading zeros in type
+  ASSERT_FALSE(Scan(prefix + "\"type\":01}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"type\":-01}", &header));
+  ASSERT_FALSE(Scan(prefix + "\"type\":00}", &header));
+}
@@ -0,0 +1,64 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include "server/inner/external_command.h"
+
+TEST(ExternalCommand, parse) {
+  fastotv::server::inner::ExternalCommand cmd;
+  ASSERT_TRUE(fastotv::server::inner::ParseExternalCommand("user device 7 ping_client", &cmd));
+  ASSERT_EQ("user", cmd.uid);
+  ASSERT_EQ("device", cmd.device_id);
+  ASSERT_EQ("7", cmd.id);
+  ASSERT_EQ("ping_client", cmd.command);
+  ASSERT_EQ("0 7 ping_client\r\n", cmd.input_command);
+  ASSERT_EQ("user device 7 ping_client", cmd.message);
+  ASSERT_TRUE(cmd.stream_entry_id.empty());
+  ASSERT_FALSE(cmd.forwarded);
+
+  ASSERT_TRUE(fastotv::server::inner::ParseExternalCommand("user device 8 send_message '{\"text\": \"a b\"}'", &cmd));
+  ASSERT_EQ("8", cmd.id);
+  ASSERT_EQ("send_message", cmd.command);
+
+  fastotv::server::inner::ExternalCommand untouched;
+  ASSERT_FALSE(fastotv::server::inner::ParseExternalCommand("", &untouched));
+  ASSERT_FALSE(fastotv::server::inner::ParseExternalCommand("user", &untouched));
+  ASSERT_FALSE(fastotv::server::inner::ParseExternalCommand("user device", &untouched));
+  ASSERT_TRUE(untouched.uid.empty());
+}
+
+TEST(ExternalCommand, forwarded) {
+  fastotv::server::inner::ExternalCommand cmd;
+  ASSERT_TRUE(fastotv::server::inner::ParseExternalCommand("user device 7 ping_client", &cmd));
+  ASSERT_EQ("- user device 7 ping_client", fastotv::server::inner::MakeForwardedCommand(cmd));
+  cmd.stream_entry_id = "1526919030474-55";
+  const std::string forwarded = fastotv::server::inner::MakeForwardedCommand(cmd);
+  ASSERT_EQ("1526919030474-55 user device 7 ping_client", forwarded);
+
+  fastotv::server::inner::ExternalCommand owner;
+  ASSERT_TRUE(fastotv::server::inner::ParseForwardedCommand(forwarded, &owner));
+  ASSERT_EQ("1526919030474-55", owner.stream_entry_id);  // acked by owner node
+  ASSERT_EQ("user device 7 ping_client", owner.message);
+  ASSERT_EQ("device", owner.device_id);
+  ASSERT_TRUE(owner.forwarded);
+
+  ASSERT_TRUE(fastotv::server::inner::ParseForwardedCommand("- user device 7 ping_client", &owner));
+  ASSERT_TRUE(owner.stream_entry_id.empty());
+  ASSERT_FALSE(fastotv::server::inner::ParseForwardedCommand("user", &owner));
+}
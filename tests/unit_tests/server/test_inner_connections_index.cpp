@@ -0,0 +1,89 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>  // for uintptr_t
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/inner/inner_connections_index.h"
+
+namespace {
+
+fastotv::server::inner::InnerTcpClient* MakeFakeConnection(uintptr_t id) {  // index never dereferences on lookup
+  return reinterpret_cast<fastotv::server::inner::InnerTcpClient*>(id * 8);
+}
+
+}  // namespace
+
+TEST(InnerConnectionsIndex, insert_find_remove) {
+  fastotv::server::inner::InnerConnectionsIndex index;
+  const fastotv::Symbol uid("index_user");
+  const fastotv::Symbol phone("index_phone");
+  const fastotv::Symbol tv("index_tv");
+  fastotv::server::inner::InnerTcpClient* phone_connection = MakeFakeConnection(1);
+  fastotv::server::inner::InnerTcpClient* tv_connection = MakeFakeConnection(2);
+
+  ASSERT_TRUE(index.Insert(uid, phone, phone_connection));
+  ASSERT_TRUE(index.Insert(uid, tv, tv_connection));
+  ASSERT_FALSE(index.Insert(uid, tv, MakeFakeConnection(3)));  // double connection
+  ASSERT_FALSE(index.Insert(fastotv::Symbol(), tv, tv_connection));
+  ASSERT_EQ(2u, index.GetSize());
+
+  ASSERT_EQ(phone_connection, index.Find("index_user", "index_phone"));
+  ASSERT_EQ(tv_connection, index.Find("index_user", "index_tv"));
+  ASSERT_EQ(nullptr, index.Find("index_user", "index_unknown_device"));
+  ASSERT_EQ(nullptr, index.Find("index_unknown_user", "index_phone"));
+
+  // other devices of user stay online
+  ASSERT_FALSE(index.Remove(uid, phone, tv_connection));
+  ASSERT_TRUE(index.Remove(uid, phone, phone_connection));
+  ASSERT_FALSE(index.Remove(uid, phone, phone_connection));
+  ASSERT_EQ(nullptr, index.Find("index_user", "index_phone"));
+  ASSERT_EQ(tv_connection, index.Find("index_user", "index_tv"));
+  ASSERT_EQ(1u, index.GetSize());
+}
+
+TEST(InnerConnectionsIndex, concurrent_loops) {
+  fastotv::server::inner::InnerConnectionsIndex index;
+  const size_t loops_count = 4;
+  const size_t users_count = 1000;
+  std::vector<std::thread> loops;
+  for (size_t i = 0; i < loops_count; ++i) {
+    loops.push_back(std::thread([i, &index]() {
+      const fastotv::Symbol dev("device_" + std::to_string(i));
+      for (size_t j = 0; j < users_count; ++j) {
+        const std::string user = "concurrent_user_" + std::to_string(j);
+        fastotv::server::inner::InnerTcpClient* connection = MakeFakeConnection(i * users_count + j + 1);
+        ASSERT_TRUE(index.Insert(fastotv::Symbol(user), dev, connection));
+        ASSERT_EQ(connection, index.Find(user, dev.ToString()));
+        if (j % 2) {
+          ASSERT_TRUE(index.Remove(fastotv::Symbol(user), dev, connection));
+        }
+      }
+    }));
+  }
+  for (std::thread& loop : loops) {
+    loop.join();
+  }
+
+  ASSERT_EQ(loops_count * users_count / 2, index.GetSize());
+}
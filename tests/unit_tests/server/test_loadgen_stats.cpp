@@ -0,0 +1,40 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "server/loadgen/loadgen_stats.h"
+
+TEST(LoadgenStats, report) {
+  typedef fastotv::server::loadgen::LoadgenStats LoadgenStats;
+  LoadgenStats stats;
+  stats.RecordSent(LoadgenStats::PING);
+  stats.RecordSent(LoadgenStats::PING);
+  stats.RecordSuccess(LoadgenStats::PING, 2000);
+  stats.RecordFail(LoadgenStats::PING);
+  stats.RecordConnectError();
+
+  const std::string report = stats.ToJson(2);
+  ASSERT_NE(report.find("\"client_ping\""), std::string::npos);
+  ASSERT_NE(report.find("\"succeeded\":1"), std::string::npos);
+  ASSERT_NE(report.find("\"failed_responces\":1"), std::string::npos);
+  ASSERT_NE(report.find("\"connect\":1"), std::string::npos);
+  ASSERT_NE(report.find("\"p99\""), std::string::npos);
+}
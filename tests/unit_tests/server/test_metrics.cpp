@@ -0,0 +1,63 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "server/metrics/metrics.h"
+
+TEST(Histogram, buckets) {
+  typedef fastotv::server::metrics::Histogram Histogram;
+  for (uint64_t value = 0; value < 100000; ++value) {
+    const size_t index = Histogram::GetBucketIndex(value);
+    ASSERT_LE(value, Histogram::GetBucketUpperBound(index));
+    if (index != 0) {
+      ASSERT_GT(value, Histogram::GetBucketUpperBound(index - 1));
+    }
+  }
+  ASSERT_EQ(Histogram::GetBucketIndex(UINT64_MAX), Histogram::buckets_count - 1);
+}
+
+TEST(Histogram, percentile) {
+  fastotv::server::metrics::Histogram histogram;
+  ASSERT_EQ(histogram.GetValueAtPercentile(50), 0u);
+  for (uint64_t value = 1; value <= 100; ++value) {
+    histogram.Record(value);
+  }
+
+  ASSERT_EQ(histogram.GetCount(), 100u);
+  ASSERT_EQ(histogram.GetSum(), 5050u);
+  const uint64_t p50 = histogram.GetValueAtPercentile(50);
+  ASSERT_GE(p50, 50u);
+  ASSERT_LE(p50, 50u + 50u / fastotv::server::metrics::Histogram::sub_buckets_count);
+}
+
+TEST(Registry, render) {
+  fastotv::server::metrics::Registry* registry = fastotv::server::metrics::Registry::GetInstance();
+  fastotv::server::metrics::Counter* counter = registry->GetCounter("test_total", "Test counter.", {{"kind", "a"}});
+  ASSERT_EQ(counter, registry->GetCounter("test_total", "Test counter.", {{"kind", "a"}}));
+  counter->Inc(3);
+  registry->GetHistogram("test_duration_seconds", "Test histogram.")->Record(1500000);
+
+  const std::string text = registry->Render();
+  ASSERT_NE(text.find("# TYPE test_total counter\n"), std::string::npos);
+  ASSERT_NE(text.find("test_total{kind=\"a\"} 3\n"), std::string::npos);
+  ASSERT_NE(text.find("test_duration_seconds_bucket{le=\"+Inf\"} 1\n"), std::string::npos);
+  ASSERT_NE(text.find("test_duration_seconds_sum 1.500000\n"), std::string::npos);
+}
@@ -29,3 +29,9 @@ TEST(commands, parse_commands) {
   common::protocols::three_way_handshake::cmd_request_t ping_req = server::PingRequest(ping_id_seq);
   TestParseRequestComand(ping_req, SERVER_PING);
 }
+
+TEST(commands, chat_messages_batch) {
+  ASSERT_EQ("[]", server::MakeChatMessagesBatch({}));
+  ASSERT_EQ("[{\"a\":1}]", server::MakeChatMessagesBatch({"{\"a\":1}"}));
+  ASSERT_EQ("[{\"a\":1},{\"b\":2}]", server::MakeChatMessagesBatch({"{\"a\":1}", "{\"b\":2}"}));
+}
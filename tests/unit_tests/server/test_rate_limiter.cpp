@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include "server/rate_limiter.h"
+
+TEST(RateLimiter, parse) {
+  fastotv::server::RateLimit limit;
+  ASSERT_TRUE(fastotv::server::ParseRateLimit("2/10", &limit));
+  ASSERT_EQ(2, limit.rate);
+  ASSERT_EQ(10, limit.burst);
+  ASSERT_TRUE(fastotv::server::ParseRateLimit("0.5/3", &limit));
+  ASSERT_EQ(0.5, limit.rate);
+  ASSERT_TRUE(fastotv::server::ParseRateLimit("5", &limit));
+  ASSERT_EQ(5, limit.burst);
+  ASSERT_TRUE(fastotv::server::ParseRateLimit("0", &limit));
+  ASSERT_FALSE(limit.IsEnabled());
+
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("", &limit));
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("fast", &limit));
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("2/", &limit));
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("2/0", &limit));
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("-1/3", &limit));
+  ASSERT_FALSE(fastotv::server::ParseRateLimit("2/10x", &limit));
+}
+
+TEST(RateLimiter, token_bucket) {
+  const fastotv::server::RateLimit limit(2, 3);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  fastotv::server::TokenBucket bucket;
+  ASSERT_TRUE(bucket.IsFull(limit, start));
+  for (size_t i = 0; i < 3; ++i) {  // burst
+    ASSERT_TRUE(bucket.Consume(limit, start));
+  }
+  ASSERT_FALSE(bucket.Consume(limit, start));
+  ASSERT_FALSE(bucket.Consume(limit, start + std::chrono::milliseconds(400)));
+  ASSERT_TRUE(bucket.Consume(limit, start + std::chrono::milliseconds(500)));
+  ASSERT_FALSE(bucket.Consume(limit, start + std::chrono::milliseconds(500)));
+  ASSERT_FALSE(bucket.IsFull(limit, start + std::chrono::seconds(1)));
+  ASSERT_TRUE(bucket.IsFull(limit, start + std::chrono::seconds(10)));
+
+  fastotv::server::TokenBucket unlimited;
+  for (size_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(unlimited.Consume(fastotv::server::RateLimit(), start));
+  }
+}
+
+TEST(RateLimiter, login_buckets) {
+  const fastotv::server::RateLimit limits[fastotv::server::RATE_LIMIT_CLASSES_COUNT] = {
+      fastotv::server::RateLimit(1, 2), fastotv::server::RateLimit(1, 1)};
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const fastotv::Symbol login("rate_limited@fastogt.com");
+  fastotv::server::LoginRateLimiter limiter;
+  ASSERT_TRUE(limiter.Consume(login, fastotv::server::CHAT_RATE_LIMIT, limits[0], start));
+  ASSERT_TRUE(limiter.Consume(login, fastotv::server::CHAT_RATE_LIMIT, limits[0], start));
+  ASSERT_FALSE(limiter.Consume(login, fastotv::server::CHAT_RATE_LIMIT, limits[0], start));
+  ASSERT_TRUE(limiter.Consume(login, fastotv::server::CHANNELS_RATE_LIMIT, limits[1], start));  // other class
+  ASSERT_TRUE(limiter.Consume(fastotv::Symbol("other@fastogt.com"), fastotv::server::CHAT_RATE_LIMIT, limits[0],
+                              start));
+  ASSERT_EQ(2u, limiter.GetSize());
+
+  limiter.Prune(limits, start);
+  ASSERT_EQ(2u, limiter.GetSize());
+  limiter.Prune(limits, start + std::chrono::seconds(10));
+  ASSERT_EQ(0u, limiter.GetSize());
+}
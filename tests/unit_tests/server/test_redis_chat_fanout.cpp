@@ -0,0 +1,89 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "server/redis/redis_chat_fanout.h"
+
+namespace {
+
+class RecordHandler : public fastotv::server::redis::RedisChatFanoutHandler {
+ public:
+  void HandleChatFrame(const std::string& sid, const std::vector<std::string>& messages) override {
+    sids.push_back(sid);
+    frames.push_back(messages);
+  }
+
+  std::vector<std::string> sids;
+  std::vector<std::vector<std::string>> frames;
+};
+
+fastotv::server::redis::RedisSubConfig MakeConfig() {
+  fastotv::server::redis::RedisSubConfig config;
+  config.channel_chat_prefix = "CHAT_";
+  return config;
+}
+
+}  // namespace
+
+TEST(RedisChatFanout, handle_frame) {
+  RecordHandler handler;
+  fastotv::server::redis::RedisChatFanout fanout(&handler);
+  fanout.SetConfig(MakeConfig(), "node1");
+
+  fanout.HandleFrame("CHAT_sid", "node2\n{\"a\":1}\n{\"b\":2}");
+  ASSERT_EQ(1u, handler.frames.size());
+  ASSERT_EQ("sid", handler.sids[0]);
+  const std::vector<std::string> expected = {"{\"a\":1}", "{\"b\":2}"};
+  ASSERT_EQ(expected, handler.frames[0]);
+
+  fanout.HandleFrame("CHAT_sid", "node1\n{\"a\":1}");  // own frame
+  fanout.HandleFrame("CHAT_sid", "node10\n{\"a\":1}");
+  ASSERT_EQ(2u, handler.frames.size());  // prefix of other node id is not own
+  fanout.HandleFrame("CHAT_sid", "node2");      // without messages
+  fanout.HandleFrame("OTHER_sid", "node2\nm");  // not chat channel
+  ASSERT_EQ(2u, handler.frames.size());
+
+  fanout.HandleFrame("CHAT_sid", "node2\n\nm");
+  const std::vector<std::string> with_empty = {"", "m"};
+  ASSERT_EQ(with_empty, handler.frames[2]);
+}
+
+TEST(RedisChatFanout, publish_drops_oldest) {
+  typedef fastotv::server::redis::RedisChatFanout fanout_t;
+  fanout_t fanout(nullptr);
+  fanout.SetConfig(MakeConfig(), "node1");
+  const size_t dropped = 10;
+  for (size_t i = 0; i < fanout_t::max_pending_messages + dropped; ++i) {
+    fanout.Publish("sid", std::to_string(i));
+  }
+  fanout.Publish("other", "x");
+
+  const fanout_t::frames_t frames = fanout.PrepareFrames();
+  ASSERT_EQ(fanout_t::max_pending_messages / fanout_t::max_frame_messages + 1, frames.size());
+  ASSERT_EQ("CHAT_other", frames[0].first);
+  ASSERT_EQ("node1\nx", frames[0].second);
+  ASSERT_EQ("CHAT_sid", frames[1].first);
+  ASSERT_EQ(0u, frames[1].second.find("node1\n" + std::to_string(dropped) + "\n"));
+  const std::string last = "\n" + std::to_string(fanout_t::max_pending_messages + dropped - 1);
+  ASSERT_EQ(frames.back().second.size() - last.size(), frames.back().second.rfind(last));
+  ASSERT_TRUE(fanout.PrepareFrames().empty());
+}
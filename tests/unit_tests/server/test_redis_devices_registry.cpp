@@ -0,0 +1,70 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <common/time.h>  // for current_utc_mstime
+
+#include "server/redis/redis_devices_registry.h"
+
+TEST(RedisDevicesRegistry, cached_leases) {
+  typedef fastotv::server::redis::RedisDevicesRegistry registry_t;
+  registry_t registry(nullptr);
+  registry.SetConfig(fastotv::server::redis::RedisSubConfig(), "node1");
+  const common::time64_t now = common::time::current_utc_mstime() / 1000;
+  const common::time64_t lapsed = now + registry_t::lease_ttl_sec + 1;
+
+  std::string node;
+  registry.ApplyChange("+ node2 user device");
+  ASSERT_TRUE(registry.FindNode("user", "device", &node));
+  ASSERT_EQ("node2", node);
+  ASSERT_FALSE(registry.FindNode("user", "device", lapsed, &node));  // crashed owner
+
+  registry.ApplyChange("~ node2 " + std::to_string(lapsed + registry_t::lease_ttl_sec));
+  ASSERT_TRUE(registry.FindNode("user", "device", lapsed, &node));
+  registry.ApplyChange("~ node2 " + std::to_string(now));  // late heartbeat never shortens lease
+  ASSERT_TRUE(registry.FindNode("user", "device", lapsed, &node));
+
+  registry.ApplyChange("- node3 user device");  // not owner
+  ASSERT_TRUE(registry.FindNode("user", "device", &node));
+  registry.ApplyChange("- node2 user device");
+  ASSERT_FALSE(registry.FindNode("user", "device", &node));
+
+  registry.ApplyChange("+ node1 user device");  // own changes already applied
+  ASSERT_FALSE(registry.FindNode("user", "device", &node));
+  registry.ApplyChange("~");
+  registry.ApplyChange("+ node2");
+  ASSERT_FALSE(registry.FindNode("user", "device", &node));
+}
+
+TEST(RedisDevicesRegistry, coalesced_updates) {
+  fastotv::server::redis::RedisDevicesRegistry registry(nullptr);
+  registry.SetConfig(fastotv::server::redis::RedisSubConfig(), "node1");
+  for (size_t i = 0; i < 1000; ++i) {  // flapping device during redis outage
+    registry.Register("user", "device");
+    registry.UnRegister("user", "device");
+  }
+  registry.Register("user", "device2");
+  ASSERT_EQ(2u, registry.GetPendingUpdatesCount());
+
+  registry.Stop();
+  registry.UnRegister("user", "device3");  // writer exited
+  ASSERT_EQ(2u, registry.GetPendingUpdatesCount());
+}
@@ -0,0 +1,193 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>  // for SIZE_MAX
+#include <string.h>  // for memset
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <hiredis/hiredis.h>  // for redisReply
+
+#include "server/redis/redis_connect.h"
+#include "server/redis/redis_stream_consumer.h"
+
+namespace {
+
+class RecordHandler : public fastotv::server::redis::RedisStreamHandler {
+ public:
+  RecordHandler() : entries(), capacity(SIZE_MAX) {}
+
+  bool HandleStreamEntry(const std::string& stream, const std::string& entry_id, const std::string& msg) override {
+    UNUSED(stream);
+    if (entries.size() == capacity) {
+      return false;
+    }
+
+    entries.push_back(entry_id + " " + msg);
+    return true;
+  }
+
+  std::vector<std::string> entries;
+  size_t capacity;
+};
+
+// XREADGROUP replies without server
+class ReplyBuilder {
+ public:
+  redisReply* String(const std::string& str) {
+    strings_.push_back(str);
+    redisReply* reply = Make(REDIS_REPLY_STRING);
+    reply->str = &strings_.back()[0];
+    reply->len = strings_.back().size();
+    return reply;
+  }
+
+  redisReply* Nil() { return Make(REDIS_REPLY_NIL); }
+
+  redisReply* Array(const std::vector<redisReply*>& elements) {
+    arrays_.push_back(elements);
+    redisReply* reply = Make(REDIS_REPLY_ARRAY);
+    reply->element = arrays_.back().data();
+    reply->elements = arrays_.back().size();
+    return reply;
+  }
+
+  redisReply* Entry(const std::string& id, const std::string& msg) {
+    return Array({String(id), Array({String("msg"), String(msg)})});
+  }
+
+  redisReply* Read(const std::vector<redisReply*>& entries) { return Array({Array({String("in"), Array(entries)})}); }
+
+ private:
+  redisReply* Make(int type) {
+    redisReply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type = type;
+    replies_.push_back(reply);
+    return &replies_.back();
+  }
+
+  std::list<std::string> strings_;
+  std::list<std::vector<redisReply*>> arrays_;
+  std::list<redisReply> replies_;
+};
+
+}  // namespace
+
+TEST(RedisStreamConsumer, pending_first_replay) {
+  RecordHandler handler;
+  fastotv::server::redis::RedisStreamConsumer consumer(&handler);
+  ReplyBuilder builder;
+  std::string last_id = "0";
+  ASSERT_EQ(2u, consumer.HandleReply(builder.Read({builder.Entry("1-0", "a"), builder.Entry("2-0", "b")}), &last_id));
+  ASSERT_EQ("2-0", last_id);  // next pending page
+  ASSERT_EQ(1u, consumer.HandleReply(builder.Read({builder.Entry("3-0", "c")}), &last_id));
+  ASSERT_EQ("3-0", last_id);
+  ASSERT_EQ(0u, consumer.HandleReply(builder.Read({}), &last_id));
+  ASSERT_EQ(">", last_id);  // pending drained, only new
+  ASSERT_EQ(1u, consumer.HandleReply(builder.Read({builder.Entry("4-0", "d")}), &last_id));
+  ASSERT_EQ(">", last_id);
+  ASSERT_EQ(0u, consumer.HandleReply(builder.Nil(), &last_id));  // block timeout
+  ASSERT_EQ(">", last_id);
+
+  const std::vector<std::string> expected = {"1-0 a", "2-0 b", "3-0 c", "4-0 d"};
+  ASSERT_EQ(expected, handler.entries);
+}
+
+TEST(RedisStreamConsumer, deleted_pending_entries_acked) {
+  RecordHandler handler;
+  fastotv::server::redis::RedisStreamConsumer consumer(&handler);
+  ReplyBuilder builder;
+  std::string last_id = "0";
+  redisReply* deleted = builder.Array({builder.String("1-0"), builder.Nil()});
+  ASSERT_EQ(2u, consumer.HandleReply(builder.Read({deleted, builder.Entry("2-0", "b")}), &last_id));
+  ASSERT_EQ(1u, handler.entries.size());
+  const std::vector<std::string> acks = {"1-0"};
+  ASSERT_EQ(acks, consumer.PrepareAcks());
+}
+
+TEST(RedisStreamConsumer, busy_handler_entries_stay_pending) {
+  RecordHandler handler;
+  fastotv::server::redis::RedisStreamConsumer consumer(&handler);
+  ReplyBuilder builder;
+  std::string last_id = ">";
+  handler.capacity = 1;
+  ASSERT_EQ(1u, consumer.HandleReply(builder.Read({builder.Entry("1-0", "a"), builder.Entry("2-0", "b")}), &last_id));
+  ASSERT_TRUE(consumer.IsHandlerBusy());
+  ASSERT_EQ("1-0", last_id);  // 2-0 delivered but refused, read again from pending list
+  ASSERT_TRUE(consumer.PrepareAcks().empty());
+
+  ASSERT_EQ(0u, consumer.HandleReply(builder.Read({builder.Entry("2-0", "b")}), &last_id));
+  ASSERT_TRUE(consumer.IsHandlerBusy());
+  ASSERT_EQ("1-0", last_id);  // still busy, don't switch to new entries
+
+  handler.capacity = SIZE_MAX;
+  ASSERT_EQ(1u, consumer.HandleReply(builder.Read({builder.Entry("2-0", "b")}), &last_id));
+  ASSERT_FALSE(consumer.IsHandlerBusy());
+  ASSERT_EQ("2-0", last_id);
+  ASSERT_EQ(0u, consumer.HandleReply(builder.Read({}), &last_id));
+  ASSERT_EQ(">", last_id);
+
+  const std::vector<std::string> expected = {"1-0 a", "2-0 b"};
+  ASSERT_EQ(expected, handler.entries);
+}
+
+TEST(RedisStreamConsumer, busy_handler_first_entry) {
+  RecordHandler handler;
+  fastotv::server::redis::RedisStreamConsumer consumer(&handler);
+  ReplyBuilder builder;
+  std::string last_id = ">";
+  handler.capacity = 0;
+  ASSERT_EQ(0u, consumer.HandleReply(builder.Read({builder.Entry("5-0", "a")}), &last_id));
+  ASSERT_EQ("0", last_id);  // nothing taken yet, whole pending list
+}
+
+TEST(RedisStreamConsumer, ack_batching) {
+  fastotv::server::redis::RedisStreamConsumer consumer(nullptr);
+  ASSERT_TRUE(consumer.PrepareAcks().empty());
+  const size_t total = fastotv::server::redis::RedisStreamConsumer::ack_batch_size + 10;
+  for (size_t i = 0; i < total; ++i) {
+    ASSERT_TRUE(consumer.Ack(std::to_string(i) + "-0"));
+  }
+
+  const std::vector<std::string> batch = consumer.PrepareAcks();
+  ASSERT_EQ(static_cast<size_t>(fastotv::server::redis::RedisStreamConsumer::ack_batch_size), batch.size());
+  ASSERT_EQ("0-0", batch.front());
+  ASSERT_EQ(batch, consumer.PrepareAcks());  // not sent, kept for retry
+}
+
+TEST(RedisStreamConsumer, reconnect_backoff) {
+  fastotv::server::redis::ReconnectBackoff backoff;
+  ASSERT_EQ(static_cast<unsigned>(fastotv::server::redis::ReconnectBackoff::min_delay_msec), backoff.GetDelay());
+  backoff.Failed();
+  ASSERT_EQ(2u * fastotv::server::redis::ReconnectBackoff::min_delay_msec, backoff.GetDelay());
+  for (size_t i = 0; i < 20; ++i) {
+    backoff.Failed();
+  }
+  ASSERT_EQ(static_cast<unsigned>(fastotv::server::redis::ReconnectBackoff::max_delay_msec), backoff.GetDelay());
+  backoff.Reset();
+  ASSERT_EQ(static_cast<unsigned>(fastotv::server::redis::ReconnectBackoff::min_delay_msec), backoff.GetDelay());
+
+  std::atomic<bool> stop(true);
+  backoff.Wait(stop);  // no sleep when stopped
+  ASSERT_EQ(2u * fastotv::server::redis::ReconnectBackoff::min_delay_msec, backoff.GetDelay());
+}
@@ -0,0 +1,73 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "server/redis/redis_watchers_counter.h"
+
+TEST(RedisWatchersCounter, reconnect_until_stop) {
+  fastotv::server::redis::RedisSubConfig config;
+  config.redis_host = common::net::HostAndPort("127.0.0.1", 1);  // nobody listens
+  config.watchers_prefix = "WATCHERS_";
+  fastotv::server::redis::RedisWatchersCounter counter;
+  counter.SetConfig(config, "node1");
+
+  std::atomic<bool> finished(false);
+  std::thread listen([&counter, &finished]() {
+    counter.Listen();
+    finished = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_FALSE(finished);  // still retrying
+
+  counter.AddUniqueViewer("sid", "viewer");
+  ASSERT_EQ(0u, counter.GetStreamStat("sid").watchers);
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  counter.Stop();
+  listen.join();
+  ASSERT_TRUE(finished);
+  ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(RedisWatchersCounter, snapshot_of_other_nodes) {
+  typedef fastotv::server::redis::RedisWatchersCounter counter_t;
+  std::map<std::string, counter_t::counters_t> nodes;
+  nodes["node1"] = {{"sid1", 5}, {"sid3", 4}};  // own, already counted by loops
+  nodes["node2"] = {{"sid1", 2}, {"sid2", 1}};
+  nodes["node3"] = {{"sid1", 3}};
+  nodes["node4"] = {};  // alive without watchers
+  const counter_t::counters_t uniques = {{"sid1", 7}, {"sid3", 4}};
+
+  const counter_t::snapshot_t snapshot = counter_t::MakeSnapshot("node1", nodes, uniques);
+  ASSERT_EQ(3u, snapshot.size());
+  ASSERT_EQ(5u, snapshot.at("sid1").watchers);
+  ASSERT_EQ(7u, snapshot.at("sid1").unique_viewers);
+  ASSERT_EQ(1u, snapshot.at("sid2").watchers);
+  ASSERT_EQ(0u, snapshot.at("sid2").unique_viewers);  // not watched here, not counted
+  ASSERT_EQ(0u, snapshot.at("sid3").watchers);
+  ASSERT_EQ(4u, snapshot.at("sid3").unique_viewers);
+
+  ASSERT_TRUE(counter_t::MakeSnapshot("node1", {{"node1", {{"sid1", 5}}}}, {}).empty());
+}
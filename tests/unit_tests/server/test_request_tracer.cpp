@@ -0,0 +1,54 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "server/metrics/request_tracer.h"
+
+TEST(RequestTracer, spans) {
+  fastotv::server::metrics::RequestTracer* tracer = fastotv::server::metrics::RequestTracer::GetInstance();
+  {
+    fastotv::server::metrics::ScopedSpan span(nullptr, "1", "disabled");
+  }
+  ASSERT_EQ(tracer->ExportChromeTrace().find("disabled"), std::string::npos);
+
+  tracer->Enable(2);
+  {
+    fastotv::server::metrics::ScopedSpan span(nullptr, "7", "dispatch");
+    fastotv::server::metrics::ScopedSpan nested("redis", "find_user");
+  }
+
+  std::string trace = tracer->ExportChromeTrace();
+  ASSERT_NE(trace.find("\"dispatch\""), std::string::npos);
+  ASSERT_NE(trace.find("\"redis\""), std::string::npos);
+  ASSERT_NE(trace.find("\"find_user\""), std::string::npos);
+  ASSERT_NE(trace.find("external request 7"), std::string::npos);
+
+  tracer->Begin(nullptr, "8", "device");
+  tracer->End(nullptr, "8", "device");
+  tracer->End(nullptr, "8", "device");  // not opened
+  trace = tracer->ExportChromeTrace();
+  ASSERT_EQ(trace.find("\"redis\""), std::string::npos);  // ring of 2 spans
+  ASSERT_NE(trace.find("\"dispatch\""), std::string::npos);
+  ASSERT_NE(trace.find("\"device\""), std::string::npos);
+  ASSERT_NE(trace.find("external request 8"), std::string::npos);
+  tracer->Enable(0);
+  ASSERT_FALSE(tracer->IsEnabled());
+}
@@ -0,0 +1,257 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>   // for inet_pton
+#include <netinet/in.h>  // for sockaddr_in
+#include <poll.h>        // for poll
+#include <sys/socket.h>  // for socket, connect
+#include <unistd.h>      // for close
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/redis/redis_pub_sub.h"
+#include "server/redis/redis_storage.h"
+#include "server/resp/resp_protocol.h"
+#include "server/resp/resp_server.h"
+
+namespace {
+
+int ConnectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// reads until expected size or timeout
+std::string Request(int fd, const std::string& request, size_t expected) {
+  if (!request.empty()) {
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  }
+
+  std::string result;
+  while (result.size() < expected) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 2000) <= 0) {
+      break;
+    }
+
+    char buff[1024];
+    ssize_t res = recv(fd, buff, sizeof(buff), 0);
+    if (res <= 0) {
+      break;
+    }
+    result.append(buff, res);
+  }
+  return result;
+}
+
+class MessagesHandler : public fastotv::server::redis::RedisSubHandler {
+ public:
+  void HandleMessage(const std::string& channel, const std::string& msg) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    messages_.push_back(channel + ":" + msg);
+  }
+
+  std::vector<std::string> GetMessages() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return messages_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::string> messages_;
+};
+
+class RespServerTest : public ::testing::Test {
+ protected:
+  RespServerTest() : server_(common::net::HostAndPort("127.0.0.1", 0)) {}
+
+  void SetUp() override {
+    ASSERT_FALSE(server_.Bind());
+    thread_ = std::thread([this]() { server_.Serve(); });
+  }
+
+  void TearDown() override {
+    server_.Stop();
+    thread_.join();
+  }
+
+  fastotv::server::resp::RespServer server_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+TEST(RespProtocol, parse) {
+  using namespace fastotv::server::resp;
+  size_t consumed = 0;
+  std::vector<std::string> args;
+  const std::string request = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$5\r\nvalue\r\n";
+  ASSERT_EQ(PARSE_NEED_MORE, ParseRequest(request.substr(0, 10), &consumed, &args));
+  ASSERT_EQ(PARSE_OK, ParseRequest(request, &consumed, &args));
+  ASSERT_EQ(request.size(), consumed);
+  ASSERT_EQ(3u, args.size());
+  ASSERT_EQ("value", args[2]);
+
+  ASSERT_EQ(PARSE_OK, ParseRequest("PING hello\r\n", &consumed, &args));
+  ASSERT_EQ(2u, args.size());
+  ASSERT_EQ(PARSE_ERROR, ParseRequest("*x\r\n", &consumed, &args));
+}
+
+TEST_F(RespServerTest, strings_and_hashes) {
+  int fd = ConnectTo(server_.GetHost().GetPort());
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ("+OK\r\n", Request(fd, "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n", 5));
+  ASSERT_EQ("$5\r\nvalue\r\n", Request(fd, "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n", 11));
+  ASSERT_EQ("$-1\r\n", Request(fd, "*2\r\n$3\r\nGET\r\n$7\r\nmissing\r\n", 5));
+  ASSERT_EQ(":1\r\n", Request(fd, "HSET user login alex\r\n", 4));
+  ASSERT_EQ("$4\r\nalex\r\n", Request(fd, "HGET user login\r\n", 10));
+  server_.SetValue("preset", "1");
+  ASSERT_EQ("$1\r\n1\r\n", Request(fd, "GET preset\r\n", 7));
+  close(fd);
+}
+
+TEST_F(RespServerTest, publish_subscribe) {
+  const uint16_t port = server_.GetHost().GetPort();
+  int sub = ConnectTo(port);
+  int pub = ConnectTo(port);
+  ASSERT_NE(-1, sub);
+  ASSERT_NE(-1, pub);
+  const std::string subscribed = "*3\r\n$9\r\nsubscribe\r\n$4\r\nchat\r\n:1\r\n";
+  ASSERT_EQ(subscribed, Request(sub, "SUBSCRIBE chat\r\n", subscribed.size()));
+  ASSERT_EQ(":1\r\n", Request(pub, "PUBLISH chat hi\r\n", 4));
+  const std::string message = "*3\r\n$7\r\nmessage\r\n$4\r\nchat\r\n$2\r\nhi\r\n";
+  ASSERT_EQ(message, Request(sub, std::string(), message.size()));
+  close(sub);
+  close(pub);
+}
+
+TEST_F(RespServerTest, faults) {
+  fastotv::server::resp::RespFaults faults;
+  faults.error_every = 2;
+  server_.SetFaults(faults);
+  int fd = ConnectTo(server_.GetHost().GetPort());
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ("+PONG\r\n", Request(fd, "PING\r\n", 7));
+  ASSERT_EQ("-ERR injected fault\r\n", Request(fd, "PING\r\n", 21));
+
+  faults.error_every = 0;
+  faults.drop_every = 3;
+  server_.SetFaults(faults);
+  ASSERT_EQ(std::string(), Request(fd, "PING\r\n", 7));
+  ASSERT_EQ(3u, server_.GetCommandsCount());
+  close(fd);
+}
+
+TEST_F(RespServerTest, latency_per_connection) {
+  fastotv::server::resp::RespFaults faults;
+  faults.latency_msec = 300;
+  server_.SetFaults(faults);
+  const uint16_t port = server_.GetHost().GetPort();
+  int slow = ConnectTo(port);
+  int fast = ConnectTo(port);
+  ASSERT_NE(-1, slow);
+  ASSERT_NE(-1, fast);
+  const std::string pipeline = "PING\r\nPING\r\nPING\r\nPING\r\nPING\r\n";
+  send(slow, pipeline.data(), pipeline.size(), MSG_NOSIGNAL);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));  // pipeline read first
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  ASSERT_EQ("+PONG\r\n", Request(fast, "PING\r\n", 7));
+  const auto fast_msec =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  ASSERT_GE(fast_msec, 250);
+  ASSERT_LT(fast_msec, 1000);  // not queued behind 1.5 seconds of the slow connection answers
+
+  std::string answers;
+  for (int i = 0; i < 5; ++i) {
+    answers += "+PONG\r\n";
+  }
+  ASSERT_EQ(answers, Request(slow, std::string(), answers.size()));
+  close(slow);
+  close(fast);
+}
+
+TEST_F(RespServerTest, redis_storage) {
+  server_.SetValue("alex", "{\"id\":\"5b1\",\"login\":\"alex\",\"password\":\"secret\",\"devices\":[\"tv\"]}");
+  server_.SetValue("chat_channels", "[\"1\",\"2\"]");
+
+  fastotv::server::redis::RedisConfig config;
+  config.redis_host = server_.GetHost();
+  fastotv::server::redis::RedisStorage storage;
+  storage.SetConfig(config);
+
+  fastotv::server::user_id_t uid;
+  fastotv::server::UserInfo user;
+  ASSERT_FALSE(storage.FindUser(fastotv::AuthInfo("alex", "secret", "tv"), &uid, &user));
+  ASSERT_EQ("5b1", uid);
+  ASSERT_TRUE(user.HaveDevice("tv"));
+  ASSERT_TRUE(storage.FindUser(fastotv::AuthInfo("alex", "wrong", "tv"), &uid, &user));
+
+  std::vector<fastotv::stream_id> channels;
+  ASSERT_FALSE(storage.GetChatChannels(&channels));
+  ASSERT_EQ(2u, channels.size());
+  ASSERT_EQ("2", channels[1]);
+
+  fastotv::server::resp::RespFaults faults;
+  faults.error_every = 1;
+  server_.SetFaults(faults);
+  ASSERT_TRUE(storage.FindUserAuth(fastotv::AuthInfo("alex", "secret", "tv"), &uid));
+}
+
+TEST_F(RespServerTest, redis_pub_sub) {
+  fastotv::server::redis::RedisSubConfig config;
+  config.redis_host = server_.GetHost();
+  config.channel_in = "commands_in";
+  config.channel_out = "commands_out";
+  MessagesHandler handler;
+  fastotv::server::redis::RedisPubSub sub(&handler);
+  sub.SetConfig(config);
+  std::thread listener([&sub]() { sub.Listen(); });
+
+  fastotv::server::redis::RedisPubSub pub(nullptr);
+  pub.SetConfig(config);
+  size_t receivers = 0;
+  for (int i = 0; i < 100 && !receivers; ++i) {  // until subscribed
+    ASSERT_FALSE(pub.Publish(config.channel_in, "ping", &receivers));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(1u, receivers);
+  ASSERT_FALSE(pub.PublishToChannelOut("nobody"));
+
+  for (int i = 0; i < 100 && handler.GetMessages().empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(std::vector<std::string>({"commands_in:ping"}), handler.GetMessages());
+
+  server_.Stop();  // listener wakes up on closed connection
+  listener.join();
+}
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "server/slab_allocator.h"
+
+TEST(SlabAllocator, reuse_blocks) {
+  fastotv::server::SlabAllocator<40, 4> allocator;
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < 6; ++i) {
+    void* block = allocator.Allocate();
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(block) % alignof(max_align_t));
+    blocks.push_back(block);
+  }
+  ASSERT_EQ(6u, std::set<void*>(blocks.begin(), blocks.end()).size());
+  ASSERT_EQ(6u, allocator.GetAllocatedCount());
+  ASSERT_EQ(2u, allocator.GetSlabsCount());
+
+  allocator.Deallocate(blocks[3]);
+  ASSERT_EQ(blocks[3], allocator.Allocate());  // last freed reused first
+  for (void* block : blocks) {
+    allocator.Deallocate(block);
+  }
+  ASSERT_EQ(0u, allocator.GetAllocatedCount());
+  ASSERT_EQ(2u, allocator.GetSlabsCount());
+  const size_t block_size = (40 + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+  ASSERT_EQ(2u * 4 * block_size, allocator.GetReservedBytes());  // kept after free
+}
@@ -0,0 +1,87 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>  // for remove
+
+#include <string>
+
+#include "server/capture/traffic_capture.h"
+
+TEST(TrafficCapture, record_and_read) {
+  typedef fastotv::server::capture::CaptureRecord CaptureRecord;
+  const std::string path = "/tmp/fastotv_test_capture.bin";
+  int first, second;
+  {
+    fastotv::server::capture::TrafficCapture capture(path);
+    ASSERT_FALSE(capture.Start(16));
+    capture.RecordFrame(&first, "0 0000000000000001 client_ping");
+    capture.RecordFrame(&second, "1 0000000000000002 OK who_are_you '{}'");
+    capture.RecordClosed(&first);
+    capture.RecordFrame(&first, "0 0000000000000003 get_channels");  // reused address is new connection
+    capture.Stop();
+    ASSERT_EQ(0u, capture.GetDroppedCount());
+  }
+
+  fastotv::server::capture::TrafficCaptureReader reader;
+  ASSERT_FALSE(reader.Open(path));
+  CaptureRecord records[4];
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(reader.Next(&records[i]));
+  }
+  CaptureRecord last;
+  ASSERT_FALSE(reader.Next(&last));
+
+  ASSERT_EQ(CaptureRecord::FRAME, records[0].type);
+  ASSERT_EQ(0u, records[0].connection);
+  ASSERT_EQ("0 0000000000000001 client_ping", records[0].frame);
+  ASSERT_EQ(1u, records[1].connection);
+  ASSERT_EQ(CaptureRecord::CLOSED, records[2].type);
+  ASSERT_EQ(0u, records[2].connection);
+  ASSERT_TRUE(records[2].frame.empty());
+  ASSERT_EQ(2u, records[3].connection);
+  ASSERT_LE(records[0].timestamp_usec, records[3].timestamp_usec);
+  remove(path.c_str());
+}
+
+TEST(TrafficCapture, not_capture_file) {
+  const std::string path = "/tmp/fastotv_test_not_capture.bin";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file);
+  fputs("garbage!", file);
+  fclose(file);
+
+  fastotv::server::capture::TrafficCaptureReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  remove(path.c_str());
+}
+
+TEST(TrafficCapture, passwords_masked) {
+  std::string frame =
+      "1 0000000000000002 OK who_are_you '{\"login\":\"l\",\"password\" : \"se\\\"cret\",\"device_id\":\"d\"}'";
+  ASSERT_TRUE(fastotv::server::capture::ReplacePasswords(&frame, fastotv::server::capture::kMaskedPassword));
+  ASSERT_EQ("1 0000000000000002 OK who_are_you '{\"login\":\"l\",\"password\" : \"***\",\"device_id\":\"d\"}'", frame);
+  ASSERT_TRUE(fastotv::server::capture::ReplacePasswords(&frame, "replayed"));
+  ASSERT_EQ("1 0000000000000002 OK who_are_you '{\"login\":\"l\",\"password\" : \"replayed\",\"device_id\":\"d\"}'",
+            frame);
+
+  std::string other = "0 0000000000000003 send_chat_message '{\"message\":\"password\"}'";
+  ASSERT_FALSE(fastotv::server::capture::ReplacePasswords(&other, "x"));
+  ASSERT_EQ("0 0000000000000003 send_chat_message '{\"message\":\"password\"}'", other);
+}
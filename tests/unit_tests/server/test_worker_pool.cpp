@@ -0,0 +1,49 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "server/worker_pool.h"
+
+TEST(WorkerPool, post_before_start) {
+  fastotv::server::WorkerPool pool(2, 16);
+  ASSERT_FALSE(pool.Post([]() {}));
+}
+
+TEST(WorkerPool, execute_tasks) {
+  const size_t tasks_count = 100;
+  fastotv::server::WorkerPool pool(4, tasks_count);
+  pool.Start();
+
+  std::atomic<size_t> executed(0);
+  for (size_t i = 0; i < tasks_count; ++i) {
+    ASSERT_TRUE(pool.Post([&executed]() { executed++; }));
+  }
+
+  for (size_t i = 0; i < 1000 && executed != tasks_count; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  pool.Stop();
+
+  ASSERT_EQ(executed, tasks_count);
+  ASSERT_FALSE(pool.Post([]() {}));
+}
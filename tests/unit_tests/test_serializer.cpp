@@ -5,6 +5,7 @@
 #include "commands_info/channels_info.h"
 #include "commands_info/client_info.h"
 #include "commands_info/ping_info.h"
+#include "commands_info/presence_info.h"
 #include "commands_info/runtime_channel_info.h"
 #include "commands_info/server_info.h"
 
@@ -157,6 +158,15 @@ TEST(AuthInfo, serialize_deserialize) {
   ASSERT_TRUE(!err);
 
   ASSERT_EQ(auth_info, dser);
+  ASSERT_EQ(0u, dser.GetFeatures());
+
+  auth_info.SetFeatures(fastotv::CHAT_BATCH_FEATURE);
+  serialize_t fser;
+  err = auth_info.Serialize(&fser);
+  ASSERT_TRUE(!err);
+  err = dser.DeSerialize(fser);
+  ASSERT_TRUE(!err);
+  ASSERT_TRUE(dser.HaveFeature(fastotv::CHAT_BATCH_FEATURE));
 }
 
 TEST(RuntimeChannelInfo, serialize_deserialize) {
@@ -182,3 +192,21 @@ TEST(RuntimeChannelInfo, serialize_deserialize) {
 
   ASSERT_EQ(rinf_info, dser);
 }
+
+TEST(PresenceInfo, serialize_deserialize) {
+  const std::string channel_id = "1234";
+  const size_t watchers = 120;
+  const int64_t delta = -3;
+  fastotv::PresenceInfo presence(channel_id, watchers, delta);
+  ASSERT_EQ(presence.GetChannelId(), channel_id);
+  ASSERT_EQ(presence.GetWatchersCount(), watchers);
+  ASSERT_EQ(presence.GetDelta(), delta);
+  serialize_t ser;
+  common::Error err = presence.Serialize(&ser);
+  ASSERT_TRUE(!err);
+  fastotv::PresenceInfo dser;
+  err = dser.DeSerialize(ser);
+  ASSERT_TRUE(!err);
+
+  ASSERT_EQ(presence, dser);
+}
@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "symbol.h"
+
+TEST(Symbol, intern) {
+  const fastotv::Symbol empty;
+  ASSERT_TRUE(empty.IsEmpty());
+  ASSERT_EQ(std::string(), empty.ToString());
+  ASSERT_EQ(empty, fastotv::Symbol(std::string()));
+
+  const fastotv::Symbol login("atopilski@gmail.com");
+  ASSERT_FALSE(login.IsEmpty());
+  ASSERT_EQ("atopilski@gmail.com", login.ToString());
+  ASSERT_EQ(login, fastotv::Symbol("atopilski@gmail.com"));
+  ASSERT_NE(login, fastotv::Symbol("anon@fastogt.com"));
+}
+
+TEST(Symbol, concurrent_intern) {
+  const size_t threads_count = 4;
+  const size_t symbols_count = 10000;  // more than one chunk
+  std::vector<std::vector<fastotv::Symbol>> results(threads_count);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threads_count; ++i) {
+    threads.push_back(std::thread([i, &results]() {
+      for (size_t j = 0; j < symbols_count; ++j) {
+        results[i].push_back(fastotv::Symbol("stream_" + std::to_string(j)));
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t j = 0; j < symbols_count; ++j) {
+    for (size_t i = 1; i < threads_count; ++i) {
+      ASSERT_EQ(results[0][j], results[i][j]);
+    }
+    ASSERT_EQ("stream_" + std::to_string(j), results[0][j].ToString());
+  }
+  ASSERT_GE(fastotv::SymbolTable::GetInstance()->GetSize(), symbols_count);
+}
+
+TEST(Symbol, find_without_intern) {
+  fastotv::SymbolTable* table = fastotv::SymbolTable::GetInstance();
+  fastotv::Symbol::id_t id;
+  ASSERT_FALSE(table->Find("never_interned_device", &id));
+  const size_t size = table->GetSize();
+  ASSERT_FALSE(table->Find("never_interned_device", &id));
+  ASSERT_EQ(size, table->GetSize());
+
+  const fastotv::Symbol device("interned_device");
+  ASSERT_TRUE(table->Find("interned_device", &id));
+  ASSERT_EQ(device.GetId(), id);
+  ASSERT_TRUE(table->Find(std::string(), &id));
+  ASSERT_EQ(0u, id);
+}
+
+TEST(Symbol, find_symbol) {
+  fastotv::Symbol channel;
+  ASSERT_FALSE(fastotv::Symbol::Find("never_interned_channel", &channel));
+  ASSERT_TRUE(channel.IsEmpty());
+
+  const fastotv::Symbol known("known_channel");
+  ASSERT_TRUE(fastotv::Symbol::Find("known_channel", &channel));
+  ASSERT_EQ(known, channel);
+  ASSERT_FALSE(fastotv::Symbol::Find("known_channel", nullptr));
+}
+
+TEST(Symbol, full_table) {
+  fastotv::SymbolTable* table = fastotv::SymbolTable::GetInstance();
+  const size_t max_size = table->GetMaxSize();
+  const fastotv::Symbol known("known_before_full");
+  table->SetMaxSize(table->GetSize() + 1);
+
+  fastotv::Symbol last;
+  ASSERT_TRUE(fastotv::Symbol::Intern("last_fits", &last));
+  ASSERT_EQ("last_fits", last.ToString());
+
+  fastotv::Symbol rejected;
+  ASSERT_FALSE(fastotv::Symbol::Intern("does_not_fit", &rejected));
+  ASSERT_TRUE(fastotv::Symbol("does_not_fit").IsEmpty());
+  ASSERT_EQ(known, fastotv::Symbol("known_before_full"));  // known strings still resolved
+  ASSERT_TRUE(fastotv::Symbol::Intern(std::string(), &rejected));
+  ASSERT_TRUE(rejected.IsEmpty());
+
+  table->SetMaxSize(max_size);
+  ASSERT_TRUE(fastotv::Symbol::Intern("does_not_fit", &rejected));
+  ASSERT_FALSE(rejected.IsEmpty());
+  table->SetMaxSize(SIZE_MAX);
+  ASSERT_EQ(max_size, table->GetMaxSize());  // never above chunks capacity
+}